@@ -1,6 +1,7 @@
 #include "driver_level.h"
 
 #include <string.h>
+#include <ctype.h>
 
 #include "core/cmdlib.h"
 #include "core/VirtualStream.h"
@@ -9,12 +10,27 @@
 #include "util/util.h"
 #include "viewer/viewer.h"
 
+#include "exporter/export_manifest.h"
+
 #include "driver_routines/regions_d1.h"
 #include "driver_routines/regions_d2.h"
 
+#include <nstd/Array.hpp>
 #include <nstd/String.hpp>
 #include <nstd/Directory.hpp>
 #include <nstd/File.hpp>
+#include <nstd/Mutex.hpp>
+#include <nstd/System.hpp>
+#include <nstd/Time.hpp>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
 
 bool g_export_carmodels = false;
 bool g_export_models = false;
@@ -22,114 +38,660 @@ bool g_extract_mdls = false;
 
 bool g_export_world = false;
 bool g_export_worldUnityScript = false;
+bool g_export_worldUnityAsset = false;			// region data assets instead of generated scripts
+bool g_export_worldGLTF = false;
+int g_export_worldPlacements = PLACEMENTS_NONE;
 
 bool g_export_textures = false;
 bool g_explode_tpages = false;
 
 bool g_export_overmap = false;
 
+bool g_use_mmap = true;
+bool g_force_export = false;
+
 int g_overlaymap_width = 0;
 
-//---------------------------------------------------------------------------------------------------------------------------------
+int g_benchmark_objRegion = -1;						// region to measure OBJ writer speed on, -1 = disabled
+bool g_benchmark_texels = false;
+bool g_benchmark_rnc = false;
 
-OUT_CITYLUMP_INFO		g_levInfo;
-CDriverLevelTextures	g_levTextures;
-CDriverLevelModels		g_levModels;
-CBaseLevelMap*			g_levMap = nullptr;
+int64 g_regionCacheBudget = 64 * 1024 * 1024;		// spooled regions memory budget, 0 = unlimited
+int64 g_textureCacheBudget = 128 * 1024 * 1024;		// converted texture pages memory budget, 0 = unlimited
+int g_numThreads = 0;								// export worker threads, 0 = processor count
 
-String					g_levname;
-String					g_levname_moddir;
-String					g_levname_texdir;
+//---------------------------------------------------------------------------------------------------------------------------------
 
 const float				texelSize = 1.0f / 256.0f;
 const float				halfTexelSize = texelSize * 0.5f;
 
 
+//-------------------------------------------------------------
+// Returns hash of settings which change exported files
+//-------------------------------------------------------------
+static uint64 GetExportSettingsHash(LevelContext_t& level)
+{
+	const int settings[] = {
+		EXPORT_MANIFEST_VERSION,
+		level.map->GetFormat(),
+		g_export_worldUnityScript,
+		g_export_worldUnityAsset,
+		g_explode_tpages,
+		g_extract_mdls,
+	};
+
+	return HashData(settings, sizeof(settings));
+}
+
 //-------------------------------------------------------------
 // Exports level data
 //-------------------------------------------------------------
-void ExportLevelData()
+void ExportLevelData(LevelContext_t& level)
 {
 	Msg("-------------\nExporting level data\n-------------\n");
 
+	String manifestFilename = File::dirname(level.name) + "/" + File::basename(level.name, File::extension(level.name)) + "_export.manifest";
+
+	level.exportManifest.SetForceExport(g_force_export);
+	level.exportManifest.Load(manifestFilename, GetExportSettingsHash(level));
+
 	if (g_export_models || g_export_carmodels)
 	{
-		Directory::create(g_levname_moddir);
-		SaveModelPagesMTL();
+		Directory::create(level.modelsDir);
+		SaveModelPagesMTL(level);
 	}
 	
 	if (g_export_models)
 	{
-		Directory::create(g_levname_moddir);
-		ExportAllModels();
+		Directory::create(level.modelsDir);
+		ExportAllModels(level);
 	}
 
 	if (g_export_carmodels)
 	{
-		Directory::create(g_levname_moddir);
-		ExportAllCarModels();
+		Directory::create(level.modelsDir);
+		ExportAllCarModels(level);
 	}
 	
 	if (g_export_world)
 	{
 		ModelExportFilters filters;
-		ExportRegions(filters);
+
+		if (g_export_worldPlacements != PLACEMENTS_NONE)
+			ExportWorldPlacements(level, filters, g_export_worldPlacements);
+		else if (g_export_worldGLTF)
+			ExportWorldGLTF(level, filters);
+		else
+			ExportRegions(level, filters);
 	}
 
+	if (g_benchmark_objRegion >= 0)
+		BenchmarkRegionObjExport(level, g_benchmark_objRegion);
+
 	if (g_export_textures)
 	{
-		Directory::create(g_levname_texdir);
-		ExportAllTextures();
+		Directory::create(level.texturesDir);
+		ExportAllTextures(level);
 	}
 
 	if (g_export_overmap)
 	{
-		Directory::create(g_levname_texdir);
-		ExportOverlayMap();
+		Directory::create(level.texturesDir);
+		ExportOverlayMap(level);
 	}
 
+	if (g_benchmark_texels)
+		BenchmarkTextureConversion(level);
+
+	if (g_benchmark_rnc)
+		BenchmarkOverlayMapUnpack(level);
+
+	level.exportManifest.Save();
+
+	PrintExportMemoryUsage(level);
+
 	Msg("Export done\n");
 }
 
-//-------------------------------------------------------------------------------------------------------------------------
+//-------------------------------------------------------------
+// Returns peak resident set size of the process in bytes
+//-------------------------------------------------------------
+int64 GetPeakProcessMemory()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return counters.PeakWorkingSetSize;
+#else
+	struct rusage usage;
 
-void ExportLevelFile()
+	// kilobytes on Linux
+	if (getrusage(RUSAGE_SELF, &usage) == 0)
+		return (int64)usage.ru_maxrss * 1024;
+#endif
+	return 0;
+}
+
+void PrintExportMemoryUsage(LevelContext_t& level)
 {
-	FILE* levTest = fopen(g_levname, "rb");
+	const float MB = 1024.0f * 1024.0f;
+
+	// process memory is shared by levels of batch, it's reported by caller
+	MsgInfo("Peak spooled data: %.2f MB (budget %.2f MB)\n",
+		level.map ? level.map->GetPeakResidentBytes() / MB : 0.0f,
+		g_regionCacheBudget / MB);
 
-	if (!levTest)
+	if (level.textureCache.GetNumConversions())
 	{
-		MsgError("LEV file '%s' does not exists!\n", (char*)g_levname);
+		MsgInfo("Peak converted textures: %.2f MB (budget %.2f MB), %d pages converted, %d taken from cache\n",
+			level.textureCache.GetPeakResidentBytes() / MB,
+			g_textureCacheBudget / MB,
+			level.textureCache.GetNumConversions(),
+			level.textureCache.GetNumHits());
+	}
+}
+
+//-------------------------------------------------------------
+// Returns number of threads used by parallel export
+//-------------------------------------------------------------
+int GetNumWorkerThreads()
+{
+	if (g_numThreads > 0)
+		return g_numThreads;
+
+	int numCPUs = System::getProcessorCount();
+	return numCPUs > 0 ? numCPUs : 1;
+}
+
+// batch export gives each level part of the threads
+int GetNumWorkerThreads(const LevelContext_t& level)
+{
+	if (level.numThreads > 0)
+		return level.numThreads;
+
+	return GetNumWorkerThreads();
+}
+
+//-------------------------------------------------------------
+// Runs independent jobs on export worker threads of level
+//-------------------------------------------------------------
+void RunParallelJobs(const LevelContext_t& level, int numJobs, ParallelJobFunc_t func, void* userData)
+{
+	RunParallelJobs(numJobs, GetNumWorkerThreads(level), func, userData);
+}
+
+//-------------------------------------------------------------
+// Opens level file for reading. Maps it into memory if possible
+//-------------------------------------------------------------
+IVirtualStream* OpenLevelStream(const char* filename)
+{
+	if (g_use_mmap)
+	{
+		CMappedFileStream* mappedStream = new CMappedFileStream();
+
+		if (mappedStream->Open(filename))
+			return mappedStream;
+
+		delete mappedStream;
+	}
+
+	CCachedFileStream* cachedStream = new CCachedFileStream();
+
+	if (cachedStream->Open(filename))
+		return cachedStream;
+
+	delete cachedStream;
+	return nullptr;
+}
+
+void CloseLevelStream(IVirtualStream* stream)
+{
+	if (!stream)
 		return;
+
+	if (!g_use_mmap)
+	{
+		CCachedFileStream* cachedStream = (CCachedFileStream*)stream;
+
+		MsgInfo("Level file I/O: %d reads (%d KB), %d seeks, cache hits: %d, misses: %d\n",
+			cachedStream->GetFileReads(), cachedStream->GetBytesRead() / 1024, cachedStream->GetFileSeeks(),
+			cachedStream->GetCacheHits(), cachedStream->GetCacheMisses());
+	}
+
+	delete stream;
+}
+
+//-------------------------------------------------------------
+// Returns load profile with only data required by exports
+//-------------------------------------------------------------
+LevelLoadProfile_t GetExportLoadProfile()
+{
+	LevelLoadProfile_t profile;
+
+	// world needs everything
+	if (g_export_world || g_benchmark_objRegion >= 0)
+		return profile;
+
+	profile.lumpMask = 0;
+	profile.permanentTPages = false;
+
+	// texture page count is needed for MODELPAGES.mtl
+	if (g_export_models || g_export_carmodels)
+		profile.lumpMask |= LUMP_MASK(LUMP_TEXTUREINFO);
+
+	if (g_export_models)
+		profile.lumpMask |= LUMP_MASK_MODELS;
+
+	if (g_export_carmodels)
+		profile.lumpMask |= LUMP_MASK_CARMODELS;
+
+	// map is required to spool area texture pages
+	if (g_export_textures)
+	{
+		profile.lumpMask |= LUMP_MASK_TEXTURES | LUMP_MASK_MAP;
+		profile.permanentTPages = true;
+	}
+
+	if (g_export_overmap)
+		profile.lumpMask |= LUMP_MASK_OVERLAYMAP;
+
+	if (g_benchmark_texels)
+	{
+		profile.lumpMask |= LUMP_MASK_TEXTURES;
+		profile.permanentTPages = true;
+	}
+
+	if (g_benchmark_rnc)
+		profile.lumpMask |= LUMP_MASK_OVERLAYMAP;
+
+	return profile;
+}
+
+//-------------------------------------------------------------------------------------------------------------------------
+
+//-------------------------------------------------------------
+// Opens level file and loads it into context
+//-------------------------------------------------------------
+bool LoadLevel(LevelContext_t& level, const LevelLoadProfile_t& profile)
+{
+	level.stream = OpenLevelStream(level.name);
+
+	if (!level.stream)
+	{
+		MsgError("LEV file '%s' does not exists!\n", (char*)level.name);
+		return false;
 	}
 
-	CFileStream stream(levTest);
-	ELevelFormat levFormat = CDriverLevelLoader::DetectLevelFormat(&stream);
+	// pages may be converted by loading callbacks
+	level.textureCache.SetBudget(g_textureCacheBudget);
 
 	CDriverLevelLoader levLoader;
+	ELevelFormat levFormat = levLoader.ReadLumpDirectory(level.stream, level.name);
 
 	// create map accordingly
 	if (levFormat >= LEV_FORMAT_DRIVER2_ALPHA16 || levFormat == LEV_FORMAT_AUTODETECT)
-		g_levMap = new CDriver2LevelMap();
+		level.map = new CDriver2LevelMap();
 	else
-		g_levMap = new CDriver1LevelMap();
+		level.map = new CDriver1LevelMap();
+
+	// texture pages are unpacked using export worker threads
+	LevelLoadProfile_t loadProfile = profile;
+
+	if (!loadProfile.numThreads)
+		loadProfile.numThreads = GetNumWorkerThreads(level);
+
+	levLoader.Initialize(level.info, &level.textures, &level.models, level.map, loadProfile);
 
-	levLoader.Initialize(g_levInfo, &g_levTextures, &g_levModels, g_levMap);
+	if (!levLoader.Load(level.stream))
+		return false;
 
-	if (levLoader.Load(&stream))
+	level.map->SetRegionCacheBudget(g_regionCacheBudget);
+	return true;
+}
+
+//-------------------------------------------------------------
+// Frees all level data and closes it's file
+//-------------------------------------------------------------
+void FreeLevel(LevelContext_t& level)
+{
+	if (level.map)
+		level.map->FreeAll();
+
+	level.textures.FreeAll();
+	level.models.FreeAll();
+	level.textureCache.Clear();
+
+	delete level.map;
+	level.map = nullptr;
+
+	CloseLevelStream(level.stream);
+	level.stream = nullptr;
+}
+
+bool ExportLevelFile(LevelContext_t& level)
+{
+	const bool loaded = LoadLevel(level, GetExportLoadProfile());
+
+	if (loaded)
+		ExportLevelData(level);
+
+	MsgWarning("Freeing level data ...\n");
+
+	FreeLevel(level);
+
+	return loaded;
+}
+
+//-------------------------------------------------------------
+// Sets level file and it's output folders
+//-------------------------------------------------------------
+void SetLevelFilename(LevelContext_t& level, const String& filename)
+{
+	level.name = filename;
+
+	String lev_no_ext = File::dirname(level.name) + "/" + File::basename(level.name, File::extension(level.name));
+	level.modelsDir = lev_no_ext + "_models";
+	level.texturesDir = lev_no_ext + "_textures";
+}
+
+static int64 GetFileSize(const String& filename)
+{
+	File file;
+
+	if (!file.open(filename))
+		return 0;
+
+	return file.size();
+}
+
+//-------------------------------------------------------------
+// Sums size of files in folder
+//-------------------------------------------------------------
+static int64 GetFolderSize(const String& path)
+{
+	Directory dir;
+
+	if (!dir.open(path, "*", false))
+		return 0;
+
+	int64 totalSize = 0;
+
+	String name;
+	bool isDir;
+
+	while (dir.read(name, isDir))
 	{
-		ExportLevelData();
+		if (!isDir)
+			totalSize += GetFileSize(path + "/" + name);
 	}
 
-	fclose(levTest);
+	return totalSize;
+}
 
-	MsgWarning("Freeing level data ...\n");
+//-------------------------------------------------------------
+// Checks if file in regions folder was written for this level
+// other levels may share it's name as prefix
+//-------------------------------------------------------------
+static bool IsLevelRegionsOutput(const char* name, const String& levNameOnly)
+{
+	const int len = levNameOnly.length();
+
+	if (strncmp(name, levNameOnly, len) || name[len] != '_')
+		return false;
+
+	const char* suffix = name + len + 1;
+
+	if (!strcmp(suffix, "LEVELMODEL.mtl") || !strcmp(suffix, "placements.csv") || !strcmp(suffix, "placements.bin"))
+		return true;
 
-	g_levMap->FreeAll();
-	g_levTextures.FreeAll();
-	g_levModels.FreeAll();
+	// <level>_reg<N>.<ext>
+	if (strncmp(suffix, "reg", 3) || !isdigit(suffix[3]))
+		return false;
 
-	delete g_levMap;
+	const char* ext = suffix + 3;
+
+	while (isdigit(*ext))
+		ext++;
+
+	return !strcmp(ext, ".obj") || !strcmp(ext, ".cs") || !strcmp(ext, ".bytes");
+}
+
+//-------------------------------------------------------------
+// Sums size of world files written for level
+//-------------------------------------------------------------
+static int64 GetLevelWorldOutputSize(const String& levDir, const String& levNameOnly)
+{
+	int64 totalSize = GetFileSize(levDir + "/" + levNameOnly + "_world.glb");
+
+	Directory dir;
+
+	if (!dir.open(levDir + "/regions", "*", false))
+		return totalSize;
+
+	String name;
+	bool isDir;
+
+	while (dir.read(name, isDir))
+	{
+		if (!isDir && IsLevelRegionsOutput(name, levNameOnly))
+			totalSize += GetFileSize(levDir + "/regions/" + name);
+	}
+
+	return totalSize;
+}
+
+//-------------------------------------------------------------
+// Adds LEV files from folder, list file or single LEV file
+//-------------------------------------------------------------
+void AddBatchLevelFiles(Array<String>& levelFiles, const String& path)
+{
+	if (Directory::exists(path))
+	{
+		Directory dir;
+
+		if (!dir.open(path, "*", false))
+			return;
+
+		String name;
+		bool isDir;
+
+		while (dir.read(name, isDir))
+		{
+			if (!isDir && !File::extension(name).compareIgnoreCase("lev"))
+				levelFiles.append(path + "/" + name);
+		}
+
+		return;
+	}
+
+	if (!File::extension(path).compareIgnoreCase("lev"))
+	{
+		levelFiles.append(path);
+		return;
+	}
+
+	// list file, one LEV file per line
+	FILE* fp = fopen(path, "rb");
+
+	if (!fp)
+	{
+		MsgError("Unable to open batch list '%s'\n", (const char*)path);
+		return;
+	}
+
+	char line[1024];
+
+	while (fgets(line, sizeof(line), fp))
+	{
+		int len = strlen(line);
+
+		while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r' || line[len - 1] == ' '))
+			line[--len] = 0;
+
+		if (len > 0 && line[0] != '#')
+			levelFiles.append(String::fromCString(line, len));
+	}
+
+	fclose(fp);
+}
+
+struct BatchLevelResult_t
+{
+	String		filename;
+	int64		levSize{ 0 };
+	int64		outputSize{ 0 };
+	int64		microTicks{ 0 };
+	bool		success{ false };
+};
+
+struct BatchLogMessage_t
+{
+	SpewType_t	type;
+	String		text;
+};
+
+// output of one level, printed at once when it's done
+struct BatchLevelLog_t
+{
+	Mutex						mutex;
+	Array<BatchLogMessage_t>	messages;
+};
+
+struct BatchExportJob_t
+{
+	const Array<String>*		levelFiles{ nullptr };
+	Array<BatchLevelResult_t>	results;
+	int							threadsPerLevel{ 1 };
+	Mutex						outputMutex;		// levels finishing at once don't mix their logs
+};
+
+static void BatchLevelSpew(void* userData, SpewType_t type, const char* text)
+{
+	BatchLevelLog_t& log = *(BatchLevelLog_t*)userData;
+	Mutex::Guard guard(log.mutex);
+
+	BatchLogMessage_t& message = log.messages.append(BatchLogMessage_t());
+	message.type = type;
+	message.text = String::fromCString(text);
+}
+
+//-------------------------------------------------------------
+// Exports single level of batch with it's own context and log
+//-------------------------------------------------------------
+static void ExportBatchLevelJob(void* userData, int index)
+{
+	BatchExportJob_t& batch = *(BatchExportJob_t*)userData;
+	const String& filename = (*batch.levelFiles)[index];
+
+	SpewToOutput(SPEW_NORM, String::fromPrintf("Batch %d/%d: %s started\n", index + 1, (int)batch.levelFiles->size(), (const char*)filename));
+
+	LevelContext_t level;
+	SetLevelFilename(level, filename);
+	level.numThreads = batch.threadsPerLevel;
+
+	BatchLevelResult_t& result = batch.results[index];
+	result.filename = filename;
+	result.levSize = GetFileSize(level.name);
+
+	BatchLevelLog_t log;
+	SetThreadSpewFunction(BatchLevelSpew, &log);
+
+	const int64 startTicks = Time::microTicks();
+	result.success = ExportLevelFile(level);
+	result.microTicks = Time::microTicks() - startTicks;
+
+	SetThreadSpewFunction(nullptr, nullptr);
+
+	const String levDir = File::dirname(level.name);
+	const String levNameOnly = File::basename(level.name, File::extension(level.name));
+
+	result.outputSize = GetFolderSize(level.modelsDir) +
+		GetFolderSize(level.texturesDir) +
+		GetLevelWorldOutputSize(levDir, levNameOnly);
+
+	Mutex::Guard guard(batch.outputMutex);
+
+	SpewToOutput(SPEW_NORM, String::fromPrintf("===============\nBatch %d/%d: %s\n===============\n", index + 1, (int)batch.levelFiles->size(), (const char*)filename));
+
+	for (usize i = 0; i < log.messages.size(); i++)
+		SpewToOutput(log.messages[i].type, log.messages[i].text);
+}
+
+//-------------------------------------------------------------
+// Exports every level file with same settings
+// Levels are exported at once, worker threads are split between them
+//-------------------------------------------------------------
+void ExportLevelBatch(const Array<String>& batchLevelFiles)
+{
+	// same file exported twice at once would write same outputs
+	Array<String> levelFiles;
+
+	for (usize i = 0; i < batchLevelFiles.size(); i++)
+	{
+		if (!levelFiles.find(batchLevelFiles[i]))
+			levelFiles.append(batchLevelFiles[i]);
+	}
+
+	const int numFiles = levelFiles.size();
+	const int numThreads = GetNumWorkerThreads();
+
+	BatchExportJob_t batch;
+	batch.levelFiles = &levelFiles;
+	batch.results.resize(numFiles);
+
+	// each level export runs it's own workers
+	const int numLevelJobs = numThreads < numFiles ? numThreads : numFiles;
+	batch.threadsPerLevel = numLevelJobs > 0 ? numThreads / numLevelJobs : 1;
+
+	if (batch.threadsPerLevel < 1)
+		batch.threadsPerLevel = 1;
+
+	MsgInfo("Exporting %d level files, %d at once using %d threads each\n", numFiles, numLevelJobs, batch.threadsPerLevel);
+
+	const int64 batchStartTicks = Time::microTicks();
+
+	RunParallelJobs(numFiles, numLevelJobs, ExportBatchLevelJob, &batch);
+
+	const Array<BatchLevelResult_t>& results = batch.results;
+
+	const float MB = 1024.0f * 1024.0f;
+
+	int64 totalLevSize = 0;
+	int64 totalOutputSize = 0;
+	int numFailed = 0;
+
+	MsgInfo("\nBatch summary:\n");
+	MsgInfo("  %-40s %10s %10s %10s\n", "file", "time (s)", "LEV (MB)", "out (MB)");
+
+	for (usize i = 0; i < results.size(); i++)
+	{
+		const BatchLevelResult_t& result = results[i];
+
+		if (result.success)
+		{
+			Msg("  %-40s %10.2f %10.2f %10.2f\n", (const char*)File::basename(result.filename),
+				result.microTicks / 1000000.0, result.levSize / MB, result.outputSize / MB);
+		}
+		else
+		{
+			MsgError("  %-40s %10.2f     failed\n", (const char*)File::basename(result.filename), result.microTicks / 1000000.0);
+			numFailed++;
+		}
+
+		totalLevSize += result.levSize;
+		totalOutputSize += result.outputSize;
+	}
+
+	MsgInfo("  %-40s %10.2f %10.2f %10.2f\n", "total",
+		(Time::microTicks() - batchStartTicks) / 1000000.0, totalLevSize / MB, totalOutputSize / MB);
+
+	MsgInfo("Peak process memory: %.2f MB\n", GetPeakProcessMemory() / MB);
+
+	if (numFailed)
+		MsgError("%d of %d level files failed\n", numFailed, (int)results.size());
+	else
+		MsgAccept("All %d level files exported\n", (int)results.size());
 }
 
 // 
@@ -162,7 +724,7 @@ void ConvertMDLToOBJ(const char* filename, const char* outputFilename)
 		return;
 	}
 
-	ExportMDLToOBJ(model, outputFilename, 0, modelSize);
+	ExportMDLToOBJ(nullptr, model, outputFilename, 0, modelSize);
 }
 
 //----------------------------------------------------------------------------------------
@@ -178,9 +740,21 @@ void PrintCommandLineArguments()
 		"  -carmodels <1/0> \t: Export car models (OBJ)\n\n"
 		"  -world <1/0> \t\t: Export whole world regions (OBJ)\n\n"
 		"  -unity \t: Creates JavaScript file for Unity Engine\n\n"
+		"  -unityasset \t: Creates compact region data assets and single loader script for Unity Engine\n\n"
+		"  -gltf \t: Exports world as single GLB file with instanced models instead of OBJ regions. Used with -world 1\n\n"
+		"  -placements <csv/bin> \t: Exports world as model library and cell object placements table instead of OBJ regions\n\n"
 		"  -extractmodels \t: Extracts MDLs instead of exporting to OBJ\n\n"
 		"  -overmap <width> \t: Extract overlay map with specified width\n\n"
 		"  -explodetpages \t: Extracts textures as separate TIM files instead of whole texture page exporting as TGA\n\n"
+		"  -nommap \t: Read level file through sector cache instead of mapping it to memory, prints I/O statistics\n\n"
+		"  -regionbudget <MB> \t: Memory budget for spooled regions and area data, least recently used are freed. 0 = unlimited\n\n"
+		"  -texturebudget <MB> \t: Memory budget for converted texture pages, least recently used are freed. 0 = unlimited\n\n"
+		"  -threads <n> \t: Number of worker threads for export and texture page unpacking. 0 = number of processors\n\n"
+		"  -force \t: Exports all items even if they were not changed since last export\n\n"
+		"  -benchobj <region> \t: Measures OBJ export speed on specified region\n\n"
+		"  -benchtexels \t: Measures texture page conversion speed and checks all CPU paths give same result\n\n"
+		"  -benchrnc \t: Measures RNC2 unpacking speed on overlay map and checks it against old decoder\n\n"
+		"  -batch <folder/list.txt> \t: Exports all LEV files in folder or listed in text file with same arguments. Can be used multiple times. Files are exported at once with -threads split between them, memory budgets are per file\n\n"
 		"  -mdl2obj <filename.MDL> <output.OBJ> \t: converts MDL to OBJ file\n\n";
 		"  -compilemdl <filename.OBJ> <output.MDL> \t: compiles OBJ to MDL file\n\n";
 		"  -denting \t: enables car denting file generation for next -compilemodel key\n\n";
@@ -204,6 +778,9 @@ int main(int argc, char* argv[])
 	bool generate_denting = false;
 	int main_routine = 2;
 
+	Array<String> batchLevelFiles;
+	bool batchMode = false;
+
 	for (int i = 1; i < argc; i++)
 	{
 		if (!stricmp(argv[i], "-textures"))
@@ -222,6 +799,20 @@ int main(int argc, char* argv[])
 		{
 			g_export_worldUnityScript = true;
 		}
+		else if (!stricmp(argv[i], "-unityasset"))
+		{
+			g_export_worldUnityScript = true;
+			g_export_worldUnityAsset = true;
+		}
+		else if (!stricmp(argv[i], "-gltf"))
+		{
+			g_export_worldGLTF = true;
+		}
+		else if (!stricmp(argv[i], "-placements"))
+		{
+			g_export_worldPlacements = !stricmp(argv[i + 1], "bin") ? PLACEMENTS_BINARY : PLACEMENTS_CSV;
+			i++;
+		}
 		else if (!stricmp(argv[i], "-models"))
 		{
 			g_export_models = atoi(argv[i + 1]) > 0;
@@ -238,6 +829,29 @@ int main(int argc, char* argv[])
 		{
 			g_extract_mdls = true;
 		}
+		else if (!stricmp(argv[i], "-nommap"))
+		{
+			g_use_mmap = false;
+		}
+		else if (!stricmp(argv[i], "-force"))
+		{
+			g_force_export = true;
+		}
+		else if (!stricmp(argv[i], "-threads"))
+		{
+			g_numThreads = atoi(argv[i + 1]);
+			i++;
+		}
+		else if (!stricmp(argv[i], "-regionbudget"))
+		{
+			g_regionCacheBudget = (int64)atoi(argv[i + 1]) * 1024 * 1024;
+			i++;
+		}
+		else if (!stricmp(argv[i], "-texturebudget"))
+		{
+			g_textureCacheBudget = (int64)atoi(argv[i + 1]) * 1024 * 1024;
+			i++;
+		}
 		else if (!stricmp(argv[i], "-explodetpages"))
 		{
 			g_explode_tpages = true;
@@ -249,6 +863,29 @@ int main(int argc, char* argv[])
 			main_routine = 1;
 			i++;
 		}
+		else if (!stricmp(argv[i], "-benchobj"))
+		{
+			g_benchmark_objRegion = atoi(argv[i + 1]);
+			main_routine = 1;
+			i++;
+		}
+		else if (!stricmp(argv[i], "-benchtexels"))
+		{
+			g_benchmark_texels = true;
+			main_routine = 1;
+		}
+		else if (!stricmp(argv[i], "-benchrnc"))
+		{
+			g_benchmark_rnc = true;
+			main_routine = 1;
+		}
+		else if (!stricmp(argv[i], "-batch"))
+		{
+			AddBatchLevelFiles(batchLevelFiles, String::fromCString(argv[i + 1]));
+			batchMode = true;
+			main_routine = 1;
+			i++;
+		}
 		else if (!stricmp(argv[i], "-mdl2obj"))
 		{
 			ConvertMDLToOBJ(argv[i + 1], argv[i + 2]);
@@ -261,7 +898,7 @@ int main(int argc, char* argv[])
 		}
 		else if (!stricmp(argv[i], "-compilemdl"))
 		{
-			CompileOBJModelToMDL(argv[i + 1], argv[i + 2], generate_denting);
+			CompileOBJModelToMDL(batchLevelFiles.size() ? (const char*)batchLevelFiles.back() : nullptr, argv[i + 1], argv[i + 2], generate_denting);
 			main_routine = 0;
 			generate_denting = false; // disable denting compiler after it's job done
 			i += 2;
@@ -277,28 +914,42 @@ int main(int argc, char* argv[])
 				return 0;
 			}
 			
-			g_levname = test;
+			batchLevelFiles.append(test);
 		}
 	}
 
-	if (g_levname.length() == 0)
+	// several level files are exported in batch
+	if (batchLevelFiles.size() > 1 && main_routine == 1)
+		batchMode = true;
+
+	if (batchMode)
 	{
-		PrintCommandLineArguments();
+		if (batchLevelFiles.isEmpty())
+			MsgError("No LEV files to export\n");
+		else if (main_routine == 1)
+			ExportLevelBatch(batchLevelFiles);
+
 		return 0;
 	}
 
-	// prepare anyway
-	String lev_no_ext = File::dirname(g_levname) + "/" + File::basename(g_levname, File::extension(g_levname));
-	g_levname_moddir = lev_no_ext + "_models";
-	g_levname_texdir = lev_no_ext + "_textures";
+	if (batchLevelFiles.isEmpty())
+	{
+		PrintCommandLineArguments();
+		return 0;
+	}
 
 	if (main_routine == 1)
 	{
-		ExportLevelFile();
+		LevelContext_t level;
+		SetLevelFilename(level, batchLevelFiles.back());
+
+		ExportLevelFile(level);
+
+		MsgInfo("Peak process memory: %.2f MB\n", GetPeakProcessMemory() / (1024.0f * 1024.0f));
 	}
 	else if (main_routine == 2)
 	{
-		ViewerMain();
+		ViewerMain(batchLevelFiles.back());
 	}
 
 	return 0;
@@ -6,7 +6,11 @@
 #include "driver_routines/regions.h"
 #include "driver_routines/level.h"
 
+#include "exporter/export_manifest.h"
+#include "exporter/texture_cache.h"
+
 #include "math/Matrix.h"
+#include "util/parallel.h"
 
 //----------------------------------------------------------
 
@@ -14,16 +18,62 @@
 
 //----------------------------------------------------------
 
-// extern some vars
-extern OUT_CITYLUMP_INFO		g_levInfo;
-extern CDriverLevelTextures		g_levTextures;
-extern CDriverLevelModels		g_levModels;
-extern CBaseLevelMap*			g_levMap;
+// Level file and everything loaded from it
+// Every opened level has it's own context, so they can be processed at once
+struct LevelContext_t
+{
+	IVirtualStream*			stream{ nullptr };	// level data may point into it, keep it open until FreeAll
+	OUT_CITYLUMP_INFO		info{};
+	CDriverLevelTextures	textures;
+	CDriverLevelModels		models;
+	CBaseLevelMap*			map{ nullptr };
+
+	String					name;				// LEV file name
+	String					modelsDir;
+	String					texturesDir;
+
+	CExportManifest			exportManifest;		// skips unchanged items on re-export
+	CTextureVariantCache	textureCache;		// converted texture pages, shared by viewer and exporters
+
+	int						numThreads{ 0 };	// worker threads for this level, 0 = set by -threads
+};
+
+extern int64					g_regionCacheBudget;
+extern int64					g_textureCacheBudget;
+extern int						g_numThreads;
+
+//----------------------------------------------------------
+
+IVirtualStream*	OpenLevelStream(const char* filename);
+void			CloseLevelStream(IVirtualStream* stream);
+int				GetNumWorkerThreads();
+int				GetNumWorkerThreads(const LevelContext_t& level);
+
+// runs jobs using worker threads of level
+void			RunParallelJobs(const LevelContext_t& level, int numJobs, ParallelJobFunc_t func, void* userData);
+
+void			SetLevelFilename(LevelContext_t& level, const String& filename);
+bool			LoadLevel(LevelContext_t& level, const LevelLoadProfile_t& profile = LevelLoadProfile_t());
+void			FreeLevel(LevelContext_t& level);
+
+int64			GetPeakProcessMemory();
+void			PrintExportMemoryUsage(LevelContext_t& level);
 
 //----------------------------------------------------------
 
-void	ExportMDLToOBJ(MODEL* model, const char* model_name, int model_index, int modelSize);
-void	WriteMDLToObjStream(IVirtualStream* pStream, MODEL* model, int modelSize, int model_index, const char* name_prefix,
+class CObjWriter;
+
+// levModels is used to find instanced vertex data, can be null for standalone models
+typedef void (*WriteMDLToObjStream_t)(IVirtualStream* pStream, CDriverLevelModels* levModels, MODEL* model, int modelSize, int model_index, const char* name_prefix,
+			bool debugInfo, const Matrix4x4& translation, int* first_v, int* first_t);
+
+void	ExportMDLToOBJ(CDriverLevelModels* levModels, MODEL* model, const char* model_name, int model_index, int modelSize);
+void	WriteMDLToObj(CObjWriter& writer, CDriverLevelModels* levModels, MODEL* model, int modelSize, int model_index, const char* name_prefix,
+			bool debugInfo = true,
+			const Matrix4x4& translation = identity4(),
+			int* first_v = nullptr,
+			int* first_t = nullptr);
+void	WriteMDLToObjStream(IVirtualStream* pStream, CDriverLevelModels* levModels, MODEL* model, int modelSize, int model_index, const char* name_prefix,
 			bool debugInfo = true,
 			const Matrix4x4& translation = identity4(),
 			int* first_v = nullptr,
@@ -70,13 +120,33 @@ struct ModelExportFilters
 	}
 };
 
-void SaveModelPagesMTL();
-void ExportAllModels();
-void ExportAllCarModels();
+void SaveModelPagesMTL(LevelContext_t& level);
+void ExportAllModels(LevelContext_t& level);
+bool ExportLevelModel(LevelContext_t& level, int index);
+void ExportAllCarModels(LevelContext_t& level);
+
+// called for every cell object of the world, cellIdx is cell index within region
+typedef void (*CellObjectFunc_t)(void* userData, const CELL_OBJECT& co, int regionIdx, int cellIdx);
+
+// streams regions through and calls func for their cell objects
+void ForEachWorldCellObject(LevelContext_t& level, CellObjectFunc_t func, void* userData);
+
+void ExportRegions(LevelContext_t& level, const ModelExportFilters& filters, bool* regionsToExport = nullptr);
+void BenchmarkRegionObjExport(LevelContext_t& level, int regionIdx);
+void ExportWorldGLTF(LevelContext_t& level, const ModelExportFilters& filters);
+
+enum EPlacementsFormat
+{
+	PLACEMENTS_NONE = 0,
+	PLACEMENTS_CSV,
+	PLACEMENTS_BINARY,
+};
 
-void ExportRegions(const ModelExportFilters& filters, bool* regionsToExport = nullptr);
+void ExportWorldPlacements(LevelContext_t& level, const ModelExportFilters& filters, int format);
 
-void ExportAllTextures();
-void ExportOverlayMap();
+void ExportAllTextures(LevelContext_t& level);
+void BenchmarkTextureConversion(LevelContext_t& level);
+void ExportOverlayMap(LevelContext_t& level);
+void BenchmarkOverlayMapUnpack(LevelContext_t& level);
 
 #endif
\ No newline at end of file
@@ -5,6 +5,8 @@
 #include <nstd/String.hpp>
 #include <nstd/File.hpp>
 
+#include <string.h>
+
 #include "regions_d1.h"
 #include "regions_d2.h"
 #include "textures.h"
@@ -12,18 +14,89 @@
 #include "level.h"
 
 //-------------------------------------------------------------
-// Auto-detects level format
+// Returns level format which given lump type is specific to.
+// LEV_FORMAT_AUTODETECT means lump is shared between formats
 //-------------------------------------------------------------
-ELevelFormat CDriverLevelLoader::DetectLevelFormat(IVirtualStream* pFile)
+static ELevelFormat GetLumpTypeFormat(int type)
 {
-	long curPos = pFile->Tell();
-	int lump_count = 255;
+	switch (type)
+	{
+		case LUMP_MODELS:
+		case LUMP_MAP:
+		case LUMP_TEXTURENAMES:
+		case LUMP_MODELNAMES:
+		case LUMP_LOWDETAILTABLE:
+		case LUMP_MOTIONCAPTURE:
+		case LUMP_OVERLAYMAP:
+		case LUMP_PALLET:
+		case LUMP_SPOOLINFO:
+		case LUMP_CHAIR:
+		case LUMP_CAR_MODELS:
+		case LUMP_TEXTUREINFO:
+		case LUMP_STRAIGHTS2:
+		case LUMP_CURVES2:
+			return LEV_FORMAT_AUTODETECT;
+		case LUMP_JUNCTIONS2:
+			return LEV_FORMAT_DRIVER2_ALPHA16; // as it is an old junction format - it's clearly a alpha 1.6 level
+		case LUMP_JUNCTIONS2_NEW:
+			return LEV_FORMAT_DRIVER2_RETAIL; // most recent LEV file
+	}
 
-	LUMP lump;
-	OUT_CITYLUMP_INFO cityLumps;
+	// maybe Lump 11?
+	return LEV_FORMAT_DRIVER1;
+}
 
+static void PrintLevelFormat(ELevelFormat format)
+{
+	switch (format)
+	{
+		case LEV_FORMAT_DRIVER1_OLD:
+			MsgInfo("Detected old 'Driver 1 DEMO' LEV file\n");
+			break;
+		case LEV_FORMAT_DRIVER1:
+			MsgInfo("Detected 'Driver 1' LEV file\n");
+			break;
+		case LEV_FORMAT_DRIVER2_ALPHA16:
+			MsgInfo("Detected 'Driver 2 DEMO' 1.6 alpha LEV file\n");
+			break;
+		case LEV_FORMAT_DRIVER2_RETAIL:
+			MsgInfo("Detected 'Driver 2' final LEV file\n");
+			break;
+	}
+}
+
+//-------------------------------------------------------------
+// Lump directory
+//-------------------------------------------------------------
+
+void CLevelLumpDirectory::Clear()
+{
+	m_entries.clear();
+	memset(&m_cityLumps, 0, sizeof(m_cityLumps));
+	m_format = LEV_FORMAT_INVALID;
+}
+
+//-------------------------------------------------------------
+// Walks lump chain from current position and adds lumps to the directory
+// if detectedFormat is specified, format is taken from first format specific lump.
+// Scan stops there if it is Driver 1 lump, since section must be walked again with lump count
+//-------------------------------------------------------------
+void CLevelLumpDirectory::ScanLumps(IVirtualStream* pFile, int section, bool hasLumpCount, ELevelFormat* detectedFormat)
+{
+	const long fileSize = pFile->GetSize();
+
+	int lump_count = 255; // Driver 2 difference: you not need to read lump count
+
+	// Driver 1 has lump count
+	if (hasLumpCount)
+		pFile->Read(&lump_count, sizeof(int), 1);
+
+	LUMP lump;
 	for (int i = 0; i < lump_count; i++)
 	{
+		if (pFile->Tell() + (long)sizeof(LUMP) > fileSize)
+			break;
+
 		// read lump info
 		pFile->Read(&lump, sizeof(LUMP), 1);
 
@@ -31,77 +104,32 @@ ELevelFormat CDriverLevelLoader::DetectLevelFormat(IVirtualStream* pFile)
 		if (lump.type == 255)
 			break;
 
-		switch (lump.type)
+		LumpDirEntry_t entry;
+		entry.type = lump.type;
+		entry.offset = pFile->Tell();
+		entry.size = lump.size;
+		entry.section = section;
+
+		// broken chain
+		if (entry.size < 0 || entry.offset + entry.size > fileSize)
+			break;
+
+		// once detected, following lumps don't change the format
+		if (detectedFormat && *detectedFormat == LEV_FORMAT_AUTODETECT)
 		{
-			case LUMP_TEXTURES:
-				MsgInfo("Detected old 'Driver 1 DEMO' LEV file\n");
-				pFile->Seek(curPos, VS_SEEK_SET);
-				return LEV_FORMAT_DRIVER1_OLD;
-			case LUMP_MODELS:
-			case LUMP_MAP:
-			case LUMP_TEXTURENAMES:
-			case LUMP_MODELNAMES:
-			case LUMP_LOWDETAILTABLE:
-			case LUMP_MOTIONCAPTURE:
-			case LUMP_OVERLAYMAP:
-			case LUMP_PALLET:
-			case LUMP_SPOOLINFO:
-			case LUMP_CHAIR:
-			case LUMP_CAR_MODELS:
-			case LUMP_TEXTUREINFO:
-			case LUMP_STRAIGHTS2:
-			case LUMP_CURVES2:
-				break;
-			case LUMP_JUNCTIONS2:
-			{
-				MsgInfo("Detected 'Driver 2 DEMO' 1.6 alpha LEV file\n");
-				pFile->Seek(curPos, VS_SEEK_SET);
-				return LEV_FORMAT_DRIVER2_ALPHA16; // as it is an old junction format - it's clearly a alpha 1.6 level
-				break;
-			}
-			case LUMP_JUNCTIONS2_NEW:
-			{
-				MsgInfo("Detected 'Driver 2' final LEV file\n");
-				pFile->Seek(curPos, VS_SEEK_SET);
-				return LEV_FORMAT_DRIVER2_RETAIL; // most recent LEV file
-				break;
-			}
-			case LUMP_LOADTIME_DATA:
-			case LUMP_INMEMORY_DATA:
-				break;
-			case LUMP_LUMPDESC:
-			{
-				int loadtime_data_ofs;
-				pFile->Read(&cityLumps, 1, sizeof(cityLumps));
-				pFile->Seek(cityLumps.inmem_offset, VS_SEEK_SET);
-				break;
-			}
-			case LUMP_ROADMAP:
-			case LUMP_ROADS:
-			case LUMP_JUNCTIONS:
-			case LUMP_ROADSURF:
-			case LUMP_ROADBOUNDS:
-			case LUMP_JUNCBOUNDS:
-			case LUMP_SUBDIVISION:
-			default: // maybe Lump 11?
+			ELevelFormat lumpFormat = GetLumpTypeFormat(lump.type);
+
+			if (lumpFormat == LEV_FORMAT_DRIVER1)
 			{
-				MsgInfo("Detected 'Driver 1' LEV file\n");
-				pFile->Seek(curPos, VS_SEEK_SET);
-				return LEV_FORMAT_DRIVER1;
-				break;
+				*detectedFormat = LEV_FORMAT_DRIVER1;
+				return;
 			}
-		}
 
-		if (lump.type == LUMP_LOADTIME_DATA || 
-			lump.type == LUMP_INMEMORY_DATA ||
-			lump.type == LUMP_LUMPDESC)
-		{
-			// restart
-			i = -1;
-			lump_count = 255;
-			continue;
+			*detectedFormat = lumpFormat;
 		}
 
+		m_entries.append(entry);
+
 		// skip lump
 		pFile->Seek(lump.size, VS_SEEK_CUR);
 
@@ -109,34 +137,223 @@ ELevelFormat CDriverLevelLoader::DetectLevelFormat(IVirtualStream* pFile)
 		if ((pFile->Tell() % 4) != 0)
 			pFile->Seek(4 - (pFile->Tell() % 4), VS_SEEK_CUR);
 	}
+}
+
+//-------------------------------------------------------------
+// Walks lump chain of LEV file and detects it's format
+//-------------------------------------------------------------
+bool CLevelLumpDirectory::Scan(IVirtualStream* pFile)
+{
+	Clear();
+
+	long curPos = pFile->Tell();
+
+	LUMP lump;
+	pFile->Read(&lump, sizeof(LUMP), 1);
+
+	if (lump.type == LUMP_TEXTURES)
+	{
+		// no sections, just lumps
+		m_format = LEV_FORMAT_DRIVER1_OLD;
+
+		pFile->Seek(curPos, VS_SEEK_SET);
+		ScanLumps(pFile, LUMP_SECTION_NONE, false, nullptr);
+	}
+	else if (lump.type == LUMP_LUMPDESC)
+	{
+		pFile->Read(&m_cityLumps, sizeof(OUT_CITYLUMP_INFO), 1);
+
+		// format is detected from in-memory section contents
+		pFile->Seek(m_cityLumps.inmem_offset, VS_SEEK_SET);
+		pFile->Read(&lump, sizeof(LUMP), 1);
+
+		if (lump.type == LUMP_INMEMORY_DATA)
+		{
+			long sectionPos = pFile->Tell();
+			ELevelFormat format = LEV_FORMAT_AUTODETECT;
+
+			ScanLumps(pFile, LUMP_INMEMORY_DATA, false, &format);
+
+			// Driver 1 sections start with lump count, walk it again
+			if (format == LEV_FORMAT_DRIVER1)
+			{
+				m_entries.clear();
+
+				pFile->Seek(sectionPos, VS_SEEK_SET);
+				ScanLumps(pFile, LUMP_INMEMORY_DATA, true, nullptr);
+			}
+
+			if (format != LEV_FORMAT_AUTODETECT)
+			{
+				pFile->Seek(m_cityLumps.loadtime_offset, VS_SEEK_SET);
+				pFile->Read(&lump, sizeof(LUMP), 1);
+
+				if (lump.type == LUMP_LOADTIME_DATA)
+				{
+					ScanLumps(pFile, LUMP_LOADTIME_DATA, format == LEV_FORMAT_DRIVER1, nullptr);
+					m_format = format;
+				}
+			}
+		}
+	}
 
 	pFile->Seek(curPos, VS_SEEK_SET);
 
-	return LEV_FORMAT_INVALID;
+	if (m_format == LEV_FORMAT_INVALID)
+	{
+		Clear();
+		return false;
+	}
+
+	return true;
 }
 
 //-------------------------------------------------------------
-// Iterates LEV file lumps and loading data from them
+// Loads lump directory from sidecar index file
 //-------------------------------------------------------------
-void CDriverLevelLoader::ProcessLumps(IVirtualStream* pFile)
+bool CLevelLumpDirectory::LoadIndexFile(const char* levFilename, long levFileSize)
 {
-	int lump_count = 255; // Driver 2 difference: you not need to read lump count
+	File::Time levTime;
+	if (!File::time(String::fromCString(levFilename), levTime))
+		return false;
 
-	// Driver 1 has lump count
-	if (m_format == LEV_FORMAT_DRIVER1)
-		pFile->Read(&lump_count, sizeof(int), 1);
+	FILE* fp = fopen(String::fromPrintf("%s%s", levFilename, LUMPDIR_FILE_EXT), "rb");
+	if (!fp)
+		return false;
 
-	LUMP lump;
-	for (int i = 0; i < lump_count; i++)
+	CFileStream stream(fp);
+
+	LUMPDIR_HEADER hdr;
+	memset(&hdr, 0, sizeof(hdr));
+	stream.Read(&hdr, 1, sizeof(hdr));
+
+	bool valid = hdr.ident == LUMPDIR_IDENT &&
+		hdr.version == LUMPDIR_VERSION &&
+		hdr.levFileSize == levFileSize &&
+		hdr.levWriteTime == levTime.writeTime &&
+		hdr.format > LEV_FORMAT_INVALID && hdr.format <= LEV_FORMAT_DRIVER2_RETAIL &&
+		hdr.numEntries >= 0 && hdr.numEntries < 1024;
+
+	if (valid)
 	{
-		// read lump info
-		pFile->Read(&lump, sizeof(LUMP), 1);
+		Clear();
 
-		// stop marker
-		if (lump.type == 255)
-			break;
+		m_entries.resize(hdr.numEntries);
+
+		if (hdr.numEntries)
+			valid = stream.Read(&m_entries[0], hdr.numEntries, sizeof(LumpDirEntry_t)) == hdr.numEntries;
+
+		m_cityLumps = hdr.cityLumps;
+		m_format = (ELevelFormat)hdr.format;
+	}
+
+	fclose(fp);
+
+	if (!valid)
+		Clear();
+
+	return valid;
+}
+
+//-------------------------------------------------------------
+// Saves lump directory to sidecar index file
+//-------------------------------------------------------------
+bool CLevelLumpDirectory::SaveIndexFile(const char* levFilename, long levFileSize) const
+{
+	File::Time levTime;
+	if (m_format == LEV_FORMAT_INVALID || !File::time(String::fromCString(levFilename), levTime))
+		return false;
+
+	FILE* fp = fopen(String::fromPrintf("%s%s", levFilename, LUMPDIR_FILE_EXT), "wb");
+	if (!fp)
+		return false;
+
+	CFileStream stream(fp);
+
+	LUMPDIR_HEADER hdr;
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.ident = LUMPDIR_IDENT;
+	hdr.version = LUMPDIR_VERSION;
+	hdr.levFileSize = levFileSize;
+	hdr.levWriteTime = levTime.writeTime;
+	hdr.format = m_format;
+	hdr.numEntries = m_entries.size();
+	hdr.cityLumps = m_cityLumps;
+
+	stream.Write(&hdr, 1, sizeof(hdr));
+
+	if (m_entries.size())
+		stream.Write(&m_entries[0], m_entries.size(), sizeof(LumpDirEntry_t));
+
+	fclose(fp);
+
+	return true;
+}
+
+const LumpDirEntry_t* CLevelLumpDirectory::FindLump(int type) const
+{
+	for (usize i = 0; i < m_entries.size(); i++)
+	{
+		if (m_entries[i].type == type)
+			return &m_entries[i];
+	}
+
+	return nullptr;
+}
+
+int CLevelLumpDirectory::GetEntryCount() const
+{
+	return m_entries.size();
+}
+
+const LumpDirEntry_t& CLevelLumpDirectory::GetEntry(int index) const
+{
+	return m_entries[index];
+}
+
+ELevelFormat CLevelLumpDirectory::GetFormat() const
+{
+	return m_format;
+}
+
+const OUT_CITYLUMP_INFO& CLevelLumpDirectory::GetCityLumpInfo() const
+{
+	return m_cityLumps;
+}
+
+//-------------------------------------------------------------
+// Auto-detects level format
+//-------------------------------------------------------------
+ELevelFormat CDriverLevelLoader::DetectLevelFormat(IVirtualStream* pFile)
+{
+	CLevelLumpDirectory lumpDir;
+	lumpDir.Scan(pFile);
+
+	PrintLevelFormat(lumpDir.GetFormat());
+
+	return lumpDir.GetFormat();
+}
+
+//-------------------------------------------------------------
+// Iterates LEV file lumps and loading data from them
+//-------------------------------------------------------------
+void CDriverLevelLoader::ProcessLumps(IVirtualStream* pFile, int section)
+{
+	for (int i = 0; i < m_lumpDir.GetEntryCount(); i++)
+	{
+		const LumpDirEntry_t& lump = m_lumpDir.GetEntry(i);
 
-		int l_ofs = pFile->Tell();
+		if (lump.section != section)
+			continue;
+
+		// not required by load profile
+		if (lump.type < 0 || lump.type >= 64 || !(m_profile.lumpMask & LUMP_MASK(lump.type)))
+		{
+			DevMsg(SPEW_WARNING, "Lump %d skipped\n", lump.type);
+			continue;
+		}
+
+		pFile->Seek(lump.offset, VS_SEEK_SET);
 
 		DevMsg(SPEW_WARNING, "Lump %d ", lump.type);
 		switch (lump.type)
@@ -287,16 +504,6 @@ void CDriverLevelLoader::ProcessLumps(IVirtualStream* pFile)
 			default:
 				DevMsg(SPEW_WARNING, "UNKNOWN (0x%X) ofs=%d size=%d\n", lump.type, pFile->Tell(), lump.size);
 		}
-
-		// seek back to initial position
-		pFile->Seek(l_ofs, VS_SEEK_SET);
-
-		// skip lump
-		pFile->Seek(lump.size, VS_SEEK_CUR);
-
-		// position alignment
-		if ((pFile->Tell() % 4) != 0)
-			pFile->Seek(4 - (pFile->Tell() % 4), VS_SEEK_CUR);
 	}
 }
 
@@ -316,9 +523,11 @@ ELevelFormat CDriverLevelLoader::GetFormat() const
 	return m_format;
 }
 
-void CDriverLevelLoader::Initialize(OUT_CITYLUMP_INFO& lumpInfo, CDriverLevelTextures* textures, CDriverLevelModels* models, CBaseLevelMap* map)
+void CDriverLevelLoader::Initialize(OUT_CITYLUMP_INFO& lumpInfo, CDriverLevelTextures* textures, CDriverLevelModels* models, CBaseLevelMap* map,
+									const LevelLoadProfile_t& profile)
 {
 	m_lumpInfo = &lumpInfo;
+	m_profile = profile;
 
 	m_textures = textures;
 	m_models = models;
@@ -330,6 +539,38 @@ void CDriverLevelLoader::Initialize(OUT_CITYLUMP_INFO& lumpInfo, CDriverLevelTex
 
 void CDriverLevelLoader::Release()
 {
+	m_lumpDir.Clear();
+}
+
+//-------------------------------------------------------------
+// Reads lump directory from sidecar index file or scans the LEV file
+// If filename is specified, index file is used and updated
+//-------------------------------------------------------------
+ELevelFormat CDriverLevelLoader::ReadLumpDirectory(IVirtualStream* pStream, const char* filename)
+{
+	if (filename)
+		m_fileName = String::fromCString(filename);
+
+	const long fileSize = pStream->GetSize();
+
+	if (filename && m_lumpDir.LoadIndexFile(filename, fileSize))
+	{
+		DevMsg(SPEW_INFO, "Using lump directory from index file (%d lumps)\n", m_lumpDir.GetEntryCount());
+	}
+	else if (m_lumpDir.Scan(pStream))
+	{
+		if (filename && !m_lumpDir.SaveIndexFile(filename, fileSize))
+			DevMsg(SPEW_WARNING, "Unable to save lump directory index file\n");
+	}
+
+	PrintLevelFormat(m_lumpDir.GetFormat());
+
+	return m_lumpDir.GetFormat();
+}
+
+const LumpDirEntry_t* CDriverLevelLoader::FindLump(int type) const
+{
+	return m_lumpDir.FindLump(type);
 }
 
 //-------------------------------------------------------------
@@ -342,9 +583,19 @@ bool CDriverLevelLoader::Load(IVirtualStream* pStream)
 
 	//-------------------------------------------------------------------
 
+	// lump directory is also used for format auto-detection
+	if (m_lumpDir.GetFormat() == LEV_FORMAT_INVALID)
+		ReadLumpDirectory(pStream);
+
+	if (m_lumpDir.GetFormat() == LEV_FORMAT_INVALID)
+	{
+		MsgError("Not a valid LEV file!\n");
+		return false;
+	}
+
 	// perform auto-detection if format is not specified
 	if (m_format == LEV_FORMAT_AUTODETECT)
-		m_format = DetectLevelFormat(pStream);
+		m_format = m_lumpDir.GetFormat();
 
 	if (m_map)
 		m_map->SetFormat(m_format);
@@ -354,21 +605,12 @@ bool CDriverLevelLoader::Load(IVirtualStream* pStream)
 
 	if (m_format == LEV_FORMAT_DRIVER1_OLD)
 	{
-		ProcessLumps(pStream);
+		ProcessLumps(pStream, LUMP_SECTION_NONE);
 		return true;
 	}
 
-	LUMP curLump;
-	pStream->Read(&curLump, sizeof(curLump), 1);
-
-	if (curLump.type != LUMP_LUMPDESC)
-	{
-		MsgError("Not a valid LEV file!\n");
-		return false;
-	}
-
-	// read chunk offsets
-	pStream->Read(m_lumpInfo, sizeof(OUT_CITYLUMP_INFO), 1);
+	// chunk offsets
+	*m_lumpInfo = m_lumpDir.GetCityLumpInfo();
 
 	DevMsg(SPEW_NORM, "data1_offset = %d\n", m_lumpInfo->loadtime_offset);
 	DevMsg(SPEW_NORM, "data1_size = %d\n", m_lumpInfo->loadtime_size);
@@ -382,52 +624,28 @@ bool CDriverLevelLoader::Load(IVirtualStream* pStream)
 	DevMsg(SPEW_NORM, "spooled_offset = %d\n", m_lumpInfo->spooled_offset);
 	DevMsg(SPEW_NORM, "spooled_size = %d\n", m_lumpInfo->spooled_size);
 
-	// read cells
-
 	//-----------------------------------------------------
-	// seek to section 1 - lump data 1
-	pStream->Seek(m_lumpInfo->loadtime_offset, VS_SEEK_SET);
-
-	// read lump
-	pStream->Read(&curLump, sizeof(curLump), 1);
-
-	if (curLump.type != LUMP_LOADTIME_DATA)
-	{
-		MsgError("Not a LUMP_LOADTIME_DATA!\n");
-		return false;
-	}
-
-	DevMsg(SPEW_INFO, "entering LUMP_LOADTIME_DATA size = %d\n--------------\n", curLump.size);
+	// section 1 - lump data 1
+	DevMsg(SPEW_INFO, "entering LUMP_LOADTIME_DATA size = %d\n--------------\n", m_lumpInfo->loadtime_size);
 
 	// read sublumps
-	ProcessLumps(pStream);
+	ProcessLumps(pStream, LUMP_LOADTIME_DATA);
 
 	//-----------------------------------------------------
 	// read global textures
 
-	if (m_textures)
+	if (m_textures && m_profile.permanentTPages)
 	{
 		pStream->Seek(m_lumpInfo->tpage_offset, VS_SEEK_SET);
-		m_textures->LoadPermanentTPages(pStream);
+		m_textures->LoadPermanentTPages(pStream, m_profile.numThreads);
 	}
 
 	//-----------------------------------------------------
-	// seek to section 3 - lump data 2
-	pStream->Seek(m_lumpInfo->inmem_offset, VS_SEEK_SET);
-
-	// read lump
-	pStream->Read(&curLump, sizeof(curLump), 1);
-
-	if (curLump.type != LUMP_INMEMORY_DATA)
-	{
-		MsgError("Not a lump LUMP_INMEMORY_DATA!\n");
-		return false;
-	}
-
-	DevMsg(SPEW_INFO, "entering LUMP_INMEMORY_DATA size = %d\n--------------\n", curLump.size);
+	// section 3 - lump data 2
+	DevMsg(SPEW_INFO, "entering LUMP_INMEMORY_DATA size = %d\n--------------\n", m_lumpInfo->inmem_size);
 
 	// read sublumps
-	ProcessLumps(pStream);
+	ProcessLumps(pStream, LUMP_INMEMORY_DATA);
 
 	return true;
 }
\ No newline at end of file
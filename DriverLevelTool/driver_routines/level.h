@@ -5,10 +5,15 @@
 #ifndef LEVEL_H
 #define LEVEL_H
 
+#include <nstd/Array.hpp>
 #include "d2_types.h"
 
 #define SPOOL_CD_BLOCK_SIZE		2048
 
+#define LUMPDIR_IDENT			(('R' << 24) | ('I' << 16) | ('D' << 8) | 'L')		// LDIR
+#define LUMPDIR_VERSION			1
+#define LUMPDIR_FILE_EXT		".lumpdir"
+
 // known lumps indexes
 enum LevLumpType
 {
@@ -55,6 +60,19 @@ enum LevLumpType
 	LUMP_JUNCTIONS2_NEW		= 43,		// Driver 2 junctions (retail)
 };
 
+#define LUMP_MASK(type)			(1ULL << (type))
+#define LUMP_MASK_ALL			(~0ULL)
+
+// lumps used by each of level subsystems
+#define LUMP_MASK_TEXTURES		(LUMP_MASK(LUMP_TEXTURES) | LUMP_MASK(LUMP_TEXTURENAMES) | LUMP_MASK(LUMP_TEXTUREINFO) | LUMP_MASK(LUMP_PALLET))
+#define LUMP_MASK_MODELS		(LUMP_MASK(LUMP_MODELS) | LUMP_MASK(LUMP_MODELNAMES) | LUMP_MASK(LUMP_LOWDETAILTABLE))
+#define LUMP_MASK_CARMODELS		(LUMP_MASK(LUMP_CAR_MODELS))
+#define LUMP_MASK_MAP			(LUMP_MASK(LUMP_MAP) | LUMP_MASK(LUMP_SPOOLINFO))
+#define LUMP_MASK_OVERLAYMAP	(LUMP_MASK(LUMP_OVERLAYMAP))
+#define LUMP_MASK_ROADS			(LUMP_MASK(LUMP_STRAIGHTS2) | LUMP_MASK(LUMP_CURVES2) | LUMP_MASK(LUMP_JUNCTIONS2) | LUMP_MASK(LUMP_JUNCTIONS2_NEW) | \
+								LUMP_MASK(LUMP_ROADMAP) | LUMP_MASK(LUMP_ROADS) | LUMP_MASK(LUMP_JUNCTIONS) | LUMP_MASK(LUMP_ROADSURF) | \
+								LUMP_MASK(LUMP_ROADBOUNDS) | LUMP_MASK(LUMP_JUNCBOUNDS))
+
 enum ELevelFormat
 {
 	LEV_FORMAT_AUTODETECT = -1,
@@ -75,6 +93,70 @@ class CBaseLevelMap;
 
 //------------------------------------------------------------------------------------------------------------
 
+// defines which level data is going to be loaded by CDriverLevelLoader
+struct LevelLoadProfile_t
+{
+	uint64	lumpMask{ LUMP_MASK_ALL };		// LUMP_MASK of lumps to be processed
+	bool	permanentTPages{ true };		// load permanent and special texture pages
+	int		numThreads{ 0 };				// threads unpacking permanent texture pages, 0 = processor count
+};
+
+#define LUMP_SECTION_NONE		-1		// old formats has no loadtime/inmemory sections
+
+struct LumpDirEntry_t
+{
+	int		type;
+	int		offset;		// absolute offset of lump data (after LUMP header)
+	int		size;
+	int		section;	// LUMP_LOADTIME_DATA, LUMP_INMEMORY_DATA or LUMP_SECTION_NONE
+};
+
+// sidecar index file header
+struct LUMPDIR_HEADER
+{
+	int					ident;
+	int					version;
+
+	int64				levFileSize;
+	int64				levWriteTime;
+
+	int					format;
+	int					numEntries;
+
+	OUT_CITYLUMP_INFO	cityLumps;
+};
+
+// LEV file lump directory, built with a single pass over lump chain
+class CLevelLumpDirectory
+{
+public:
+	void					Clear();
+
+	// walks lump chain of LEV file and detects it's format
+	bool					Scan(IVirtualStream* pFile);
+
+	// sidecar index file, valid as long as LEV file size and modification time matches
+	bool					LoadIndexFile(const char* levFilename, long levFileSize);
+	bool					SaveIndexFile(const char* levFilename, long levFileSize) const;
+
+	const LumpDirEntry_t*	FindLump(int type) const;
+
+	int						GetEntryCount() const;
+	const LumpDirEntry_t&	GetEntry(int index) const;
+
+	ELevelFormat			GetFormat() const;
+	const OUT_CITYLUMP_INFO& GetCityLumpInfo() const;
+
+protected:
+	void					ScanLumps(IVirtualStream* pFile, int section, bool hasLumpCount, ELevelFormat* detectedFormat);
+
+	Array<LumpDirEntry_t>	m_entries;
+	OUT_CITYLUMP_INFO		m_cityLumps;
+	ELevelFormat			m_format{ LEV_FORMAT_INVALID };
+};
+
+//------------------------------------------------------------------------------------------------------------
+
 class CDriverLevelLoader
 {
 public:
@@ -85,19 +167,27 @@ public:
 	CDriverLevelLoader();
 	virtual ~CDriverLevelLoader();
 
-	void					Initialize(OUT_CITYLUMP_INFO& lumpInfo, CDriverLevelTextures* textures, CDriverLevelModels* models, CBaseLevelMap* map);
+	void					Initialize(OUT_CITYLUMP_INFO& lumpInfo, CDriverLevelTextures* textures, CDriverLevelModels* models, CBaseLevelMap* map,
+								const LevelLoadProfile_t& profile = LevelLoadProfile_t());
 	void					Release();
 
 	ELevelFormat			GetFormat() const;
 
+	// reads lump directory from sidecar index file or scans the LEV file. Detects level format
+	ELevelFormat			ReadLumpDirectory(IVirtualStream* pStream, const char* filename = nullptr);
+	const LumpDirEntry_t*	FindLump(int type) const;
+
 	bool					Load(IVirtualStream* pStream);
 
 protected:
-	void					ProcessLumps(IVirtualStream* pFile);
+	void					ProcessLumps(IVirtualStream* pFile, int section);
 
 	ELevelFormat			m_format{ LEV_FORMAT_AUTODETECT };
 	String					m_fileName;
 
+	CLevelLumpDirectory		m_lumpDir;
+	LevelLoadProfile_t		m_profile;
+
 	OUT_CITYLUMP_INFO*		m_lumpInfo;
 
 	CBaseLevelMap*			m_map{ nullptr };
@@ -2,6 +2,7 @@
 #include "core/IVirtualStream.h"
 
 #include <nstd/HashSet.hpp>
+#include <nstd/Mutex.hpp>
 
 #include "models.h"
 
@@ -26,8 +27,11 @@ void CDriverLevelModels::FreeAll()
 
 		OnModelFreed(&ref);
 		
-		if (ref.model)
+		if (ref.model && ref.ownsModel)
 			Memory::free(ref.model);
+
+		ref.model = nullptr;
+		ref.ownsModel = false;
 	}
 
 	for (int i = 0; i < MAX_CAR_MODELS; i++)
@@ -47,6 +51,7 @@ void CDriverLevelModels::FreeAll()
 	}
 
 	m_model_names.clear();
+	m_modelNameIndex.clear();
 }
 
 ModelRef_t* CDriverLevelModels::GetModelByIndex(int nIndex) const
@@ -59,13 +64,12 @@ ModelRef_t* CDriverLevelModels::GetModelByIndex(int nIndex) const
 
 int CDriverLevelModels::FindModelIndexByName(const char* name) const
 {
-	for (usize i = 0; i < MAX_MODELS && i < m_model_names.size(); i++)
-	{
-		if (!stricmp(m_model_names[i], name))
-			return i;
-	}
+	HashMap<String, int>::Iterator it = m_modelNameIndex.find(String::fromCString(name).toLowerCase());
 
-	return -1;
+	if (it == m_modelNameIndex.end())
+		return -1;
+
+	return *it;
 }
 
 const char* CDriverLevelModels::GetModelNameByIndex(int nIndex) const
@@ -174,6 +178,13 @@ void CDriverLevelModels::LoadModelNamesLump(IVirtualStream* pFile, int size)
 
 		m_model_names.append(String::fromCString(str));
 
+		// first model with the name wins as with linear search
+		const int modelIndex = m_model_names.size() - 1;
+		String indexName = String::fromCString(str).toLowerCase();
+
+		if (modelIndex < MAX_MODELS && !m_modelNameIndex.contains(indexName))
+			m_modelNameIndex.append(indexName, modelIndex);
+
 		sz += len + 1;
 	} while (sz < size);
 
@@ -248,10 +259,19 @@ void CDriverLevelModels::LoadLevelModelsLump(IVirtualStream* pFile)
 		{
 			ModelRef_t& ref = m_levelModels[i];
 			ref.index = i;
-			ref.model = (MODEL*)Memory::alloc(modelSize);
 			ref.size = modelSize;
 
-			pFile->Read(ref.model, modelSize, 1);
+			// view model in place if possible
+			ref.model = (MODEL*)pFile->GetMappedPointer(modelSize);
+			ref.ownsModel = ref.model == nullptr;
+
+			if (ref.ownsModel)
+			{
+				ref.model = (MODEL*)Memory::alloc(modelSize);
+				pFile->Read(ref.model, modelSize, 1);
+			}
+			else
+				pFile->Seek(modelSize, VS_SEEK_CUR);
 		}
 		else // leave empty as swap
 		{
@@ -336,9 +356,12 @@ const int PolySizes[56] = {
 };
 
 HashSet<int> g_UnknownPolyTypes;
+Mutex g_UnknownPolyTypesMutex;		// polygons are decoded by export threads
 
 void PrintUnknownPolys()
 {
+	Mutex::Guard guard(g_UnknownPolyTypesMutex);
+
 	if (!g_UnknownPolyTypes.size())
 		return;
 
@@ -510,6 +533,7 @@ int decode_poly(const char* polyList, dpoly_t* out, int forceType /*= -1*/)
 		}
 		default:
 		{
+			Mutex::Guard guard(g_UnknownPolyTypesMutex);
 			g_UnknownPolyTypes.append(ptype);
 		}
 	}
@@ -3,6 +3,7 @@
 
 #include <nstd/String.hpp>
 #include <nstd/Array.hpp>
+#include <nstd/HashMap.hpp>
 
 #include "core/dktypes.h"
 #include "math/psx_math_types.h"
@@ -64,7 +65,9 @@ struct ModelRef_t
 	
 	void*		userData{ nullptr }; // might contain a hardware model pointer
 
+	ushort		areaRefs{ 0 };		// resident area datas using this spooled model
 	bool		enabled { true };
+	bool		ownsModel{ false };	// false when model points into mapped LEV file
 };
 
 //------------------------------------------------------------------------------------------------------------
@@ -119,6 +122,7 @@ protected:
 	CarModelData_t		m_carModels[MAX_CAR_MODELS];
 
 	Array<String>		m_model_names;
+	HashMap<String, int>	m_modelNameIndex;	// lowercase name to model index
 
 	OnModelLoaded_t		m_onModelLoaded{ nullptr };
 	OnModelFreed_t		m_onModelFreed{ nullptr };
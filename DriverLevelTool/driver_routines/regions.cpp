@@ -1,6 +1,7 @@
 #include "regions.h"
 
 #include <string.h>
+#include <stdlib.h>
 
 #include "models.h"
 #include "textures.h"
@@ -27,27 +28,12 @@ void CBaseLevelRegion::FreeAll()
 		return;
 
 	m_owner->OnRegionFreed(this);
-	
-	// do I need that?
-	if(m_spoolInfo && m_spoolInfo->super_region != 0xFF)
-	{
-		int areaDataNum = m_spoolInfo->super_region;
-		int numAreaTpages = m_owner->m_areaData[areaDataNum].num_tpages;
-		AreaTpageList& areaTPages = m_owner->m_areaTPages[areaDataNum];
-
-		for (int i = 0; numAreaTpages; i++)
-		{
-			if (areaTPages.pageIndexes[i] == 0xFF)
-				break;
+	m_owner->RemoveResidentRegion(this);
 
-			if (areaTPages.tpage[i])
-			{
-				areaTPages.tpage[i]->FreeBitmap();
-				areaTPages.tpage[i] = nullptr;
-			}
-		}
-	}
-	m_spoolInfo = nullptr;
+	// area data is shared between regions of same super region
+	if (m_areaDataAcquired)
+		m_owner->ReleaseAreaData(GetAreaDataIdx());
+	m_areaDataAcquired = false;
 
 	delete[] m_cellPointers;
 	m_cellPointers = nullptr;
@@ -55,7 +41,8 @@ void CBaseLevelRegion::FreeAll()
 	if (m_cellObjects)
 		Memory::free(m_cellObjects);
 	m_cellObjects = nullptr;
-	
+
+	m_residentBytes = 0;
 	m_loaded = false;
 }
 
@@ -69,6 +56,11 @@ int	CBaseLevelRegion::GetNumber() const
 	return m_regionNumber;
 }
 
+int CBaseLevelRegion::GetResidentBytes() const
+{
+	return m_residentBytes;
+}
+
 CELL_OBJECT* CBaseLevelRegion::GetCellObject(int num) const
 {
 	int numStraddlers = m_owner->m_numStraddlers;
@@ -165,14 +157,11 @@ void CBaseLevelRegion::LoadAreaData(const SPOOL_CONTEXT& ctx)
 	if (!m_spoolInfo || m_spoolInfo && m_spoolInfo->super_region == 0xFF)
 		return;
 
-	const int areaDataNum = m_spoolInfo->super_region;
-	if (m_owner->m_areaDataStates[areaDataNum])
+	if (m_areaDataAcquired)
 		return;
 
-	m_owner->LoadInAreaTPages(ctx, areaDataNum);
-	m_owner->LoadInAreaModels(ctx, areaDataNum);
-
-	m_owner->m_areaDataStates[areaDataNum] = true;
+	m_owner->AcquireAreaData(ctx, m_spoolInfo->super_region);
+	m_areaDataAcquired = true;
 }
 
 int	CBaseLevelRegion::GetAreaDataIdx() const
@@ -220,6 +209,9 @@ void CBaseLevelMap::FreeAll()
 
 	delete[] m_straddlers;
 	m_straddlers = nullptr;
+
+	m_residentRegions.clear();
+	m_residentBytes = 0;
 }
 
 int	CBaseLevelMap::GetAreaDataCount() const
@@ -390,8 +382,15 @@ void CBaseLevelMap::LoadSpoolInfoLump(IVirtualStream* pFile)
 	if(regionsInfoSize > 0)
 		pFile->Read(m_regionSpoolInfo, 1, regionsInfoSize);
 
-	m_areaDataStates = new bool[m_numAreas];
-	memset(m_areaDataStates, 0, m_numAreas);
+	m_areaDataStates = new AREA_DATA_STATE[m_numAreas];
+	m_areaCacheHits = 0;
+	m_areaCacheMisses = 0;
+}
+
+// heap memory held by spooled area texture page
+static int GetAreaTPageBytes(CTexturePage* tpage)
+{
+	return TEXPAGE_SIZE / 2 + tpage->GetBitmap().numPalettes * sizeof(TEXCLUT);
 }
 
 void CBaseLevelMap::LoadInAreaTPages(const SPOOL_CONTEXT& ctx, int areaDataNum) const
@@ -409,7 +408,7 @@ void CBaseLevelMap::LoadInAreaTPages(const SPOOL_CONTEXT& ctx, int areaDataNum)
 
 	ctx.dataStream->Seek(texturesOffset, VS_SEEK_SET);
 
-	for (int i = 0; areaData.num_tpages; i++)
+	for (int i = 0; i < areaData.num_tpages; i++)
 	{
 		if (areaTPages.pageIndexes[i] == 0xFF)
 			break;
@@ -419,8 +418,21 @@ void CBaseLevelMap::LoadInAreaTPages(const SPOOL_CONTEXT& ctx, int areaDataNum)
 		// assign
 		areaTPages.tpage[i] = tpage;
 
-		if(tpage)
-			tpage->LoadTPageAndCluts(ctx.dataStream, true);
+		if (tpage)
+		{
+			const bool wasLoaded = tpage->GetBitmap().data != nullptr;
+			tpage->LoadTPageAndCluts(ctx.dataStream, true, ctx.deferredNotify == nullptr);
+
+			// page is counted once, by area that loaded it
+			if (!wasLoaded)
+			{
+				m_areaDataStates[areaDataNum].residentBytes += GetAreaTPageBytes(tpage);
+				m_areaDataStates[areaDataNum].chargedTPages.append(areaTPages.pageIndexes[i]);
+			}
+
+			if (ctx.deferredNotify && !wasLoaded)
+				ctx.deferredNotify->tpages.append(tpage);
+		}
 
 		if (ctx.dataStream->Tell() % SPOOL_CD_BLOCK_SIZE)
 			ctx.dataStream->Seek(SPOOL_CD_BLOCK_SIZE - (ctx.dataStream->Tell() % SPOOL_CD_BLOCK_SIZE), VS_SEEK_CUR);
@@ -436,6 +448,7 @@ void CBaseLevelMap::LoadInAreaModels(const SPOOL_CONTEXT& ctx, int areaDataNum)
 		return;
 
 	AreaDataStr& areaData = m_areaData[areaDataNum];
+	AREA_DATA_STATE& areaState = m_areaDataStates[areaDataNum];
 
 	int length = areaData.model_size;
 
@@ -470,16 +483,40 @@ void CBaseLevelMap::LoadInAreaModels(const SPOOL_CONTEXT& ctx, int areaDataNum)
 				if (ref->size != modelSize)
 					MsgError("Spool model in slot %d OVERLAP!\n", new_model_numbers[i]);
 
+				// share model spooled by other area
+				if (ref->areaRefs > 0 && !areaState.modelIndexes.find(new_model_numbers[i]))
+				{
+					ref->areaRefs++;
+					areaState.modelIndexes.append(new_model_numbers[i]);
+				}
+
 				ctx.dataStream->Seek(modelSize, VS_SEEK_CUR);
 				continue;
 			}
 
-			ref->model = (MODEL*)Memory::alloc(modelSize);
 			ref->size = modelSize;
+			ref->areaRefs = 1;
+			areaState.modelIndexes.append(new_model_numbers[i]);
+
+			// view model in place if possible
+			ref->model = (MODEL*)ctx.dataStream->GetMappedPointer(modelSize);
+			ref->ownsModel = ref->model == nullptr;
+
+			if (ref->ownsModel)
+			{
+				ref->model = (MODEL*)Memory::alloc(modelSize);
+				ctx.dataStream->Read(ref->model, modelSize, 1);
 
-			ctx.dataStream->Read(ref->model, modelSize, 1);
+				areaState.residentBytes += modelSize;
+				areaState.chargedModels.append(new_model_numbers[i]);
+			}
+			else
+				ctx.dataStream->Seek(modelSize, VS_SEEK_CUR);
 
-			m_models->OnModelLoaded(ref);
+			if (ctx.deferredNotify)
+				ctx.deferredNotify->models.append(ref);
+			else
+				m_models->OnModelLoaded(ref);
 		}
 	}
 
@@ -534,6 +571,8 @@ bool CBaseLevelMap::SpoolRegion(const SPOOL_CONTEXT& ctx, const XZPAIR& cell)
 		{
 			region->LoadRegionData(ctx);
 			region->LoadAreaData(ctx);
+
+			AddResidentRegion(region);
 			return true;
 		}
 		else
@@ -552,6 +591,8 @@ bool CBaseLevelMap::SpoolRegion(const SPOOL_CONTEXT& ctx, int regionIdx)
 		{
 			region->LoadRegionData(ctx);
 			region->LoadAreaData(ctx);
+
+			AddResidentRegion(region);
 			return true;
 		}
 		else
@@ -560,6 +601,354 @@ bool CBaseLevelMap::SpoolRegion(const SPOOL_CONTEXT& ctx, int regionIdx)
 	return false;
 }
 
+void CBaseLevelMap::DispatchSpoolNotify(SPOOL_NOTIFY_LIST& list)
+{
+	// textures first so models and regions can refer to them
+	if (m_textures)
+	{
+		for (usize i = 0; i < list.tpages.size(); i++)
+			m_textures->OnTexturePageLoaded(list.tpages[i]);
+	}
+
+	if (m_models)
+	{
+		for (usize i = 0; i < list.models.size(); i++)
+			m_models->OnModelLoaded(list.models[i]);
+	}
+
+	for (usize i = 0; i < list.regions.size(); i++)
+		OnRegionLoaded(list.regions[i]);
+
+	list.tpages.clear();
+	list.models.clear();
+	list.regions.clear();
+}
+
+//-------------------------------------------------------------
+// Resident region cache
+//-------------------------------------------------------------
+void CBaseLevelMap::SetRegionCacheBudget(int64 budgetBytes)
+{
+	m_regionCacheBudget = budgetBytes;
+}
+
+int64 CBaseLevelMap::GetRegionCacheBudget() const
+{
+	return m_regionCacheBudget;
+}
+
+int64 CBaseLevelMap::GetResidentBytes() const
+{
+	return m_residentBytes;
+}
+
+int64 CBaseLevelMap::GetPeakResidentBytes() const
+{
+	return m_peakResidentBytes;
+}
+
+int CBaseLevelMap::GetResidentRegionCount() const
+{
+	return m_residentRegions.size();
+}
+
+void CBaseLevelMap::TouchRegion(int regionIdx)
+{
+	CBaseLevelRegion* region = GetRegion(regionIdx);
+
+	if (region)
+		region->m_lastUseTick = m_regionUseTick;
+}
+
+int CBaseLevelMap::TrimRegionCache(Array<int>* evictedRegions)
+{
+	int numEvicted = 0;
+
+	if (m_regionCacheBudget > 0 && m_residentBytes > m_regionCacheBudget)
+	{
+		// regions used since last trim are kept
+		Array<CBaseLevelRegion*> candidates;
+		candidates.reserve(m_residentRegions.size());
+
+		for (usize i = 0; i < m_residentRegions.size(); i++)
+		{
+			if (m_residentRegions[i]->m_lastUseTick != m_regionUseTick)
+				candidates.append(m_residentRegions[i]);
+		}
+
+		// least recently used first
+		if (candidates.size())
+		{
+			qsort(&candidates[0], candidates.size(), sizeof(CBaseLevelRegion*), [](const void* a, const void* b) {
+				const CBaseLevelRegion* ra = *(const CBaseLevelRegion**)a;
+				const CBaseLevelRegion* rb = *(const CBaseLevelRegion**)b;
+
+				return (int)(ra->m_lastUseTick - rb->m_lastUseTick);
+			});
+		}
+
+		for (usize i = 0; i < candidates.size() && m_residentBytes > m_regionCacheBudget; i++)
+		{
+			CBaseLevelRegion* region = candidates[i];
+
+			if (evictedRegions)
+				evictedRegions->append(region->m_regionNumber);
+
+			DevMsg(SPEW_INFO, "Evicting region %d (%d bytes)\n", region->m_regionNumber, region->m_residentBytes);
+			region->FreeAll();
+
+			numEvicted++;
+		}
+
+		TrimAreaDataCache();
+	}
+
+	m_regionUseTick++;
+
+	return numEvicted;
+}
+
+void CBaseLevelMap::AddResidentRegion(CBaseLevelRegion* region)
+{
+	region->m_lastUseTick = m_regionUseTick;
+
+	m_residentRegions.append(region);
+	m_residentBytes += region->m_residentBytes;
+
+	if (m_residentBytes > m_peakResidentBytes)
+		m_peakResidentBytes = m_residentBytes;
+}
+
+void CBaseLevelMap::RemoveResidentRegion(CBaseLevelRegion* region)
+{
+	CBaseLevelRegion** found = m_residentRegions.find(region);
+
+	if (!found)
+		return;
+
+	m_residentRegions.remove(found - &m_residentRegions[0]);
+	m_residentBytes -= region->m_residentBytes;
+}
+
+//-------------------------------------------------------------
+// Area data cache
+//-------------------------------------------------------------
+int CBaseLevelMap::GetAreaDataRefCount(int areaDataNum) const
+{
+	if (areaDataNum < 0 || areaDataNum >= m_numAreas)
+		return 0;
+
+	return m_areaDataStates[areaDataNum].refCount;
+}
+
+int CBaseLevelMap::GetAreaCacheHits() const
+{
+	return m_areaCacheHits;
+}
+
+int CBaseLevelMap::GetAreaCacheMisses() const
+{
+	return m_areaCacheMisses;
+}
+
+void CBaseLevelMap::AcquireAreaData(const SPOOL_CONTEXT& ctx, int areaDataNum)
+{
+	AREA_DATA_STATE& areaState = m_areaDataStates[areaDataNum];
+
+	if (areaState.refCount++ > 0 || areaState.loaded)
+	{
+		m_areaCacheHits++;
+		return;
+	}
+
+	m_areaCacheMisses++;
+
+	areaState.residentBytes = 0;
+	areaState.chargedModels.clear();
+	areaState.chargedTPages.clear();
+
+	LoadInAreaTPages(ctx, areaDataNum);
+	LoadInAreaModels(ctx, areaDataNum);
+
+	areaState.loaded = true;
+
+	m_residentBytes += areaState.residentBytes;
+
+	if (m_residentBytes > m_peakResidentBytes)
+		m_peakResidentBytes = m_residentBytes;
+}
+
+void CBaseLevelMap::ReleaseAreaData(int areaDataNum)
+{
+	AREA_DATA_STATE& areaState = m_areaDataStates[areaDataNum];
+
+	if (areaState.refCount <= 0)
+		return;
+
+	// kept loaded for next region of same area until cache is trimmed
+	if (--areaState.refCount == 0)
+		areaState.lastUseTick = m_regionUseTick;
+}
+
+//-------------------------------------------------------------
+// Frees least recently used unreferenced area data over the budget
+//-------------------------------------------------------------
+void CBaseLevelMap::TrimAreaDataCache()
+{
+	while (m_residentBytes > m_regionCacheBudget)
+	{
+		int oldestArea = -1;
+
+		for (int i = 0; i < m_numAreas; i++)
+		{
+			const AREA_DATA_STATE& areaState = m_areaDataStates[i];
+
+			if (!areaState.loaded || areaState.refCount > 0)
+				continue;
+
+			if (oldestArea == -1 || (int)(areaState.lastUseTick - m_areaDataStates[oldestArea].lastUseTick) < 0)
+				oldestArea = i;
+		}
+
+		if (oldestArea == -1)
+			break;
+
+		DevMsg(SPEW_INFO, "Freeing area data %d (%d bytes)\n", oldestArea, m_areaDataStates[oldestArea].residentBytes);
+		FreeAreaData(oldestArea);
+	}
+}
+
+//-------------------------------------------------------------
+// Returns loaded area which uses texture page, -1 if none
+//-------------------------------------------------------------
+int CBaseLevelMap::FindAreaUsingTPage(int pageIndex) const
+{
+	for (int i = 0; i < m_numAreas; i++)
+	{
+		if (!m_areaDataStates[i].loaded)
+			continue;
+
+		const AreaTpageList& areaTPages = m_areaTPages[i];
+
+		for (int j = 0; j < m_areaData[i].num_tpages; j++)
+		{
+			if (areaTPages.pageIndexes[j] == 0xFF)
+				break;
+
+			if (areaTPages.pageIndexes[j] == pageIndex)
+				return i;
+		}
+	}
+
+	return -1;
+}
+
+//-------------------------------------------------------------
+// Returns loaded area which uses spooled model, -1 if none
+//-------------------------------------------------------------
+int CBaseLevelMap::FindAreaUsingModel(int modelIndex) const
+{
+	for (int i = 0; i < m_numAreas; i++)
+	{
+		if (m_areaDataStates[i].loaded && m_areaDataStates[i].modelIndexes.find(modelIndex))
+			return i;
+	}
+
+	return -1;
+}
+
+//-------------------------------------------------------------
+// Shared data stays loaded for other area, so it is counted there now
+//-------------------------------------------------------------
+void CBaseLevelMap::MoveAreaResidentBytes(AREA_DATA_STATE& from, int toAreaNum, int numBytes)
+{
+	from.residentBytes -= numBytes;
+	m_areaDataStates[toAreaNum].residentBytes += numBytes;
+}
+
+//-------------------------------------------------------------
+// Frees area texture pages and models so they can be spooled again
+//-------------------------------------------------------------
+void CBaseLevelMap::FreeAreaData(int areaDataNum)
+{
+	const int numAreaTpages = m_areaData[areaDataNum].num_tpages;
+	AreaTpageList& areaTPages = m_areaTPages[areaDataNum];
+	AREA_DATA_STATE& areaState = m_areaDataStates[areaDataNum];
+
+	// pages shared with other loaded areas must stay
+	areaState.loaded = false;
+
+	for (int i = 0; i < numAreaTpages; i++)
+	{
+		if (areaTPages.pageIndexes[i] == 0xFF)
+			break;
+
+		CTexturePage* tpage = areaTPages.tpage[i];
+
+		if (tpage)
+		{
+			const int pageIndex = areaTPages.pageIndexes[i];
+			const int otherArea = FindAreaUsingTPage(pageIndex);
+
+			if (otherArea == -1)
+			{
+				tpage->FreeBitmap();
+			}
+			else if (int* charged = areaState.chargedTPages.find(pageIndex))
+			{
+				areaState.chargedTPages.remove(charged - &areaState.chargedTPages[0]);
+
+				MoveAreaResidentBytes(areaState, otherArea, GetAreaTPageBytes(tpage));
+				m_areaDataStates[otherArea].chargedTPages.append(pageIndex);
+			}
+		}
+
+		areaTPages.tpage[i] = nullptr;
+	}
+
+	// models may be shared with other areas
+	for (usize i = 0; i < areaState.modelIndexes.size(); i++)
+	{
+		ModelRef_t* ref = m_models->GetModelByIndex(areaState.modelIndexes[i]);
+
+		if (!ref || ref->areaRefs == 0)
+			continue;
+
+		if (--ref->areaRefs > 0)
+		{
+			const int otherArea = FindAreaUsingModel(areaState.modelIndexes[i]);
+			ushort* charged = areaState.chargedModels.find(areaState.modelIndexes[i]);
+
+			if (otherArea != -1 && charged)
+			{
+				areaState.chargedModels.remove(charged - &areaState.chargedModels[0]);
+
+				MoveAreaResidentBytes(areaState, otherArea, ref->size);
+				m_areaDataStates[otherArea].chargedModels.append(areaState.modelIndexes[i]);
+			}
+
+			continue;
+		}
+
+		m_models->OnModelFreed(ref);
+
+		if (ref->model && ref->ownsModel)
+			Memory::free(ref->model);
+
+		ref->model = nullptr;
+		ref->ownsModel = false;
+		ref->baseInstance = nullptr;
+		ref->userData = nullptr;
+	}
+
+	areaState.modelIndexes.clear();
+	areaState.chargedModels.clear();
+	areaState.chargedTPages.clear();
+
+	m_residentBytes -= areaState.residentBytes;
+	areaState.residentBytes = 0;
+}
+
 void CBaseLevelMap::SetLoadingCallbacks(OnRegionLoaded_t onLoaded, OnRegionFreed_t onFreed)
 {
 	m_onRegionLoaded = onLoaded;
@@ -12,16 +12,38 @@ class IVirtualStream;
 
 class CBaseLevelRegion;
 class CBaseLevelMap;
+class CTexturePage;
 
 typedef void (*OnRegionLoaded_t)(CBaseLevelRegion* region);
 typedef void (*OnRegionFreed_t)(CBaseLevelRegion* region);
 
 //----------------------------------------------------------------------------------
 
+// loading notifications collected while spooling off the main thread
+struct SPOOL_NOTIFY_LIST
+{
+	Array<CTexturePage*>		tpages;
+	Array<ModelRef_t*>			models;
+	Array<CBaseLevelRegion*>	regions;
+};
+
 struct SPOOL_CONTEXT
 {
 	IVirtualStream*			dataStream;
 	OUT_CITYLUMP_INFO*		lumpInfo;
+	SPOOL_NOTIFY_LIST*		deferredNotify{ nullptr };		// when set, loading callbacks are collected here instead of being called
+};
+
+// area data (super region) cache entry
+struct AREA_DATA_STATE
+{
+	Array<ushort>			modelIndexes;		// spooled models referenced by this area
+	Array<ushort>			chargedModels;		// shared models counted in residentBytes of this area
+	Array<int>				chargedTPages;		// shared texture pages counted in residentBytes of this area
+	int						refCount{ 0 };		// resident regions using this area
+	int						residentBytes{ 0 };	// heap memory held by area texture pages and models
+	uint					lastUseTick{ 0 };
+	bool					loaded{ false };	// unreferenced areas stay loaded until trimmed
 };
 
 struct CELL_ITERATOR_CACHE
@@ -45,6 +67,10 @@ public:
 
 	bool					IsEmpty() const;
 	int						GetNumber() const;
+	const Spool*			GetSpoolInfo() const { return m_spoolInfo; }
+
+	// heap memory held by loaded region data (data viewed from mapped file is not counted)
+	int						GetResidentBytes() const;
 
 	CELL_OBJECT*			GetCellObject(int num) const;
 
@@ -62,6 +88,9 @@ protected:
 	int						m_regionZ{ -1 };
 	int						m_regionNumber{ -1 };
 	int						m_regionBarrelNumber{ -1 };		// required for cell iterator slots
+	int						m_residentBytes{ 0 };
+	uint					m_lastUseTick{ 0 };				// region cache LRU
+	bool					m_areaDataAcquired{ false };
 	bool					m_loaded{ false };
 };
 
@@ -101,6 +130,33 @@ public:
 	bool						SpoolRegion(const SPOOL_CONTEXT& ctx, const XZPAIR& cell);
 	bool						SpoolRegion(const SPOOL_CONTEXT& ctx, int regionIdx);
 
+	// calls loading callbacks collected by deferred spooling and clears the list
+	void						DispatchSpoolNotify(SPOOL_NOTIFY_LIST& list);
+
+	//----------------------------------------
+	// resident region cache
+
+	void						SetRegionCacheBudget(int64 budgetBytes);	// 0 means unlimited
+	int64						GetRegionCacheBudget() const;
+
+	// regions and their area data
+	int64						GetResidentBytes() const;
+	int64						GetPeakResidentBytes() const;
+	int							GetResidentRegionCount() const;
+
+	// marks region as used since last trim so it won't be evicted
+	void						TouchRegion(int regionIdx);
+
+	// frees least recently used regions and then unreferenced area data until resident bytes fit the budget
+	int							TrimRegionCache(Array<int>* evictedRegions = nullptr);
+
+	//----------------------------------------
+	// area data cache
+
+	int							GetAreaDataRefCount(int areaDataNum) const;
+	int							GetAreaCacheHits() const;
+	int							GetAreaCacheMisses() const;
+
 	int							GetRegionIndex(const XZPAIR& cell) const;
 
 	bool						IsRegionSpooled(const XZPAIR& cell) const;
@@ -129,6 +185,17 @@ protected:
 	void						OnRegionLoaded(CBaseLevelRegion* region);
 	void						OnRegionFreed(CBaseLevelRegion* region);
 
+	void						AddResidentRegion(CBaseLevelRegion* region);
+	void						RemoveResidentRegion(CBaseLevelRegion* region);
+
+	void						AcquireAreaData(const SPOOL_CONTEXT& ctx, int areaDataNum);
+	void						ReleaseAreaData(int areaDataNum);
+	void						FreeAreaData(int areaDataNum);
+	void						TrimAreaDataCache();
+	int							FindAreaUsingTPage(int pageIndex) const;
+	int							FindAreaUsingModel(int modelIndex) const;
+	void						MoveAreaResidentBytes(AREA_DATA_STATE& from, int toAreaNum, int numBytes);
+
 	// shared
 	OUT_CELL_FILE_HEADER		m_mapInfo;
 
@@ -142,7 +209,9 @@ protected:
 	
 	AreaDataStr*				m_areaData{ nullptr };					// region model/texture data descriptors
 	AreaTpageList*				m_areaTPages{ nullptr };				// region texpage usage table
-	bool*						m_areaDataStates{ nullptr };			// area data loading states
+	AREA_DATA_STATE*			m_areaDataStates{ nullptr };			// area data reference counts
+	int							m_areaCacheHits{ 0 };
+	int							m_areaCacheMisses{ 0 };
 
 	int							m_numStraddlers{ 0 };
 	
@@ -159,6 +228,12 @@ protected:
 
 	CELL_OBJECT*				m_straddlers{ nullptr };
 
+	Array<CBaseLevelRegion*>	m_residentRegions;
+	int64						m_residentBytes{ 0 };
+	int64						m_peakResidentBytes{ 0 };
+	int64						m_regionCacheBudget{ 0 };
+	uint						m_regionUseTick{ 0 };
+
 	OnRegionLoaded_t			m_onRegionLoaded{ nullptr };
 	OnRegionFreed_t				m_onRegionFreed{ nullptr };
 };
@@ -60,6 +60,8 @@ void CDriver1LevelRegion::LoadRegionData(const SPOOL_CONTEXT& ctx)
 	const int cellObjectsOffset = cellDataOffset + m_spoolInfo->cell_data_size[0];
 	const int pvsDataOffset = cellObjectsOffset + m_spoolInfo->cell_data_size[2]; // FIXME: is it even there in Driver 1?
 
+	m_residentBytes = 0;
+
 	// read roadm (map?)
 	pFile->Seek(ctx.lumpInfo->spooled_offset + roadMOffset * SPOOL_CD_BLOCK_SIZE, VS_SEEK_SET);
 	LoadRoadCellsData(pFile);
@@ -72,6 +74,7 @@ void CDriver1LevelRegion::LoadRegionData(const SPOOL_CONTEXT& ctx)
 
 	m_cellPointers = new ushort[m_owner->m_cell_objects_add[5]];
 	memset(m_cellPointers, 0xFF, sizeof(ushort) * m_owner->m_cell_objects_add[5]);
+	m_residentBytes += sizeof(ushort) * m_owner->m_cell_objects_add[5];
 
 	// read packed cell pointers
 	pFile->Seek(ctx.lumpInfo->spooled_offset + cellPointersOffset * SPOOL_CD_BLOCK_SIZE, VS_SEEK_SET);
@@ -89,6 +92,9 @@ void CDriver1LevelRegion::LoadRegionData(const SPOOL_CONTEXT& ctx)
 		m_cellObjects = (CELL_OBJECT*)Memory::alloc(m_spoolInfo->cell_data_size[2] * SPOOL_CD_BLOCK_SIZE * 2);
 		pFile->Seek(ctx.lumpInfo->spooled_offset + cellObjectsOffset * SPOOL_CD_BLOCK_SIZE, VS_SEEK_SET);
 		pFile->Read(m_cellObjects, m_spoolInfo->cell_data_size[2] * SPOOL_CD_BLOCK_SIZE, sizeof(char));
+
+		m_residentBytes += m_spoolInfo->cell_data_size[0] * SPOOL_CD_BLOCK_SIZE;
+		m_residentBytes += m_spoolInfo->cell_data_size[2] * SPOOL_CD_BLOCK_SIZE * 2;
 	}
 	else
 		MsgError("BAD PACKED CELL POINTER DATA, region = %d\n", m_regionNumber);
@@ -98,7 +104,10 @@ void CDriver1LevelRegion::LoadRegionData(const SPOOL_CONTEXT& ctx)
 	// even if error occured we still need it to be here
 	m_loaded = true;
 
-	m_owner->OnRegionLoaded(this);
+	if (ctx.deferredNotify)
+		ctx.deferredNotify->regions.append(this);
+	else
+		m_owner->OnRegionLoaded(this);
 
 	// TODO: PVS and heightmap data
 }
@@ -119,6 +128,7 @@ void CDriver1LevelRegion::LoadRoadHeightMapData(IVirtualStream* pFile)
 	// road map is in cell size
 	m_roadMap = new uint[double_region_size * double_region_size];
 	memset(m_roadMap, 0, sizeof(m_roadMap));
+	m_residentBytes += sizeof(uint) * double_region_size * double_region_size;
 
 	uint* src = (uint*)roadMapData;
 	uint* pRoadMap = m_roadMap;
@@ -143,6 +153,7 @@ void CDriver1LevelRegion::LoadRoadHeightMapData(IVirtualStream* pFile)
 void CDriver1LevelRegion::LoadRoadCellsData(IVirtualStream* pFile)
 {
 	m_surfaceRoads = new ushort[ROAD_MAP_REGION_CELLS];
+	m_residentBytes += sizeof(ushort) * ROAD_MAP_REGION_CELLS;
 	ushort* pRoadIds = m_surfaceRoads;
 	int i = ROAD_MAP_REGION_CELLS;
 
@@ -341,13 +341,15 @@ void CDriver2LevelRegion::FreeAll()
 
 	CBaseLevelRegion::FreeAll();
 
-	if (m_cells)
+	if (m_cells && m_ownsCells)
 		Memory::free(m_cells);
 	m_cells = nullptr;
+	m_ownsCells = false;
 
-	if (m_packedCellObjects)
+	if (m_packedCellObjects && m_ownsPackedCellObjects)
 		Memory::free(m_packedCellObjects);
 	m_packedCellObjects = nullptr;
+	m_ownsPackedCellObjects = false;
 
 	if (m_pvsData)
 		Memory::free(m_pvsData);
@@ -404,6 +406,8 @@ void CDriver2LevelRegion::LoadRegionData(const SPOOL_CONTEXT& ctx)
 	m_cellPointers = new ushort[m_owner->m_cell_objects_add[5]];
 	memset(m_cellPointers, 0xFF, sizeof(ushort) * m_owner->m_cell_objects_add[5]);
 
+	m_residentBytes = sizeof(ushort) * m_owner->m_cell_objects_add[5];
+
 	// read packed cell pointers
 	pFile->Seek(ctx.lumpInfo->spooled_offset + cellPointersOffset * SPOOL_CD_BLOCK_SIZE, VS_SEEK_SET);
 	pFile->Read(packed_cell_pointers, m_spoolInfo->cell_data_size[1] * SPOOL_CD_BLOCK_SIZE, sizeof(char));
@@ -411,15 +415,32 @@ void CDriver2LevelRegion::LoadRegionData(const SPOOL_CONTEXT& ctx)
 	// unpack cell pointers so we can use them
 	if (UnpackCellPointers(m_cellPointers, packed_cell_pointers, 0, 0) != -1)
 	{
-		// read cell data
-		m_cells = (CELL_DATA*)Memory::alloc(m_spoolInfo->cell_data_size[0] * SPOOL_CD_BLOCK_SIZE);
+		const int cellDataSize = m_spoolInfo->cell_data_size[0] * SPOOL_CD_BLOCK_SIZE;
+		const int cellObjectsSize = m_spoolInfo->cell_data_size[2] * SPOOL_CD_BLOCK_SIZE;
+
+		// read cell data, view it in place if file is mapped
 		pFile->Seek(ctx.lumpInfo->spooled_offset + cellDataOffset * SPOOL_CD_BLOCK_SIZE, VS_SEEK_SET);
-		pFile->Read(m_cells, m_spoolInfo->cell_data_size[0] * SPOOL_CD_BLOCK_SIZE, sizeof(char));
+		m_cells = (CELL_DATA*)pFile->GetMappedPointer(cellDataSize);
+		m_ownsCells = m_cells == nullptr;
+
+		if (m_ownsCells)
+		{
+			m_cells = (CELL_DATA*)Memory::alloc(cellDataSize);
+			pFile->Read(m_cells, cellDataSize, sizeof(char));
+			m_residentBytes += cellDataSize;
+		}
 
 		// read cell objects
-		m_packedCellObjects = (PACKED_CELL_OBJECT*)Memory::alloc(m_spoolInfo->cell_data_size[2] * SPOOL_CD_BLOCK_SIZE);
 		pFile->Seek(ctx.lumpInfo->spooled_offset + cellObjectsOffset * SPOOL_CD_BLOCK_SIZE, VS_SEEK_SET);
-		pFile->Read(m_packedCellObjects, m_spoolInfo->cell_data_size[2] * SPOOL_CD_BLOCK_SIZE, sizeof(char));
+		m_packedCellObjects = (PACKED_CELL_OBJECT*)pFile->GetMappedPointer(cellObjectsSize);
+		m_ownsPackedCellObjects = m_packedCellObjects == nullptr;
+
+		if (m_ownsPackedCellObjects)
+		{
+			m_packedCellObjects = (PACKED_CELL_OBJECT*)Memory::alloc(cellObjectsSize);
+			pFile->Read(m_packedCellObjects, cellObjectsSize, sizeof(char));
+			m_residentBytes += cellObjectsSize;
+		}
 	}
 	else
 		MsgError("BAD PACKED CELL POINTER DATA, region = %d\n", m_regionNumber);
@@ -437,7 +458,10 @@ void CDriver2LevelRegion::LoadRegionData(const SPOOL_CONTEXT& ctx)
 	// even if error occured we still need it to be here
 	m_loaded = true;
 
-	m_owner->OnRegionLoaded(this);
+	if (ctx.deferredNotify)
+		ctx.deferredNotify->regions.append(this);
+	else
+		m_owner->OnRegionLoaded(this);
 }
 
 //---------------------------------------------------------------------
@@ -451,6 +475,7 @@ void CDriver2LevelRegion::UnpackAllCellObjects()
 	// alloc and convert
 	m_cellObjects = (CELL_OBJECT*)Memory::alloc(numCellObjects * sizeof(CELL_OBJECT));
 	memset(m_cellObjects, 0, numCellObjects * sizeof(CELL_OBJECT));
+	m_residentBytes += numCellObjects * sizeof(CELL_OBJECT);
 
 	const OUT_CELL_FILE_HEADER& mapInfo = owner->GetMapInfo();
 	const int numStraddlers = owner->m_numStraddlers;
@@ -493,6 +518,7 @@ void CDriver2LevelRegion::ReadHeightmapData(const SPOOL_CONTEXT& ctx)
 
 	int pvsDataSize = 0;
 	m_pvsData = (char*)Memory::alloc(m_spoolInfo->roadm_size * SPOOL_CD_BLOCK_SIZE);
+	m_residentBytes += m_spoolInfo->roadm_size * SPOOL_CD_BLOCK_SIZE;
 
 	if (m_owner->m_format == LEV_FORMAT_DRIVER2_RETAIL) // retail do have PVS data in the start
 		pFile->Read(&pvsDataSize, 1, sizeof(int));
@@ -119,6 +119,9 @@ protected:
 	CELL_DATA*				m_cells{ nullptr };					// cell data that holding information about cell pointers. 3D world seeks cells first here
 	PACKED_CELL_OBJECT*		m_packedCellObjects{ nullptr };		// cell objects that represents objects placed in the world
 
+	bool					m_ownsCells{ false };				// false when viewed in place from mapped LEV file
+	bool					m_ownsPackedCellObjects{ false };
+
 	char*					m_pvsData{ nullptr };
 
 	sdPlane*				m_planeData{ nullptr };
@@ -0,0 +1,294 @@
+#include "spooler.h"
+
+#include <string.h>
+
+#include "core/cmdlib.h"
+#include "core/IVirtualStream.h"
+
+CRegionSpooler::CRegionSpooler()
+{
+}
+
+CRegionSpooler::~CRegionSpooler()
+{
+	Stop();
+}
+
+//-------------------------------------------------------------
+// Starts worker thread
+//-------------------------------------------------------------
+bool CRegionSpooler::Start(CBaseLevelMap* map, IVirtualStream* stream, OUT_CITYLUMP_INFO* lumpInfo)
+{
+	Stop();
+
+	if (!map || !stream)
+		return false;
+
+	m_map = map;
+	m_spoolContext.dataStream = stream;
+	m_spoolContext.lumpInfo = lumpInfo;
+
+	m_numRegions = map->GetRegionsAcross() * map->GetRegionsDown();
+	m_regionStates = new ubyte[m_numRegions];
+	memset(m_regionStates, SPOOL_STATE_NONE, m_numRegions);
+
+	m_quit = false;
+	m_loadingRegion = -1;
+
+	if (!m_thread.start(*this, &CRegionSpooler::WorkerProc))
+	{
+		MsgError("Unable to start region spooler thread!\n");
+
+		delete[] m_regionStates;
+		m_regionStates = nullptr;
+		m_numRegions = 0;
+		m_map = nullptr;
+		return false;
+	}
+
+	m_started = true;
+	return true;
+}
+
+//-------------------------------------------------------------
+// Stops worker thread and drops not yet published regions
+// Loaded region data is still owned by map
+//-------------------------------------------------------------
+void CRegionSpooler::Stop()
+{
+	if (!m_started)
+		return;
+
+	m_mutex.lock();
+	m_quit = true;
+	m_queue.clear();
+	m_mutex.unlock();
+
+	m_queueSignal.signal();
+	m_thread.join();
+
+	m_started = false;
+
+	// regions that were loaded still need their callbacks
+	Update();
+
+	m_loadedRegions.clear();
+
+	delete[] m_regionStates;
+	m_regionStates = nullptr;
+	m_numRegions = 0;
+	m_map = nullptr;
+}
+
+bool CRegionSpooler::IsStarted() const
+{
+	return m_started;
+}
+
+//-------------------------------------------------------------
+// Queues region for loading if not requested before
+//-------------------------------------------------------------
+bool CRegionSpooler::RequestRegion(int regionIdx, float eta)
+{
+	if (regionIdx < 0 || regionIdx >= m_numRegions)
+		return false;
+
+	// only main thread changes NONE and READY states
+	const ubyte state = m_regionStates[regionIdx];
+
+	if (state == SPOOL_STATE_READY)
+	{
+		m_map->TouchRegion(regionIdx);
+		return true;
+	}
+
+	SPOOL_REQUEST request;
+	request.regionIdx = regionIdx;
+	request.eta = eta;
+
+	if (state == SPOOL_STATE_QUEUED)
+	{
+		// move it forward if needed sooner
+		Mutex::Guard guard(m_mutex);
+
+		for (usize i = 0; i < m_queue.size(); i++)
+		{
+			if (m_queue[i].regionIdx != regionIdx)
+				continue;
+
+			if (eta < m_queue[i].eta)
+			{
+				m_queue.remove(i);
+				InsertRequest(request);
+			}
+			break;
+		}
+
+		return false;
+	}
+
+	if (state != SPOOL_STATE_NONE)
+		return false;
+
+	m_mutex.lock();
+	m_regionStates[regionIdx] = SPOOL_STATE_QUEUED;
+	InsertRequest(request);
+	m_mutex.unlock();
+
+	m_queueSignal.signal();
+
+	return false;
+}
+
+void CRegionSpooler::CancelPrefetch()
+{
+	if (!m_started)
+		return;
+
+	Mutex::Guard guard(m_mutex);
+
+	for (usize i = 0; i < m_queue.size();)
+	{
+		if (m_queue[i].eta > 0.0f)
+		{
+			m_regionStates[m_queue[i].regionIdx] = SPOOL_STATE_NONE;
+			m_queue.remove(i);
+		}
+		else
+			i++;
+	}
+}
+
+// must be called with locked mutex
+void CRegionSpooler::InsertRequest(const SPOOL_REQUEST& request)
+{
+	usize pos = 0;
+	while (pos < m_queue.size() && m_queue[pos].eta <= request.eta)
+		pos++;
+
+	m_queue.append(request);
+
+	for (usize i = m_queue.size() - 1; i > pos; i--)
+		m_queue[i] = m_queue[i - 1];
+
+	m_queue[pos] = request;
+}
+
+bool CRegionSpooler::IsRegionReady(int regionIdx) const
+{
+	if (regionIdx < 0 || regionIdx >= m_numRegions)
+		return false;
+
+	return m_regionStates[regionIdx] == SPOOL_STATE_READY;
+}
+
+//-------------------------------------------------------------
+// Calls loading callbacks for regions loaded by worker
+//-------------------------------------------------------------
+void CRegionSpooler::Update()
+{
+	if (!m_map)
+		return;
+
+	SPOOL_NOTIFY_LIST notify;
+	Array<int> loadedRegions;
+	Array<int> evictedRegions;
+
+	m_mutex.lock();
+	notify.tpages.swap(m_loadedNotify.tpages);
+	notify.models.swap(m_loadedNotify.models);
+	notify.regions.swap(m_loadedNotify.regions);
+	loadedRegions.swap(m_loadedRegions);
+
+	// evict least recently used regions while worker is not touching the map
+	// regions loaded but not yet published were used at current tick and are kept
+	if (m_loadingRegion == -1)
+		m_map->TrimRegionCache(&evictedRegions);
+	m_mutex.unlock();
+
+	for (usize i = 0; i < evictedRegions.size(); i++)
+		m_regionStates[evictedRegions[i]] = SPOOL_STATE_NONE;
+
+	m_map->DispatchSpoolNotify(notify);
+
+	for (usize i = 0; i < loadedRegions.size(); i++)
+		m_regionStates[loadedRegions[i]] = SPOOL_STATE_READY;
+}
+
+//-------------------------------------------------------------
+// Waits until worker becomes idle
+//-------------------------------------------------------------
+void CRegionSpooler::Flush()
+{
+	if (!m_started)
+		return;
+
+	for (;;)
+	{
+		m_mutex.lock();
+		const bool busy = !m_queue.isEmpty() || m_loadingRegion != -1;
+		m_mutex.unlock();
+
+		if (!busy)
+			break;
+
+		Thread::yield();
+	}
+
+	Update();
+}
+
+//-------------------------------------------------------------
+// Worker thread
+//-------------------------------------------------------------
+uint CRegionSpooler::WorkerProc()
+{
+	SPOOL_NOTIFY_LIST notify;
+
+	SPOOL_CONTEXT spoolContext = m_spoolContext;
+	spoolContext.deferredNotify = &notify;
+
+	for (;;)
+	{
+		m_queueSignal.wait();
+
+		m_mutex.lock();
+
+		if (m_quit)
+		{
+			m_mutex.unlock();
+			break;
+		}
+
+		if (m_queue.isEmpty())
+		{
+			m_mutex.unlock();
+			continue;
+		}
+
+		const int regionIdx = m_queue[0].regionIdx;
+		m_queue.remove(0);
+
+		m_loadingRegion = regionIdx;
+		m_regionStates[regionIdx] = SPOOL_STATE_LOADING;
+		m_mutex.unlock();
+
+		m_map->SpoolRegion(spoolContext, regionIdx);
+
+		m_mutex.lock();
+		m_loadedNotify.tpages.append(notify.tpages, notify.tpages.size());
+		m_loadedNotify.models.append(notify.models, notify.models.size());
+		m_loadedNotify.regions.append(notify.regions, notify.regions.size());
+		m_loadedRegions.append(regionIdx);
+
+		m_regionStates[regionIdx] = SPOOL_STATE_LOADED;
+		m_loadingRegion = -1;
+		m_mutex.unlock();
+
+		notify.tpages.clear();
+		notify.models.clear();
+		notify.regions.clear();
+	}
+
+	return 0;
+}
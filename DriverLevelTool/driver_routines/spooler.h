@@ -0,0 +1,82 @@
+#ifndef SPOOLER_H
+#define SPOOLER_H
+
+#include <nstd/Array.hpp>
+#include <nstd/Mutex.hpp>
+#include <nstd/Semaphore.hpp>
+#include <nstd/Thread.hpp>
+
+#include "regions.h"
+
+//----------------------------------------------------------------------------------
+// Background region spooler
+// Loads regions and their area data on a worker thread using it's own stream,
+// loading callbacks are called on the thread calling Update()
+//----------------------------------------------------------------------------------
+
+enum ERegionSpoolState
+{
+	SPOOL_STATE_NONE = 0,		// not requested
+	SPOOL_STATE_QUEUED,			// waiting for worker
+	SPOOL_STATE_LOADING,		// worker is reading it
+	SPOOL_STATE_LOADED,			// loaded, waiting for Update() to publish it
+	SPOOL_STATE_READY,			// published, safe to use by main thread
+};
+
+struct SPOOL_REQUEST
+{
+	int					regionIdx;
+	float				eta;			// estimated time until region is needed, 0 means now
+};
+
+class CRegionSpooler
+{
+public:
+	CRegionSpooler();
+	virtual ~CRegionSpooler();
+
+	// stream must be opened on same level file and must stay open until map data is freed
+	bool				Start(CBaseLevelMap* map, IVirtualStream* stream, OUT_CITYLUMP_INFO* lumpInfo);
+	void				Stop();
+
+	bool				IsStarted() const;
+
+	// queues region for loading, returns true if region is ready for use
+	// requests are served in order of estimated time the region is needed
+	bool				RequestRegion(int regionIdx, float eta = 0.0f);
+	bool				IsRegionReady(int regionIdx) const;
+
+	// drops queued requests that are not needed right now
+	void				CancelPrefetch();
+
+	// publishes regions loaded by worker. Must be called from main thread
+	void				Update();
+
+	// waits for all queued regions and publishes them
+	void				Flush();
+
+protected:
+	uint				WorkerProc();
+
+	void				InsertRequest(const SPOOL_REQUEST& request);
+
+	CBaseLevelMap*		m_map{ nullptr };
+	SPOOL_CONTEXT		m_spoolContext;
+
+	Thread				m_thread;
+	Mutex				m_mutex;
+	Semaphore			m_queueSignal;
+	bool				m_started{ false };
+	bool				m_quit{ false };
+
+	// guarded by m_mutex
+	Array<SPOOL_REQUEST>	m_queue;			// sorted by eta
+	Array<int>			m_loadedRegions;
+	SPOOL_NOTIFY_LIST	m_loadedNotify;
+	int					m_loadingRegion{ -1 };
+
+	ubyte*				m_regionStates{ nullptr };
+	int					m_numRegions{ 0 };
+};
+
+#endif // SPOOLER_H
@@ -1,10 +1,14 @@
 ﻿#include "core/cmdlib.h"
 #include "core/IVirtualStream.h"
 #include "math/Vector.h"
+#include "util/image.h"
+#include "util/parallel.h"
 #include "util/rnc2.h"
+#include "util/util.h"
 
 #include <string.h>
 
+#include <nstd/Array.hpp>
 #include <nstd/String.hpp>
 #include <nstd/Math.hpp>
 
@@ -99,35 +103,36 @@ void CTexturePage::ConvertIndexedTextureToRGBA(uint* dest_color_data, int detail
 	const int w = texInfo.width ? texInfo.width : TEXPAGE_SIZE_Y;	// 0 means full size
 	const int h = texInfo.height ? texInfo.height : TEXPAGE_SIZE_Y;
 
-	const int tp_wx = ox + w;
 	const int tp_hy = oy + h;
 
+	// only 16 colors to convert
+	uint palette[16];
+	rgb5a1_ExpandCLUT(palette, clut->colors, 16, outputBGR, originalTransparencyKey);
+
 	for (int y = oy; y < tp_hy; y++)
 	{
-		for (int x = ox; x < tp_wx; x++)
-		{
-			ubyte clindex = bitmap.data[y * TEXPAGE_SIZE_X + x / 2];
+		// flip texture by Y
+		const int ypos = (TEXPAGE_SIZE_Y - y - 1) * TEXPAGE_SIZE_Y;
 
-			if (0 != (x & 1))
-				clindex >>= 4;
+		ExpandIndexed4bppRow(dest_color_data + ypos + ox, bitmap.data + y * TEXPAGE_SIZE_X, ox, w, palette);
+	}
+}
 
-			clindex &= 15;
+//-------------------------------------------------------------
+// Dump of whole page indexes
+//-------------------------------------------------------------
+void CTexturePage::ConvertIndexesToRGBA(uint* dest_color_data)
+{
+	uint palette[16];
 
-			// flip texture by Y
-			const int ypos = (TEXPAGE_SIZE_Y - y - 1) * TEXPAGE_SIZE_Y;
+	for (int i = 0; i < 16; i++)
+		palette[i] = i * 32;
 
-			if(outputBGR)
-			{
-				TVec4D<ubyte> color = rgb5a1_ToBGRA8(clut->colors[clindex], originalTransparencyKey);
-				dest_color_data[ypos + x] = *(uint*)(&color);
-			}
-			else
-			{
-				TVec4D<ubyte> color = rgb5a1_ToRGBA8(clut->colors[clindex], originalTransparencyKey);
-				dest_color_data[ypos + x] = *(uint*)(&color);
-			}
+	for (int y = 0; y < TEXPAGE_SIZE_Y; y++)
+	{
+		const int ypos = (TEXPAGE_SIZE_Y - y - 1) * TEXPAGE_SIZE_Y;
 
-		}
+		ExpandIndexed4bppRow(dest_color_data + ypos, m_bitmap.data + y * TEXPAGE_SIZE_X, 0, TEXPAGE_SIZE_Y, palette);
 	}
 }
 
@@ -193,7 +198,7 @@ void CTexturePage::LoadCompressedTexture(IVirtualStream* pFile)
 //-------------------------------------------------------------------------------
 // Loads Texture page itself with it's color lookup tables
 //-------------------------------------------------------------------------------
-bool CTexturePage::LoadTPageAndCluts(IVirtualStream* pFile, bool isSpooled)
+bool CTexturePage::LoadTPageAndCluts(IVirtualStream* pFile, bool isSpooled, bool notify)
 {
 	int rStart = pFile->Tell();
 
@@ -232,11 +237,40 @@ bool CTexturePage::LoadTPageAndCluts(IVirtualStream* pFile, bool isSpooled)
 	m_bitmap.rsize = pFile->Tell() - rStart;
 	DevMsg(SPEW_NORM, "PAGE %d (%s) datasize=%d\n", m_id, isSpooled ? "spooled" : "compressed", m_bitmap.rsize);
 
-	m_owner->OnTexturePageLoaded(this);
+	if (notify)
+		m_owner->OnTexturePageLoaded(this);
 	
 	return true;
 }
 
+//-------------------------------------------------------------------------------
+// Loads compressed texture page with it's color lookup tables from memory
+// Data must be followed by padding as unpacker may read beyond the page
+//-------------------------------------------------------------------------------
+int CTexturePage::LoadCompressedTPage(const ubyte* data)
+{
+	if (m_bitmap.data)
+		return m_bitmap.rsize;
+
+	const ubyte* src = data;
+
+	memcpy(&m_bitmap.numPalettes, src, sizeof(int));
+	src += sizeof(int);
+
+	m_bitmap.clut = new TEXCLUT[m_bitmap.numPalettes];
+	memcpy(m_bitmap.clut, src, sizeof(TEXCLUT) * m_bitmap.numPalettes);
+	src += sizeof(TEXCLUT) * m_bitmap.numPalettes;
+
+	m_bitmap.data = new ubyte[TEXPAGE_4BIT_SIZE];
+
+	char* unpackEnd = unpackTexture((char*)src, (char*)m_bitmap.data);
+
+	m_bitmap.rsize = unpackEnd - (char*)data;
+	DevMsg(SPEW_NORM, "PAGE %d (compressed) datasize=%d\n", m_id, m_bitmap.rsize);
+
+	return m_bitmap.rsize;
+}
+
 //-------------------------------------------------------------------------------
 // searches for detail in this TPAGE
 //-------------------------------------------------------------------------------
@@ -246,7 +280,7 @@ TexDetailInfo_t* CTexturePage::FindTextureDetail(const char* name) const
 	{
 		const char* pTexName = m_owner->GetTextureDetailName(&m_details[i].info);
 
-		if (!strcmp(pTexName, name)) // FIXME: hashing and case insensitive?
+		if (!stricmp(pTexName, name))
 			return &m_details[i];
 	}
 
@@ -291,50 +325,100 @@ CDriverLevelTextures::~CDriverLevelTextures()
 //
 // loads global textures (pre-loading stage)
 //
-void CDriverLevelTextures::LoadPermanentTPages(IVirtualStream* pFile)
+struct TPageUnpackJob_t
+{
+	CTexturePage*	tpage;
+	long			offset;		// in tpage block
+};
+
+struct TPageUnpackJobs_t
+{
+	Array<TPageUnpackJob_t>	jobs;
+	ubyte*					blockData{ nullptr };
+};
+
+static void UnpackTPageJob(void* userData, int jobIndex)
+{
+	TPageUnpackJobs_t& ctx = *(TPageUnpackJobs_t*)userData;
+	TPageUnpackJob_t& job = ctx.jobs[jobIndex];
+
+	job.tpage->LoadCompressedTPage(ctx.blockData + job.offset);
+}
+
+static void AddTPageUnpackJob(TPageUnpackJobs_t& ctx, CTexturePage* tpage, long offset)
+{
+	// already loaded pages are skipped
+	if (tpage->GetBitmap().data)
+		return;
+
+	for (usize i = 0; i < ctx.jobs.size(); i++)
+	{
+		if (ctx.jobs[i].tpage == tpage)
+			return;
+	}
+
+	TPageUnpackJob_t job;
+	job.tpage = tpage;
+	job.offset = offset;
+
+	ctx.jobs.append(job);
+}
+
+void CDriverLevelTextures::LoadPermanentTPages(IVirtualStream* pFile, int numThreads)
 {
 	DevMsg(SPEW_NORM,"Loading permanent texture pages (%d)\n", m_numPermanentPages);
 
 	// simulate sectors
 	// convert current file offset to sectors
-	long sector = pFile->Tell() / SPOOL_CD_BLOCK_SIZE;
+	const long blockStart = pFile->Tell();
+	long sector = blockStart / SPOOL_CD_BLOCK_SIZE;
 	int nsectors = 0;
 
 	for (int i = 0; i < m_numPermanentPages; i++)
 		nsectors += (m_permsList[i].y + SPOOL_CD_BLOCK_SIZE-1) / SPOOL_CD_BLOCK_SIZE;
-	
-	// load permanent pages
-	for(int i = 0; i < m_numPermanentPages; i++)
-	{
-		long curOfs = pFile->Tell(); 
-		int tpage = m_permsList[i].x;
-
-		// permanents are also compressed
-		m_texPages[tpage].LoadTPageAndCluts(pFile, false);
-
-		pFile->Seek(curOfs + ((m_permsList[i].y + SPOOL_CD_BLOCK_SIZE-1) & -SPOOL_CD_BLOCK_SIZE), VS_SEEK_SET);
-	}
-
-	// simulate sectors
-	sector += nsectors;
-	pFile->Seek(sector * SPOOL_CD_BLOCK_SIZE, VS_SEEK_SET);
 
 	// Driver 2 - special cars only
 	// Driver 1 - only player cars
 	DevMsg(SPEW_NORM, "Loading special/car texture pages (%d)\n", m_numSpecPages);
 
-	// load compressed spec pages
-	// those are non-spooled ones
-	for (int i = 0; i < m_numSpecPages; i++)
+	// page offsets are known so all of them are read at once and unpacked on worker threads
+	TPageUnpackJobs_t ctx;
+	ctx.jobs.reserve(m_numPermanentPages + m_numSpecPages);
+
+	long offset = 0;
+
+	for (int i = 0; i < m_numPermanentPages; i++)
 	{
-		long curOfs = pFile->Tell();
-		int tpage = m_specList[i].x;
+		AddTPageUnpackJob(ctx, &m_texPages[m_permsList[i].x], offset);
+		offset += (m_permsList[i].y + SPOOL_CD_BLOCK_SIZE-1) & -SPOOL_CD_BLOCK_SIZE;
+	}
 
-		// permanents are compressed
-		m_texPages[tpage].LoadTPageAndCluts(pFile, false);
+	// special pages start at next sector after permanents
+	offset = (sector + nsectors) * SPOOL_CD_BLOCK_SIZE - blockStart;
 
-		pFile->Seek(curOfs + ((m_specList[i].y + SPOOL_CD_BLOCK_SIZE-1) & -SPOOL_CD_BLOCK_SIZE), VS_SEEK_SET);
+	for (int i = 0; i < m_numSpecPages; i++)
+	{
+		AddTPageUnpackJob(ctx, &m_texPages[m_specList[i].x], offset);
+		offset += (m_specList[i].y + SPOOL_CD_BLOCK_SIZE-1) & -SPOOL_CD_BLOCK_SIZE;
 	}
+
+	const long blockSize = offset;
+
+	// padding keeps unpacker of broken pages inside buffer
+	ctx.blockData = new ubyte[blockSize + TEXPAGE_4BIT_SIZE];
+	memset(ctx.blockData, 0, blockSize + TEXPAGE_4BIT_SIZE);
+
+	pFile->Read(ctx.blockData, 1, blockSize);
+
+	RunParallelJobs(ctx.jobs.size(), numThreads, UnpackTPageJob, &ctx);
+
+	delete[] ctx.blockData;
+
+	// loading callbacks are called from this thread in loading order
+	for (usize i = 0; i < ctx.jobs.size(); i++)
+		OnTexturePageLoaded(ctx.jobs[i].tpage);
+
+	pFile->Seek(blockStart + blockSize, VS_SEEK_SET);
 }
 
 void CDriverLevelTextures::LoadTextureLumpD1Demo(IVirtualStream* pFile)
@@ -398,6 +482,8 @@ void CDriverLevelTextures::LoadTextureLumpD1Demo(IVirtualStream* pFile)
 		// permanents are also compressed
 		m_texPages[i].LoadTPageAndCluts(pFile, false);
 	}
+
+	BuildDetailNameIndex();
 }
 
 //-------------------------------------------------------------
@@ -440,6 +526,8 @@ void CDriverLevelTextures::LoadTextureInfoLump(IVirtualStream* pFile)
 	pFile->Read(m_specList, 16, sizeof(XYPAIR));
 
 	DevMsg(SPEW_NORM,"Special/Car TPages = %d\n", m_numSpecPages);
+
+	BuildDetailNameIndex();
 }
 
 //-------------------------------------------------------------
@@ -463,6 +551,8 @@ void CDriverLevelTextures::LoadTextureNamesLump(IVirtualStream* pFile, int size)
 
 		sz += len + 1;
 	} while (sz < size);
+
+	BuildDetailNameIndex();
 }
 
 void CDriverLevelTextures::LoadOverlayMapLump(IVirtualStream* pFile, int lumpSize)
@@ -567,17 +657,39 @@ void CDriverLevelTextures::LoadPalletLump(IVirtualStream* pFile)
 
 //----------------------------------------------------------------------------------------------------
 
-TexDetailInfo_t* CDriverLevelTextures::FindTextureDetail(const char* name) const
+//-------------------------------------------------------------
+// Indexes texture details by name once both texture info
+// and names are loaded. First detail wins as with page scan
+//-------------------------------------------------------------
+void CDriverLevelTextures::BuildDetailNameIndex()
 {
-	for(int i = 0; i < m_numTexPages; i++)
+	m_detailNameIndex.clear();
+
+	if (!m_textureNamesData || !m_texPages)
+		return;
+
+	for (int i = 0; i < m_numTexPages; i++)
 	{
-		TexDetailInfo_t* found = m_texPages[i].FindTextureDetail(name);
+		CTexturePage& tp = m_texPages[i];
 
-		if (found)
-			return found;
+		for (int j = 0; j < tp.m_numDetails; j++)
+		{
+			String name = String::fromCString(GetTextureDetailName(&tp.m_details[j].info)).toLowerCase();
+
+			if (!m_detailNameIndex.contains(name))
+				m_detailNameIndex.append(name, &tp.m_details[j]);
+		}
 	}
+}
 
-	return nullptr;
+TexDetailInfo_t* CDriverLevelTextures::FindTextureDetail(const char* name) const
+{
+	HashMap<String, TexDetailInfo_t*>::Iterator it = m_detailNameIndex.find(String::fromCString(name).toLowerCase());
+
+	if (it == m_detailNameIndex.end())
+		return nullptr;
+
+	return *it;
 }
 
 // returns texture name
@@ -604,44 +716,43 @@ void CDriverLevelTextures::GetOverlayMapSegmentRGBA(TVec4D<ubyte>* destination,
 
 	UnpackRNC(m_overlayMapData + offsets[index], mapBuffer);
 
+	uint palette[16];
+	rgb5a1_ExpandCLUT(palette, clut, 16, bgra, true);
+
 	// convert to RGBA
 	for (int y = 0; y < 32; y++)
-	{
-		for (int x = 0; x < 32; x++)
-		{
-			int px, py;
-
-			ubyte colorIndex = (ubyte)mapBuffer[y * 16 + x / 2];
-
-			if (0 != (x & 1))
-				colorIndex >>= 4;
-
-			colorIndex &= 0xf;
-
-			destination[y * 32 + x] = bgra ? rgb5a1_ToBGRA8(clut[colorIndex]) : rgb5a1_ToRGBA8(clut[colorIndex]);
-		}
-	}
+		ExpandIndexed4bppRow((uint*)&destination[y * 32], (ubyte*)mapBuffer + y * 16, 0, 32, palette);
 }
 
 // computes overlay map segment count
 int	CDriverLevelTextures::GetOverlayMapSegmentCount() const
 {
-	ushort* offsets = (ushort*)m_overlayMapData;
 	int numValid = 0;
 
 	// max offset count for overlay map is 256, next is palette
 	for (int i = 0; i < 256; i++)
 	{
-		char* rncData = m_overlayMapData + offsets[i];
-		if (rncData[0] == 'R' && rncData[1] == 'N' && rncData[2] == 'C')
-		{
+		if (GetOverlayMapSegmentData(i))
 			numValid++;
-		}
 	}
 
 	return numValid;
 }
 
+char* CDriverLevelTextures::GetOverlayMapSegmentData(int index) const
+{
+	if (!m_overlayMapData || index < 0 || index >= 256)
+		return nullptr;
+
+	ushort* offsets = (ushort*)m_overlayMapData;
+	char* rncData = m_overlayMapData + offsets[index];
+
+	if (rncData[0] == 'R' && rncData[1] == 'N' && rncData[2] == 'C')
+		return rncData;
+
+	return nullptr;
+}
+
 // release all data
 void CDriverLevelTextures::FreeAll()
 {
@@ -659,6 +770,8 @@ void CDriverLevelTextures::FreeAll()
 	m_numPermanentPages = 0;
 	m_numSpecPages = 0;
 	m_numExtraPalettes = 0;
+
+	m_detailNameIndex.clear();
 }
 
 // getters
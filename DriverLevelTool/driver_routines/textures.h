@@ -4,6 +4,9 @@
 #ifndef TEXTURES_H
 #define TEXTURES_H
 
+#include <nstd/HashMap.hpp>
+#include <nstd/String.hpp>
+
 #include "level.h"
 #include "math/Vector.h"
 #include "math/psx_math_types.h"
@@ -61,13 +64,19 @@ public:
 	void					InitFromFile(int id, TEXPAGE_POS& tp, IVirtualStream* pFile);
 	
 	// loading texture page from lump
-	bool					LoadTPageAndCluts(IVirtualStream* pFile, bool isSpooled);
+	bool					LoadTPageAndCluts(IVirtualStream* pFile, bool isSpooled, bool notify = true);
+
+	// loading compressed texture page from memory, returns size of used data. Doesn't notify
+	int						LoadCompressedTPage(const ubyte* data);
 
 	// converting 4bit texture page to 32 bit full color RGBA/BGRA
 	void					ConvertIndexedTextureToRGBA(uint* dest_color_data, 
 												int detail, TEXCLUT* clut = nullptr,
 												bool outputBGR = false, bool originalTransparencyKey = true);
 
+	// writes whole page indexes as (index * 32) colors, shows texels not covered by details
+	void					ConvertIndexesToRGBA(uint* dest_color_data);
+
 	// searches for detail in this TPAGE
 	TexDetailInfo_t*		FindTextureDetail(const char* name) const;
 	TexDetailInfo_t*		GetTextureDetail(int num) const;
@@ -98,6 +107,7 @@ protected:
 class CDriverLevelTextures
 {
 	friend class CTexturePage;
+	friend class CBaseLevelMap;
 public:
 	CDriverLevelTextures();
 	virtual ~CDriverLevelTextures();
@@ -111,7 +121,7 @@ public:
 	//----------------------------------------
 	// loaders
 	void					LoadTextureInfoLump(IVirtualStream* pFile);
-	void					LoadPermanentTPages(IVirtualStream* pFile);
+	void					LoadPermanentTPages(IVirtualStream* pFile, int numThreads = 0);
 	void					LoadTextureLumpD1Demo(IVirtualStream* pFile);
 	void					LoadTextureNamesLump(IVirtualStream* pFile, int size);
 	void					LoadOverlayMapLump(IVirtualStream* pFile, int size);
@@ -131,13 +141,19 @@ public:
 	void					GetOverlayMapSegmentRGBA(TVec4D<ubyte>* destination, int index, bool bgra = false) const;
 	int						GetOverlayMapSegmentCount() const;
 
+	// returns RNC packed overlay map segment, nullptr if segment is not valid
+	char*					GetOverlayMapSegmentData(int index) const;
+
 protected:
 	void					OnTexturePageLoaded(CTexturePage* tp);
 	void					OnTexturePageFreed(CTexturePage* tp);
+
+	void					BuildDetailNameIndex();
 	
 	ELevelFormat			m_format;
 
 	char*					m_textureNamesData{ nullptr };
+	HashMap<String, TexDetailInfo_t*>	m_detailNameIndex;		// lowercase name to detail
 
 	CTexturePage*			m_texPages{ nullptr };
 	int						m_numTexPages{ 0 };
@@ -0,0 +1,360 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "driver_level.h"
+#include "driver_routines/models.h"
+#include "driver_routines/regions_d1.h"
+#include "driver_routines/regions_d2.h"
+
+#include "core/cmdlib.h"
+#include "core/VirtualStream.h"
+#include "math/Matrix.h"
+
+#include <nstd/Time.hpp>
+
+extern bool g_export_worldUnityScript;
+
+struct UnityRegionAsset_t;
+
+// export_regions.cpp
+int ExportRegionDriver1(LevelContext_t& level, CDriver1LevelRegion* region, IVirtualStream* levelFileStream, UnityRegionAsset_t* unityAsset, const ModelExportFilters& filters, int& lobj_first_v, int& lobj_first_t,
+	WriteMDLToObjStream_t writeModel);
+int ExportRegionDriver2(LevelContext_t& level, CDriver2LevelRegion* region, IVirtualStream* levelFileStream, UnityRegionAsset_t* unityAsset, const ModelExportFilters& filters, int& lobj_first_v, int& lobj_first_t,
+	WriteMDLToObjStream_t writeModel);
+
+//-------------------------------------------------------------
+// writes Wavefront OBJ into stream using Print
+// Old writer, only kept as baseline for -benchobj
+//-------------------------------------------------------------
+static void WriteMDLToObjStreamPrint(IVirtualStream* pStream, CDriverLevelModels* levModels, MODEL* model, int modelSize, int model_index, const char* name_prefix,
+	bool debugInfo,
+	const Matrix4x4& translation,
+	int* first_v,
+	int* first_t)
+{
+	if (!model)
+	{
+		MsgError("no model %d!!!\n", model_index);
+		return;
+	}
+
+	// export OBJ with points
+	if (debugInfo)
+		pStream->Print("#vert count %d\r\n", model->num_vertices);
+
+	pStream->Print("g %s\r\n", name_prefix);
+	pStream->Print("o %s\r\n", name_prefix);
+
+	MODEL* vertex_ref = model;
+
+	if (model->instance_number > 0) // car models have vertex_ref=0
+	{
+		if(debugInfo)
+			pStream->Print("#vertex data ref model: %d (count = %d)\r\n", model->instance_number, model->num_vertices);
+
+		ModelRef_t* ref = levModels ? levModels->GetModelByIndex(model->instance_number) : nullptr;
+
+		if (!ref)
+		{
+			Msg("vertex ref not found %d\n", model->instance_number);
+			return;
+		}
+
+		vertex_ref = ref->model;
+	}
+
+	// export scaling
+	Vector3D export_scale(-EXPORT_SCALING, -EXPORT_SCALING, EXPORT_SCALING);
+	bool flipFaces = true;
+
+	if(g_export_worldUnityScript)
+	{
+		export_scale = Vector3D(-EXPORT_SCALING, -EXPORT_SCALING, -EXPORT_SCALING);
+		flipFaces = false;
+	}
+	
+	// store vertices
+	for (int i = 0; i < vertex_ref->num_vertices; i++)
+	{
+		SVECTOR* vert = vertex_ref->pVertex(i);
+		Vector3D sfVert = Vector3D(vert->x, vert->y, vert->z) * export_scale;
+
+		sfVert = (translation * Vector4D(sfVert, 1.0f)).xyz();
+
+		pStream->Print("v %g %g %g\r\n", 
+			sfVert.x,
+			sfVert.y,
+			sfVert.z);
+	}
+
+	// store GT3/GT4 vertex normals
+	for (int i = 0; i < vertex_ref->num_point_normals; i++)
+	{
+		SVECTOR* norm = vertex_ref->pPointNormal(i);
+		Vector3D sfNorm = Vector3D(norm->x, norm->y, norm->z) * export_scale;
+
+		pStream->Print("vn %g %g %g\r\n", 
+			sfNorm.x,
+			sfNorm.y,
+			sfNorm.z);
+	}
+
+	if (debugInfo)
+	{
+		pStream->Print("#poly ofs %d\r\n", model->poly_block);
+		pStream->Print("#poly count %d\r\n", model->num_polys);
+	}
+
+	pStream->Print("usemtl none\r\n");
+
+	char formatted_vertex[512];
+	int numVertCoords = 0;
+	int numVerts = 0;
+
+	if (first_t)
+		numVertCoords = *first_t;
+
+	if (first_v)
+		numVerts = *first_v;
+
+	bool prevSmooth = false;
+	int prev_tpage = -1;
+
+	int face_ofs = 0;
+	dpoly_t dec_face;
+
+	// go through all polygons
+	for (int i = 0; i < model->num_polys; i++)
+	{
+		char* facedata = model->pPolyAt(face_ofs);
+
+		// check offset
+		if ((ubyte*)facedata >= (ubyte*)model + modelSize)
+		{
+			MsgError("MDL %d poly id=%d type=%d ofs=%d bad offset!\n", model_index, i, *facedata & 31, model->poly_block + face_ofs);
+			break;
+		}
+		
+		int poly_size = decode_poly(facedata, &dec_face);
+
+		// check poly size
+		if (poly_size == 0)
+		{
+			MsgError("MDL %d poly id=%d type=%d ofs=%d zero size!\n", model_index, i, *facedata & 31, model->poly_block + face_ofs);
+			break;
+		}
+
+		face_ofs += poly_size;
+		
+		if (debugInfo)
+			pStream->Print("# ft=%d ofs=%d size=%d\r\n", *facedata & 31, model->poly_block + face_ofs, poly_size);
+
+		int numPolyVerts = (dec_face.flags & FACE_IS_QUAD) ? 4 : 3;
+		bool bad_face = false;
+		bool bad_normals = false;
+
+		// perform vertex checks
+		for (int v = 0; v < numPolyVerts; v++)
+		{
+			if (dec_face.vindices[v] >= vertex_ref->num_vertices)
+			{
+				bad_face = true;
+				break;
+			}
+
+			// also check normals
+			if (dec_face.flags & FACE_VERT_NORMAL)
+			{
+				if (dec_face.nindices[v] >= vertex_ref->num_point_normals)
+				{
+					bad_normals = true;
+					break;
+				}
+			}
+		}
+
+		if (bad_face)
+		{
+			MsgError("MDL %d poly id=%d type=%d ofs=%d has invalid indices (or format is unknown)\n", model_index, i, *facedata & 31, model->poly_block + face_ofs);
+
+			continue;
+		}
+
+		if (dec_face.flags & FACE_TEXTURED)
+		{
+			if(prev_tpage != dec_face.page)
+				pStream->Print("usemtl page_%d\r\n", dec_face.page);
+
+			prev_tpage = dec_face.page;
+		}
+		else
+		{
+			if(prev_tpage != -1)
+				pStream->Print("usemtl none\r\n");
+
+			prev_tpage = -1;
+		}
+
+		bool smooth = (dec_face.flags & FACE_VERT_NORMAL);
+
+		// Gouraud-shaded poly smoothing
+		if(smooth != prevSmooth)
+		{
+			pStream->Print("s %s\r\n", smooth ? "1" : "off");
+			prevSmooth = smooth;
+		}
+
+		// start new fresh face
+		strcpy(formatted_vertex, "f ");
+
+		for(int v = 0; v < numPolyVerts; v++)
+		{
+			char temp[64] = {0};
+			char vertex_value[64] = {0};
+
+			int VERT_IDX;
+			if(flipFaces)
+				VERT_IDX = numPolyVerts - 1 - v;
+			else
+				VERT_IDX = v;
+
+			// starting with vertex index
+			sprintf(temp, "%d", dec_face.vindices[VERT_IDX] + 1 + numVerts);
+			strcat(vertex_value, temp);
+
+			// dump texture coordinate
+			if (dec_face.flags & FACE_TEXTURED)
+			{
+				UV_INFO uv = *(UV_INFO*)dec_face.uv[VERT_IDX];
+
+				float fsU, fsV;
+				
+				// map to 0..1
+				fsU = ((float)uv.u + 0.5f) / 256.0f;
+				fsV = ((float)uv.v + 0.5f) / 256.0f;
+
+				pStream->Print("vt %g %g\r\n", fsU, 1.0f - fsV);
+
+				// add texture coordinate to face value
+				sprintf(temp, "/%d", numVertCoords + 1);
+				strcat(vertex_value, temp);
+
+				numVertCoords++;
+			}
+
+			// dump vertex normal
+			if(dec_face.flags & FACE_VERT_NORMAL)
+			{
+				if (!(dec_face.flags & FACE_TEXTURED))
+				{
+					strcat(vertex_value, "/");
+				}
+
+				// add vertex normal to face value
+				sprintf(temp, "/%d", dec_face.nindices[VERT_IDX] + 1 + numVerts);
+				strcat(vertex_value, temp);
+			}
+
+			// add a space
+			strcat(vertex_value, " ");
+
+			// concat the value
+			strcat(formatted_vertex, vertex_value);
+		}
+
+		// end the vertex
+		pStream->Print("%s\r\n", formatted_vertex);
+	}
+
+	if (first_t)
+		*first_t = numVertCoords;
+
+	if (first_v)
+		*first_v = numVerts + vertex_ref->num_vertices;
+
+	PrintUnknownPolys();
+}
+
+//-------------------------------------------------------------
+// Measures OBJ export throughput of old Print based writer
+// and buffered writer on a single region
+//-------------------------------------------------------------
+void BenchmarkRegionObjExport(LevelContext_t& level, int regionIdx)
+{
+	const int numRegions = level.map->GetRegionsAcross() * level.map->GetRegionsDown();
+
+	if (regionIdx < 0 || regionIdx >= numRegions)
+	{
+		MsgError("Invalid region %d, level has %d regions\n", regionIdx, numRegions);
+		return;
+	}
+
+	if (!level.stream)
+	{
+		MsgError("Unable to benchmark - level file is not opened!\n");
+		return;
+	}
+
+	SPOOL_CONTEXT spoolContext;
+	spoolContext.dataStream = level.stream;
+	spoolContext.lumpInfo = &level.info;
+
+	level.map->SpoolRegion(spoolContext, regionIdx);
+
+	CBaseLevelRegion* region = level.map->GetRegion(regionIdx);
+
+	if (region->IsEmpty())
+	{
+		MsgWarning("Region %d is empty\n", regionIdx);
+		return;
+	}
+
+	MsgInfo("Benchmarking OBJ export of region %d...\n", regionIdx);
+
+	ModelExportFilters filters;
+
+	CMemoryStream objStream;
+	objStream.Open(nullptr, VS_OPEN_WRITE, 16 * 1024 * 1024);
+
+	const char* writerNames[] = { "Print", "CObjWriter" };
+	WriteMDLToObjStream_t writers[] = { WriteMDLToObjStreamPrint, WriteMDLToObjStream };
+	double writerSeconds[2];
+
+	for (int i = 0; i < 2; i++)
+	{
+		int64 totalTicks = 0;
+		int iterations = 0;
+		long objSize = 0;
+
+		// run for about a second
+		do
+		{
+			objStream.Seek(0, VS_SEEK_SET);
+
+			int lobj_first_v = 0;
+			int lobj_first_t = 0;
+
+			const int64 startTicks = Time::microTicks();
+
+			if (level.map->GetFormat() >= LEV_FORMAT_DRIVER2_ALPHA16)
+				ExportRegionDriver2(level, (CDriver2LevelRegion*)region, &objStream, nullptr, filters, lobj_first_v, lobj_first_t, writers[i]);
+			else
+				ExportRegionDriver1(level, (CDriver1LevelRegion*)region, &objStream, nullptr, filters, lobj_first_v, lobj_first_t, writers[i]);
+
+			totalTicks += Time::microTicks() - startTicks;
+			iterations++;
+
+			objSize = objStream.Tell();
+		} while (totalTicks < 1000000 && iterations < 1000);
+
+		writerSeconds[i] = (double)totalTicks / 1000000.0 / iterations;
+
+		const double mbPerSecond = writerSeconds[i] > 0.0 ? (double)objSize / (1024.0 * 1024.0) / writerSeconds[i] : 0.0;
+
+		MsgInfo("  %-10s: %d bytes, %.2f ms per region, %.1f MB/s (%d runs)\n",
+			writerNames[i], objSize, writerSeconds[i] * 1000.0, mbPerSecond, iterations);
+	}
+
+	if (writerSeconds[1] > 0.0)
+		MsgAccept("CObjWriter is %.2fx faster\n", writerSeconds[0] / writerSeconds[1]);
+}
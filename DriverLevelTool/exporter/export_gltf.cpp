@@ -0,0 +1,609 @@
+#include "driver_level.h"
+#include "driver_routines/level.h"
+
+#include "core/cmdlib.h"
+#include "core/VirtualStream.h"
+#include <stdlib.h>
+#include <string.h>
+#include <nstd/Array.hpp>
+#include <nstd/File.hpp>
+
+#include "math/Matrix.h"
+
+#define GLTF_INSTANCING_MIN_COUNT	8		// models placed this many times are written with EXT_mesh_gpu_instancing
+
+#define GLTF_MESH_NOT_BUILT			-1
+#define GLTF_MESH_EMPTY				-2
+
+#define GLTF_UNTEXTURED_PAGE		256
+
+#define GLB_MAGIC					0x46546C67	// 'glTF'
+#define GLB_VERSION					2
+#define GLB_CHUNK_JSON				0x4E4F534A	// 'JSON'
+#define GLB_CHUNK_BIN				0x004E4942	// 'BIN\0'
+
+// glTF enums
+#define GLTF_UNSIGNED_SHORT			5123
+#define GLTF_UNSIGNED_INT			5125
+#define GLTF_FLOAT					5126
+
+#define GLTF_ARRAY_BUFFER			34962
+#define GLTF_ELEMENT_ARRAY_BUFFER	34963
+
+struct GLTFInstance_t
+{
+	int				mesh;
+	float			position[3];
+	float			rotation;		// around Y axis in radians
+};
+
+struct GLTFWorldExport_t
+{
+	LevelContext_t*				level{ nullptr };
+	const ModelExportFilters*	filters{ nullptr };
+
+	// BIN chunk and JSON arrays, joined when writing GLB
+	CMemoryStream				bin;
+	CMemoryStream				bufferViews;
+	CMemoryStream				accessors;
+	CMemoryStream				meshes;
+	CMemoryStream				materials;
+	CMemoryStream				nodes;
+
+	int							numBufferViews{ 0 };
+	int							numAccessors{ 0 };
+	int							numMeshes{ 0 };
+	int							numMaterials{ 0 };
+	int							numNodes{ 0 };
+	int							numInstancedNodes{ 0 };
+
+	int							meshForModel[MAX_MODELS];
+	int							materialForPage[GLTF_UNTEXTURED_PAGE + 1];
+	Array<int>					meshModels;
+
+	Array<GLTFInstance_t>		instances;
+};
+
+//-------------------------------------------------------------
+// Writes data into BIN chunk and adds buffer view for it
+//-------------------------------------------------------------
+static int AddBufferView(GLTFWorldExport_t& ctx, const void* data, int size, int target)
+{
+	// accessors need 4 byte alignment
+	const ubyte zero[4] = { 0 };
+	const int padding = (4 - ctx.bin.Tell() % 4) % 4;
+	ctx.bin.Write(zero, 1, padding);
+
+	const int offset = ctx.bin.Tell();
+	ctx.bin.Write(data, 1, size);
+
+	if (ctx.numBufferViews > 0)
+		ctx.bufferViews.Print(",");
+
+	if (target)
+		ctx.bufferViews.Print("{\"buffer\":0,\"byteOffset\":%d,\"byteLength\":%d,\"target\":%d}", offset, size, target);
+	else
+		ctx.bufferViews.Print("{\"buffer\":0,\"byteOffset\":%d,\"byteLength\":%d}", offset, size);
+
+	return ctx.numBufferViews++;
+}
+
+static int AddAccessor(GLTFWorldExport_t& ctx, int bufferView, int componentType, int count, const char* type, const Vector3D* bbMin = nullptr, const Vector3D* bbMax = nullptr)
+{
+	if (ctx.numAccessors > 0)
+		ctx.accessors.Print(",");
+
+	ctx.accessors.Print("{\"bufferView\":%d,\"componentType\":%d,\"count\":%d,\"type\":\"%s\"", bufferView, componentType, count, type);
+
+	// required for POSITION
+	if (bbMin && bbMax)
+	{
+		ctx.accessors.Print(",\"min\":[%.9g,%.9g,%.9g],\"max\":[%.9g,%.9g,%.9g]",
+			bbMin->x, bbMin->y, bbMin->z,
+			bbMax->x, bbMax->y, bbMax->z);
+	}
+
+	ctx.accessors.Print("}");
+
+	return ctx.numAccessors++;
+}
+
+//-------------------------------------------------------------
+// Returns material for texture page, adds it if needed
+//-------------------------------------------------------------
+static int GetPageMaterial(GLTFWorldExport_t& ctx, int page)
+{
+	if (ctx.materialForPage[page] != -1)
+		return ctx.materialForPage[page];
+
+	if (ctx.numMaterials > 0)
+		ctx.materials.Print(",");
+
+	// TGA can't be referenced as glTF image, texture path is kept in extras
+	if (page == GLTF_UNTEXTURED_PAGE)
+	{
+		ctx.materials.Print("{\"name\":\"none\",\"pbrMetallicRoughness\":{\"metallicFactor\":0}}");
+	}
+	else
+	{
+		String justLevFilename = File::basename(ctx.level->name, File::extension(ctx.level->name));
+
+		ctx.materials.Print("{\"name\":\"page_%d\",\"pbrMetallicRoughness\":{\"metallicFactor\":0},\"extras\":{\"texture\":\"%s_textures/PAGE_%d.tga\"}}",
+			page, (char*)justLevFilename, page);
+	}
+
+	ctx.materialForPage[page] = ctx.numMaterials++;
+	return ctx.materialForPage[page];
+}
+
+static const char* GetModelName(ModelRef_t* ref, char* buffer)
+{
+	if (ref->name && *ref->name)
+		return ref->name;
+
+	sprintf(buffer, "MOD_%d", ref->index);
+	return buffer;
+}
+
+//-------------------------------------------------------------
+// Writes model geometry as mesh, one primitive per texture page
+//-------------------------------------------------------------
+static int BuildModelMesh(GLTFWorldExport_t& ctx, ModelRef_t* ref)
+{
+	MODEL* model = ref->model;
+	MODEL* vertex_ref = model;
+
+	if (model->instance_number > 0)
+	{
+		ModelRef_t* vertexRef = ctx.level->models.GetModelByIndex(model->instance_number);
+
+		if (!vertexRef || !vertexRef->model)
+		{
+			Msg("vertex ref not found %d\n", model->instance_number);
+			return GLTF_MESH_EMPTY;
+		}
+
+		vertex_ref = vertexRef->model;
+	}
+
+	// decode and validate faces
+	Array<dpoly_t> faces;
+	faces.reserve(model->num_polys);
+
+	int face_ofs = 0;
+
+	for (int i = 0; i < model->num_polys; i++)
+	{
+		char* facedata = model->pPolyAt(face_ofs);
+
+		if ((ubyte*)facedata >= (ubyte*)model + ref->size)
+			break;
+
+		dpoly_t dec_face;
+		int poly_size = decode_poly(facedata, &dec_face);
+
+		if (poly_size == 0)
+			break;
+
+		face_ofs += poly_size;
+
+		int numPolyVerts = (dec_face.flags & FACE_IS_QUAD) ? 4 : 3;
+		bool bad_face = false;
+
+		for (int v = 0; v < numPolyVerts; v++)
+		{
+			if (dec_face.vindices[v] >= vertex_ref->num_vertices)
+				bad_face = true;
+
+			if ((dec_face.flags & FACE_VERT_NORMAL) && dec_face.nindices[v] >= vertex_ref->num_point_normals)
+				dec_face.flags &= ~FACE_VERT_NORMAL;
+		}
+
+		if (!bad_face)
+			faces.append(dec_face);
+	}
+
+	PrintUnknownPolys();
+
+	if (faces.isEmpty())
+		return GLTF_MESH_EMPTY;
+
+	const Vector3D export_scale(-EXPORT_SCALING, -EXPORT_SCALING, EXPORT_SCALING);
+
+	char nameBuffer[32];
+
+	if (ctx.numMeshes > 0)
+		ctx.meshes.Print(",");
+
+	ctx.meshes.Print("{\"name\":\"%s\",\"primitives\":[", GetModelName(ref, nameBuffer));
+
+	bool pageDone[GLTF_UNTEXTURED_PAGE + 1] = { false };
+	int numPrimitives = 0;
+
+	Array<Vector3D> positions;
+	Array<Vector3D> normals;
+	Array<Vector2D> texcoords;
+	Array<uint> indices;
+
+	for (usize f = 0; f < faces.size(); f++)
+	{
+		const int page = (faces[f].flags & FACE_TEXTURED) ? faces[f].page : GLTF_UNTEXTURED_PAGE;
+
+		if (pageDone[page])
+			continue;
+
+		pageDone[page] = true;
+
+		positions.clear();
+		normals.clear();
+		texcoords.clear();
+		indices.clear();
+
+		Vector3D bbMin(V_MAX_COORD);
+		Vector3D bbMax(-V_MAX_COORD);
+
+		// collect all faces of this page
+		for (usize j = f; j < faces.size(); j++)
+		{
+			const dpoly_t& face = faces[j];
+			const int facePage = (face.flags & FACE_TEXTURED) ? face.page : GLTF_UNTEXTURED_PAGE;
+
+			if (facePage != page)
+				continue;
+
+			const int numPolyVerts = (face.flags & FACE_IS_QUAD) ? 4 : 3;
+			const uint firstVertex = positions.size();
+
+			// same winding as OBJ export
+			for (int v = 0; v < numPolyVerts; v++)
+			{
+				const int VERT_IDX = numPolyVerts - 1 - v;
+
+				SVECTOR* vert = vertex_ref->pVertex(face.vindices[VERT_IDX]);
+				Vector3D position = Vector3D(vert->x, vert->y, vert->z) * export_scale;
+
+				for (int c = 0; c < 3; c++)
+				{
+					if (position[c] < bbMin[c]) bbMin[c] = position[c];
+					if (position[c] > bbMax[c]) bbMax[c] = position[c];
+				}
+
+				positions.append(position);
+
+				if (page != GLTF_UNTEXTURED_PAGE)
+				{
+					UV_INFO uv = *(UV_INFO*)face.uv[VERT_IDX];
+					texcoords.append(Vector2D(((float)uv.u + 0.5f) / 256.0f, ((float)uv.v + 0.5f) / 256.0f));
+				}
+			}
+
+			Vector3D faceNormal = cross(positions[firstVertex + 1] - positions[firstVertex], positions[firstVertex + 2] - positions[firstVertex]);
+
+			if (lengthSqr(faceNormal) > 0.0f)
+				faceNormal = normalize(faceNormal);
+			else
+				faceNormal = Vector3D(0.0f, 1.0f, 0.0f);
+
+			for (int v = 0; v < numPolyVerts; v++)
+			{
+				const int VERT_IDX = numPolyVerts - 1 - v;
+
+				if (face.flags & FACE_VERT_NORMAL)
+				{
+					SVECTOR* norm = vertex_ref->pPointNormal(face.nindices[VERT_IDX]);
+					Vector3D normal = Vector3D(norm->x, norm->y, norm->z) * export_scale;
+
+					normals.append(lengthSqr(normal) > 0.0f ? normalize(normal) : faceNormal);
+				}
+				else
+					normals.append(faceNormal);
+			}
+
+			indices.append(firstVertex);
+			indices.append(firstVertex + 1);
+			indices.append(firstVertex + 2);
+
+			if (numPolyVerts == 4)
+			{
+				indices.append(firstVertex);
+				indices.append(firstVertex + 2);
+				indices.append(firstVertex + 3);
+			}
+		}
+
+		const int numVerts = positions.size();
+
+		const int positionView = AddBufferView(ctx, &positions[0], numVerts * sizeof(Vector3D), GLTF_ARRAY_BUFFER);
+		const int positionAccessor = AddAccessor(ctx, positionView, GLTF_FLOAT, numVerts, "VEC3", &bbMin, &bbMax);
+
+		const int normalView = AddBufferView(ctx, &normals[0], numVerts * sizeof(Vector3D), GLTF_ARRAY_BUFFER);
+		const int normalAccessor = AddAccessor(ctx, normalView, GLTF_FLOAT, numVerts, "VEC3");
+
+		int indexAccessor;
+
+		if (numVerts <= 65535)
+		{
+			Array<ushort> shortIndices;
+			shortIndices.resize(indices.size());
+
+			for (usize i = 0; i < indices.size(); i++)
+				shortIndices[i] = indices[i];
+
+			const int indexView = AddBufferView(ctx, &shortIndices[0], shortIndices.size() * sizeof(ushort), GLTF_ELEMENT_ARRAY_BUFFER);
+			indexAccessor = AddAccessor(ctx, indexView, GLTF_UNSIGNED_SHORT, shortIndices.size(), "SCALAR");
+		}
+		else
+		{
+			const int indexView = AddBufferView(ctx, &indices[0], indices.size() * sizeof(uint), GLTF_ELEMENT_ARRAY_BUFFER);
+			indexAccessor = AddAccessor(ctx, indexView, GLTF_UNSIGNED_INT, indices.size(), "SCALAR");
+		}
+
+		if (numPrimitives > 0)
+			ctx.meshes.Print(",");
+
+		ctx.meshes.Print("{\"attributes\":{\"POSITION\":%d,\"NORMAL\":%d", positionAccessor, normalAccessor);
+
+		if (page != GLTF_UNTEXTURED_PAGE)
+		{
+			const int texcoordView = AddBufferView(ctx, &texcoords[0], numVerts * sizeof(Vector2D), GLTF_ARRAY_BUFFER);
+			const int texcoordAccessor = AddAccessor(ctx, texcoordView, GLTF_FLOAT, numVerts, "VEC2");
+
+			ctx.meshes.Print(",\"TEXCOORD_0\":%d", texcoordAccessor);
+		}
+
+		ctx.meshes.Print("},\"indices\":%d,\"material\":%d}", indexAccessor, GetPageMaterial(ctx, page));
+
+		numPrimitives++;
+	}
+
+	ctx.meshes.Print("]}");
+
+	ctx.meshModels.append(ref->index);
+
+	return ctx.numMeshes++;
+}
+
+//-------------------------------------------------------------
+// Adds cell object as mesh instance, mesh is written on first use
+//-------------------------------------------------------------
+static void AddCellObjectInstance(void* userData, const CELL_OBJECT& co, int regionIdx, int cellIdx)
+{
+	GLTFWorldExport_t& ctx = *(GLTFWorldExport_t*)userData;
+
+	ModelRef_t* ref = ctx.level->models.GetModelByIndex(co.type);
+
+	if (!ref || !ref->model)
+		return;
+
+	if (!ctx.filters->Check(ref->model))
+		return;
+
+	// models may be freed with their regions so geometry is written right away
+	int mesh = ctx.meshForModel[co.type];
+
+	if (mesh == GLTF_MESH_NOT_BUILT)
+		mesh = ctx.meshForModel[co.type] = BuildModelMesh(ctx, ref);
+
+	if (mesh < 0)
+		return;
+
+	GLTFInstance_t instance;
+	instance.mesh = mesh;
+	instance.position[0] = co.pos.vx * -EXPORT_SCALING;
+	instance.position[1] = co.pos.vy * -EXPORT_SCALING;
+	instance.position[2] = co.pos.vz * EXPORT_SCALING;
+	instance.rotation = co.yang / 64.0f * PI_F * 2.0f;
+
+	ctx.instances.append(instance);
+}
+
+//-------------------------------------------------------------
+// Writes nodes for all mesh instances
+// Models placed many times get a single EXT_mesh_gpu_instancing node
+//-------------------------------------------------------------
+static void WriteInstanceNodes(GLTFWorldExport_t& ctx)
+{
+	qsort(&ctx.instances[0], ctx.instances.size(), sizeof(GLTFInstance_t), [](const void* a, const void* b) {
+		return ((GLTFInstance_t*)a)->mesh - ((GLTFInstance_t*)b)->mesh;
+	});
+
+	Array<float> translations;
+	Array<float> rotations;
+
+	char nameBuffer[32];
+
+	usize first = 0;
+	while (first < ctx.instances.size())
+	{
+		const int mesh = ctx.instances[first].mesh;
+
+		usize last = first;
+		while (last < ctx.instances.size() && ctx.instances[last].mesh == mesh)
+			last++;
+
+		const int count = last - first;
+		const char* name = GetModelName(ctx.level->models.GetModelByIndex(ctx.meshModels[mesh]), nameBuffer);
+
+		if (count >= GLTF_INSTANCING_MIN_COUNT)
+		{
+			translations.clear();
+			rotations.clear();
+
+			for (usize i = first; i < last; i++)
+			{
+				const GLTFInstance_t& instance = ctx.instances[i];
+
+				float sinA, cosA;
+				SinCos(instance.rotation * 0.5f, &sinA, &cosA);
+
+				translations.append(instance.position, 3);
+
+				// rotateY4 turns the other way than glTF Y rotation
+				const float rotation[4] = { 0.0f, -sinA, 0.0f, cosA };
+				rotations.append(rotation, 4);
+			}
+
+			const int translationView = AddBufferView(ctx, &translations[0], translations.size() * sizeof(float), 0);
+			const int translationAccessor = AddAccessor(ctx, translationView, GLTF_FLOAT, count, "VEC3");
+
+			const int rotationView = AddBufferView(ctx, &rotations[0], rotations.size() * sizeof(float), 0);
+			const int rotationAccessor = AddAccessor(ctx, rotationView, GLTF_FLOAT, count, "VEC4");
+
+			if (ctx.numNodes > 0)
+				ctx.nodes.Print(",");
+
+			ctx.nodes.Print("{\"name\":\"%s\",\"mesh\":%d,\"extensions\":{\"EXT_mesh_gpu_instancing\":{\"attributes\":{\"TRANSLATION\":%d,\"ROTATION\":%d}}}}",
+				name, mesh, translationAccessor, rotationAccessor);
+
+			ctx.numNodes++;
+			ctx.numInstancedNodes++;
+		}
+		else
+		{
+			for (usize i = first; i < last; i++)
+			{
+				const GLTFInstance_t& instance = ctx.instances[i];
+
+				float sinA, cosA;
+				SinCos(instance.rotation * 0.5f, &sinA, &cosA);
+
+				if (ctx.numNodes > 0)
+					ctx.nodes.Print(",");
+
+				ctx.nodes.Print("{\"name\":\"%s\",\"mesh\":%d,\"translation\":[%.9g,%.9g,%.9g],\"rotation\":[0,%.9g,0,%.9g]}",
+					name, mesh, instance.position[0], instance.position[1], instance.position[2], -sinA, cosA);
+
+				ctx.numNodes++;
+			}
+		}
+
+		first = last;
+	}
+}
+
+static void WriteJsonArray(CMemoryStream& json, const char* name, CMemoryStream& items)
+{
+	json.Print("\"%s\":[", name);
+	json.Write(items.GetBasePointer(), 1, items.Tell());
+	json.Print("],");
+}
+
+//-------------------------------------------------------------
+// Joins JSON and BIN chunks into GLB file
+//-------------------------------------------------------------
+static bool WriteGLB(GLTFWorldExport_t& ctx, const char* filename)
+{
+	String levNameOnly = File::basename(ctx.level->name, File::extension(ctx.level->name));
+
+	CMemoryStream json;
+	json.Open(nullptr, VS_OPEN_WRITE, 1024 * 1024);
+
+	json.Print("{\"asset\":{\"version\":\"2.0\",\"generator\":\"DriverLevelTool\"},");
+
+	if (ctx.numInstancedNodes > 0)
+		json.Print("\"extensionsUsed\":[\"EXT_mesh_gpu_instancing\"],");
+
+	json.Print("\"scene\":0,\"scenes\":[{\"name\":\"%s\",\"nodes\":[", (char*)levNameOnly);
+
+	for (int i = 0; i < ctx.numNodes; i++)
+		json.Print(i > 0 ? ",%d" : "%d", i);
+
+	json.Print("]}],");
+
+	WriteJsonArray(json, "nodes", ctx.nodes);
+	WriteJsonArray(json, "meshes", ctx.meshes);
+	WriteJsonArray(json, "materials", ctx.materials);
+	WriteJsonArray(json, "accessors", ctx.accessors);
+	WriteJsonArray(json, "bufferViews", ctx.bufferViews);
+
+	// chunks must be 4 byte aligned
+	const ubyte zero[4] = { 0 };
+	ctx.bin.Write(zero, 1, (4 - ctx.bin.Tell() % 4) % 4);
+
+	json.Print("\"buffers\":[{\"byteLength\":%d}]}", ctx.bin.Tell());
+
+	while (json.Tell() % 4)
+		json.Write(" ", 1, 1);
+
+	FILE* fp = fopen(filename, "wb");
+
+	if (!fp)
+	{
+		MsgError("Unable to create '%s'\n", filename);
+		return false;
+	}
+
+	const uint jsonLength = json.Tell();
+	const uint binLength = ctx.bin.Tell();
+
+	const uint header[3] = { GLB_MAGIC, GLB_VERSION, 12 + 8 + jsonLength + 8 + binLength };
+	const uint jsonChunk[2] = { jsonLength, GLB_CHUNK_JSON };
+	const uint binChunk[2] = { binLength, GLB_CHUNK_BIN };
+
+	fwrite(header, sizeof(header), 1, fp);
+	fwrite(jsonChunk, sizeof(jsonChunk), 1, fp);
+	fwrite(json.GetBasePointer(), 1, jsonLength, fp);
+	fwrite(binChunk, sizeof(binChunk), 1, fp);
+	fwrite(ctx.bin.GetBasePointer(), 1, binLength, fp);
+
+	fclose(fp);
+
+	MsgInfo("Written %d bytes\n", header[2]);
+
+	return true;
+}
+
+//-------------------------------------------------------------
+// Exports whole world into single GLB file
+// Each model is written once and cell objects are placed as instances
+//-------------------------------------------------------------
+void ExportWorldGLTF(LevelContext_t& level, const ModelExportFilters& filters)
+{
+	MsgInfo("Exporting world as instanced glTF...\n");
+
+	if (!level.stream)
+	{
+		MsgError("Unable to export world - level file is not opened!\n");
+		return;
+	}
+
+	GLTFWorldExport_t* ctx = new GLTFWorldExport_t();
+	ctx->level = &level;
+	ctx->filters = &filters;
+
+	ctx->bin.Open(nullptr, VS_OPEN_WRITE, 16 * 1024 * 1024);
+	ctx->bufferViews.Open(nullptr, VS_OPEN_WRITE | VS_OPEN_TEXT, 1024 * 1024);
+	ctx->accessors.Open(nullptr, VS_OPEN_WRITE | VS_OPEN_TEXT, 1024 * 1024);
+	ctx->meshes.Open(nullptr, VS_OPEN_WRITE | VS_OPEN_TEXT, 1024 * 1024);
+	ctx->materials.Open(nullptr, VS_OPEN_WRITE | VS_OPEN_TEXT, 64 * 1024);
+	ctx->nodes.Open(nullptr, VS_OPEN_WRITE | VS_OPEN_TEXT, 1024 * 1024);
+
+	for (int i = 0; i < MAX_MODELS; i++)
+		ctx->meshForModel[i] = GLTF_MESH_NOT_BUILT;
+
+	for (int i = 0; i <= GLTF_UNTEXTURED_PAGE; i++)
+		ctx->materialForPage[i] = -1;
+
+	ForEachWorldCellObject(level, AddCellObjectInstance, ctx);
+
+	if (ctx->instances.isEmpty())
+	{
+		MsgWarning("No models to export\n");
+	}
+	else
+	{
+		WriteInstanceNodes(*ctx);
+
+		String levNameOnly = File::basename(level.name, File::extension(level.name));
+		String filename = String::fromPrintf("%s/%s_world.glb", (char*)File::dirname(level.name), (char*)levNameOnly);
+
+		if (WriteGLB(*ctx, filename))
+		{
+			MsgInfo("%d meshes, %d instances, %d nodes (%d instanced)\n",
+				ctx->numMeshes, ctx->instances.size(), ctx->numNodes, ctx->numInstancedNodes);
+			MsgAccept("Successfully exported world to '%s'\n", (char*)filename);
+		}
+	}
+
+	delete ctx;
+}
@@ -0,0 +1,192 @@
+#include "export_manifest.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "core/cmdlib.h"
+#include "core/IVirtualStream.h"
+
+#include <nstd/Array.hpp>
+#include <nstd/File.hpp>
+
+#define FNV_PRIME_64				0x100000001b3ULL
+
+uint64 HashData(const void* data, int size, uint64 hash)
+{
+	const ubyte* bytes = (const ubyte*)data;
+
+	for (int i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= FNV_PRIME_64;
+	}
+
+	return hash;
+}
+
+uint64 HashStreamRange(IVirtualStream* stream, int offset, int size, uint64 hash)
+{
+	ubyte buffer[16384];
+
+	stream->Seek(offset, VS_SEEK_SET);
+
+	while (size > 0)
+	{
+		const int count = size > (int)sizeof(buffer) ? (int)sizeof(buffer) : size;
+
+		// read by bytes, so short read returns how much was read
+		const int numRead = (int)stream->Read(buffer, count, 1);
+
+		if (numRead <= 0)
+			break;
+
+		// range may be cut by end of file
+		hash = HashData(buffer, numRead, hash);
+
+		if (numRead < count)
+			break;
+
+		size -= count;
+	}
+
+	return hash;
+}
+
+//-------------------------------------------------------------
+
+CExportManifest::CExportManifest()
+{
+}
+
+//-------------------------------------------------------------
+// Loads manifest written by previous export
+//-------------------------------------------------------------
+void CExportManifest::Load(const char* filename, uint64 settingsHash)
+{
+	Mutex::Guard guard(m_mutex);
+
+	m_filename = String::fromCString(filename);
+	m_settingsHash = settingsHash;
+	m_entries.clear();
+	m_numSkipped = 0;
+	m_loaded = true;
+
+	FILE* fp = fopen(filename, "rb");
+
+	if (!fp)
+		return;
+
+	char line[512];
+	unsigned long long hash = 0;
+
+	// first line holds settings
+	if (!fgets(line, sizeof(line), fp) || sscanf(line, "settings %llx", &hash) != 1 || hash != settingsHash)
+	{
+		MsgInfo("Export settings changed, all items will be exported\n");
+		fclose(fp);
+		return;
+	}
+
+	while (fgets(line, sizeof(line), fp))
+	{
+		char key[512];
+
+		if (sscanf(line, "%llx %511s", &hash, key) != 2)
+			continue;
+
+		m_entries.append(String::fromCString(key), hash);
+	}
+
+	fclose(fp);
+
+	MsgInfo("Loaded export manifest with %d items\n", m_entries.size());
+}
+
+//-------------------------------------------------------------
+// Writes manifest of all exported items
+//-------------------------------------------------------------
+bool CExportManifest::Save()
+{
+	Mutex::Guard guard(m_mutex);
+
+	if (!m_loaded)
+		return false;
+
+	FILE* fp = fopen(m_filename, "wb");
+
+	if (!fp)
+	{
+		MsgError("Unable to write export manifest '%s'\n", (char*)m_filename);
+		return false;
+	}
+
+	fprintf(fp, "settings %llx\n", (unsigned long long)m_settingsHash);
+
+	// items are updated from worker threads, keep file same between runs
+	Array<const String*> keys;
+	keys.reserve(m_entries.size());
+
+	for (HashMap<String, uint64>::Iterator it = m_entries.begin(); it != m_entries.end(); ++it)
+		keys.append(&it.key());
+
+	if (keys.size())
+	{
+		qsort(&keys[0], keys.size(), sizeof(const String*), [](const void* a, const void* b) {
+			return strcmp(**(const String**)a, **(const String**)b);
+		});
+	}
+
+	for (usize i = 0; i < keys.size(); i++)
+		fprintf(fp, "%llx %s\n", (unsigned long long)*m_entries.find(*keys[i]), (const char*)*keys[i]);
+
+	fclose(fp);
+
+	if (m_numSkipped)
+		MsgInfo("%d items were not changed since last export\n", m_numSkipped);
+
+	return true;
+}
+
+void CExportManifest::SetForceExport(bool force)
+{
+	m_force = force;
+}
+
+bool CExportManifest::IsUpToDate(const char* key, uint64 hash, const char* outputFilename)
+{
+	if (m_force || !m_loaded)
+		return false;
+
+	{
+		Mutex::Guard guard(m_mutex);
+
+		HashMap<String, uint64>::Iterator it = m_entries.find(String::fromCString(key));
+
+		if (it == m_entries.end() || *it != hash)
+			return false;
+	}
+
+	// output might be deleted by user
+	if (!File::exists(String::fromCString(outputFilename)))
+		return false;
+
+	Mutex::Guard guard(m_mutex);
+	m_numSkipped++;
+
+	return true;
+}
+
+void CExportManifest::Update(const char* key, uint64 hash)
+{
+	if (!m_loaded)
+		return;
+
+	Mutex::Guard guard(m_mutex);
+	m_entries[String::fromCString(key)] = hash;
+}
+
+int CExportManifest::GetNumSkipped() const
+{
+	return m_numSkipped;
+}
@@ -0,0 +1,58 @@
+#ifndef EXPORT_MANIFEST_H
+#define EXPORT_MANIFEST_H
+
+#include <nstd/HashMap.hpp>
+#include <nstd/Mutex.hpp>
+#include <nstd/String.hpp>
+
+#include "core/dktypes.h"
+
+class IVirtualStream;
+
+//----------------------------------------------------------------------------------
+// Export manifest
+// Stores hashes of source data of each exported item, so items whose
+// source data and exporter settings did not change are skipped on re-runs
+//----------------------------------------------------------------------------------
+
+#define EXPORT_HASH_INITIAL			0xcbf29ce484222325ULL
+
+#define EXPORT_MANIFEST_VERSION		1		// increase when exported file formats change
+
+// FNV-1a
+uint64	HashData(const void* data, int size, uint64 hash = EXPORT_HASH_INITIAL);
+uint64	HashStreamRange(IVirtualStream* stream, int offset, int size, uint64 hash = EXPORT_HASH_INITIAL);
+
+class CExportManifest
+{
+public:
+	CExportManifest();
+
+	// loads previous manifest. Entries are dropped if exporter settings are changed
+	void				Load(const char* filename, uint64 settingsHash);
+	bool				Save();
+
+	// when force is set items are always reported as changed
+	void				SetForceExport(bool force);
+
+	// returns true and keeps the entry if item was exported with the same hash and output file exists
+	bool				IsUpToDate(const char* key, uint64 hash, const char* outputFilename);
+
+	// records successfully exported item
+	void				Update(const char* key, uint64 hash);
+
+	int					GetNumSkipped() const;
+
+protected:
+	String				m_filename;
+	uint64				m_settingsHash{ 0 };
+
+	Mutex				m_mutex;
+	HashMap<String, uint64>	m_entries;
+
+	int					m_numSkipped{ 0 };
+	bool				m_force{ false };
+	bool				m_loaded{ false };
+};
+
+#endif // EXPORT_MANIFEST_H
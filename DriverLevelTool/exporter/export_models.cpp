@@ -4,22 +4,23 @@
 #include "core/VirtualStream.h"
 
 #include "driver_level.h"
+#include "exporter/obj_writer.h"
+#include "exporter/export_manifest.h"
 #include "core/cmdlib.h"
 #include "math/Matrix.h"
 
 #include <string.h>
 #include <nstd/File.hpp>
+#include <nstd/HashMap.hpp>
 
 extern bool		g_extract_mdls;
 extern bool		g_export_worldUnityScript;
 
-extern String	g_levname_moddir;
-extern String	g_levname_texdir;
 
 //-------------------------------------------------------------
-// writes Wavefront OBJ into stream
+// writes Wavefront OBJ using buffered writer
 //-------------------------------------------------------------
-void WriteMDLToObjStream(IVirtualStream* pStream, MODEL* model, int modelSize, int model_index, const char* name_prefix,
+void WriteMDLToObj(CObjWriter& writer, CDriverLevelModels* levModels, MODEL* model, int modelSize, int model_index, const char* name_prefix,
 	bool debugInfo,
 	const Matrix4x4& translation,
 	int* first_v,
@@ -33,19 +34,35 @@ void WriteMDLToObjStream(IVirtualStream* pStream, MODEL* model, int modelSize, i
 
 	// export OBJ with points
 	if (debugInfo)
-		pStream->Print("#vert count %d\r\n", model->num_vertices);
+	{
+		writer.WriteString("#vert count ");
+		writer.WriteInt(model->num_vertices);
+		writer.WriteNewLine();
+	}
 
-	pStream->Print("g %s\r\n", name_prefix);
-	pStream->Print("o %s\r\n", name_prefix);
+	writer.WriteString("g ");
+	writer.WriteString(name_prefix);
+	writer.WriteNewLine();
+
+	writer.WriteString("o ");
+	writer.WriteString(name_prefix);
+	writer.WriteNewLine();
 
 	MODEL* vertex_ref = model;
 
 	if (model->instance_number > 0) // car models have vertex_ref=0
 	{
-		if(debugInfo)
-			pStream->Print("#vertex data ref model: %d (count = %d)\r\n", model->instance_number, model->num_vertices);
+		if (debugInfo)
+		{
+			writer.WriteString("#vertex data ref model: ");
+			writer.WriteInt(model->instance_number);
+			writer.WriteString(" (count = ");
+			writer.WriteInt(model->num_vertices);
+			writer.WriteChar(')');
+			writer.WriteNewLine();
+		}
 
-		ModelRef_t* ref = g_levModels.GetModelByIndex(model->instance_number);
+		ModelRef_t* ref = levModels ? levModels->GetModelByIndex(model->instance_number) : nullptr;
 
 		if (!ref)
 		{
@@ -74,10 +91,7 @@ void WriteMDLToObjStream(IVirtualStream* pStream, MODEL* model, int modelSize, i
 
 		sfVert = (translation * Vector4D(sfVert, 1.0f)).xyz();
 
-		pStream->Print("v %g %g %g\r\n", 
-			sfVert.x,
-			sfVert.y,
-			sfVert.z);
+		writer.WriteVector3("v", sfVert.x, sfVert.y, sfVert.z);
 	}
 
 	// store GT3/GT4 vertex normals
@@ -86,21 +100,22 @@ void WriteMDLToObjStream(IVirtualStream* pStream, MODEL* model, int modelSize, i
 		SVECTOR* norm = vertex_ref->pPointNormal(i);
 		Vector3D sfNorm = Vector3D(norm->x, norm->y, norm->z) * export_scale;
 
-		pStream->Print("vn %g %g %g\r\n", 
-			sfNorm.x,
-			sfNorm.y,
-			sfNorm.z);
+		writer.WriteVector3("vn", sfNorm.x, sfNorm.y, sfNorm.z);
 	}
 
 	if (debugInfo)
 	{
-		pStream->Print("#poly ofs %d\r\n", model->poly_block);
-		pStream->Print("#poly count %d\r\n", model->num_polys);
+		writer.WriteString("#poly ofs ");
+		writer.WriteInt(model->poly_block);
+		writer.WriteNewLine();
+
+		writer.WriteString("#poly count ");
+		writer.WriteInt(model->num_polys);
+		writer.WriteNewLine();
 	}
 
-	pStream->Print("usemtl none\r\n");
+	writer.WriteString("usemtl none\r\n");
 
-	char formatted_vertex[512];
 	int numVertCoords = 0;
 	int numVerts = 0;
 
@@ -140,7 +155,15 @@ void WriteMDLToObjStream(IVirtualStream* pStream, MODEL* model, int modelSize, i
 		face_ofs += poly_size;
 		
 		if (debugInfo)
-			pStream->Print("# ft=%d ofs=%d size=%d\r\n", *facedata & 31, model->poly_block + face_ofs, poly_size);
+		{
+			writer.WriteString("# ft=");
+			writer.WriteInt(*facedata & 31);
+			writer.WriteString(" ofs=");
+			writer.WriteInt(model->poly_block + face_ofs);
+			writer.WriteString(" size=");
+			writer.WriteInt(poly_size);
+			writer.WriteNewLine();
+		}
 
 		int numPolyVerts = (dec_face.flags & FACE_IS_QUAD) ? 4 : 3;
 		bool bad_face = false;
@@ -175,15 +198,19 @@ void WriteMDLToObjStream(IVirtualStream* pStream, MODEL* model, int modelSize, i
 
 		if (dec_face.flags & FACE_TEXTURED)
 		{
-			if(prev_tpage != dec_face.page)
-				pStream->Print("usemtl page_%d\r\n", dec_face.page);
+			if (prev_tpage != dec_face.page)
+			{
+				writer.WriteString("usemtl page_");
+				writer.WriteInt(dec_face.page);
+				writer.WriteNewLine();
+			}
 
 			prev_tpage = dec_face.page;
 		}
 		else
 		{
 			if(prev_tpage != -1)
-				pStream->Print("usemtl none\r\n");
+				writer.WriteString("usemtl none\r\n");
 
 			prev_tpage = -1;
 		}
@@ -193,70 +220,63 @@ void WriteMDLToObjStream(IVirtualStream* pStream, MODEL* model, int modelSize, i
 		// Gouraud-shaded poly smoothing
 		if(smooth != prevSmooth)
 		{
-			pStream->Print("s %s\r\n", smooth ? "1" : "off");
+			writer.WriteString(smooth ? "s 1\r\n" : "s off\r\n");
 			prevSmooth = smooth;
 		}
 
-		// start new fresh face
-		strcpy(formatted_vertex, "f ");
+		// texture coordinates go before the face
+		const int faceFirstVertCoord = numVertCoords;
 
-		for(int v = 0; v < numPolyVerts; v++)
+		if (dec_face.flags & FACE_TEXTURED)
 		{
-			char temp[64] = {0};
-			char vertex_value[64] = {0};
-
-			int VERT_IDX;
-			if(flipFaces)
-				VERT_IDX = numPolyVerts - 1 - v;
-			else
-				VERT_IDX = v;
-
-			// starting with vertex index
-			sprintf(temp, "%d", dec_face.vindices[VERT_IDX] + 1 + numVerts);
-			strcat(vertex_value, temp);
-
-			// dump texture coordinate
-			if (dec_face.flags & FACE_TEXTURED)
+			for (int v = 0; v < numPolyVerts; v++)
 			{
+				int VERT_IDX = flipFaces ? numPolyVerts - 1 - v : v;
+
 				UV_INFO uv = *(UV_INFO*)dec_face.uv[VERT_IDX];
 
-				float fsU, fsV;
-				
 				// map to 0..1
-				fsU = ((float)uv.u + 0.5f) / 256.0f;
-				fsV = ((float)uv.v + 0.5f) / 256.0f;
+				float fsU = ((float)uv.u + 0.5f) / 256.0f;
+				float fsV = ((float)uv.v + 0.5f) / 256.0f;
 
-				pStream->Print("vt %g %g\r\n", fsU, 1.0f - fsV);
+				writer.WriteVector2("vt", fsU, 1.0f - fsV);
+			}
+
+			numVertCoords += numPolyVerts;
+		}
+
+		// start new fresh face
+		writer.WriteString("f ");
 
-				// add texture coordinate to face value
-				sprintf(temp, "/%d", numVertCoords + 1);
-				strcat(vertex_value, temp);
+		for(int v = 0; v < numPolyVerts; v++)
+		{
+			int VERT_IDX = flipFaces ? numPolyVerts - 1 - v : v;
 
-				numVertCoords++;
+			// starting with vertex index
+			writer.WriteInt(dec_face.vindices[VERT_IDX] + 1 + numVerts);
+
+			// texture coordinate
+			if (dec_face.flags & FACE_TEXTURED)
+			{
+				writer.WriteChar('/');
+				writer.WriteInt(faceFirstVertCoord + v + 1);
 			}
 
-			// dump vertex normal
-			if(dec_face.flags & FACE_VERT_NORMAL)
+			// vertex normal
+			if (dec_face.flags & FACE_VERT_NORMAL)
 			{
 				if (!(dec_face.flags & FACE_TEXTURED))
-				{
-					strcat(vertex_value, "/");
-				}
+					writer.WriteChar('/');
 
-				// add vertex normal to face value
-				sprintf(temp, "/%d", dec_face.nindices[VERT_IDX] + 1 + numVerts);
-				strcat(vertex_value, temp);
+				writer.WriteChar('/');
+				writer.WriteInt(dec_face.nindices[VERT_IDX] + 1 + numVerts);
 			}
 
-			// add a space
-			strcat(vertex_value, " ");
-
-			// concat the value
-			strcat(formatted_vertex, vertex_value);
+			writer.WriteChar(' ');
 		}
 
-		// end the vertex
-		pStream->Print("%s\r\n", formatted_vertex);
+		// end the face
+		writer.WriteNewLine();
 	}
 
 	if (first_t)
@@ -268,6 +288,19 @@ void WriteMDLToObjStream(IVirtualStream* pStream, MODEL* model, int modelSize, i
 	PrintUnknownPolys();
 }
 
+//-------------------------------------------------------------
+// writes Wavefront OBJ into stream
+//-------------------------------------------------------------
+void WriteMDLToObjStream(IVirtualStream* pStream, CDriverLevelModels* levModels, MODEL* model, int modelSize, int model_index, const char* name_prefix,
+	bool debugInfo,
+	const Matrix4x4& translation,
+	int* first_v,
+	int* first_t)
+{
+	CObjWriter writer(pStream);
+	WriteMDLToObj(writer, levModels, model, modelSize, model_index, name_prefix, debugInfo, translation, first_v, first_t);
+}
+
 //-------------------------------------------------------------
 // Saves raw MODEL to file
 //-------------------------------------------------------------
@@ -291,7 +324,7 @@ void ExtractMDL(MODEL* model, const char* model_name, int modelSize)
 //-------------------------------------------------------------
 // exports model to single file
 //-------------------------------------------------------------
-void ExportMDLToOBJ(MODEL* model, const char* model_name, int model_index, int modelSize)
+void ExportMDLToOBJ(CDriverLevelModels* levModels, MODEL* model, const char* model_name, int model_index, int modelSize)
 {
 	if (!model)
 		return;
@@ -323,7 +356,7 @@ void ExportMDLToOBJ(MODEL* model, const char* model_name, int model_index, int m
 		bool debugInfo = false;
 #endif
 		
-		WriteMDLToObjStream(&fstr, model, modelSize, model_index, File::basename(String::fromCString(model_name)), debugInfo);
+		WriteMDLToObjStream(&fstr, levModels, model, modelSize, model_index, File::basename(String::fromCString(model_name)), debugInfo);
 
 		// success
 		fclose(mdlFile);
@@ -333,27 +366,27 @@ void ExportMDLToOBJ(MODEL* model, const char* model_name, int model_index, int m
 //-------------------------------------------------------------
 // exports car model. Car models are typical MODEL structures
 //-------------------------------------------------------------
-void ExportCarModel(MODEL* model, int size, int index, const char* name_suffix)
+void ExportCarModel(LevelContext_t& level, MODEL* model, int size, int index, const char* name_suffix)
 {
-	String model_name(String::fromPrintf("%s/CARMODEL_%d_%s", (char*)g_levname_moddir, index, name_suffix));
+	String model_name(String::fromPrintf("%s/CARMODEL_%d_%s", (char*)level.modelsDir, index, name_suffix));
 
 	// export model
-	ExportMDLToOBJ(model, model_name, index, size);
+	ExportMDLToOBJ(&level.models, model, model_name, index, size);
 }
 
 //-------------------------------------------------------------
 // Saves OBJ material file
 //-------------------------------------------------------------
-void SaveModelPagesMTL()
+void SaveModelPagesMTL(LevelContext_t& level)
 {
 	// create material file
-	FILE* pMtlFile = fopen(String::fromPrintf("%s/MODELPAGES.mtl", (char*)g_levname_moddir), "wb");
+	FILE* pMtlFile = fopen(String::fromPrintf("%s/MODELPAGES.mtl", (char*)level.modelsDir), "wb");
 
 	if (pMtlFile)
 	{
-		String justLevFilename = File::basename(g_levname_texdir, File::extension(g_levname_texdir));
+		String justLevFilename = File::basename(level.texturesDir, File::extension(level.texturesDir));
 		
-		for (int i = 0; i < g_levTextures.GetTPageCount(); i++)
+		for (int i = 0; i < level.textures.GetTPageCount(); i++)
 		{
 			fprintf(pMtlFile, "newmtl page_%d\r\n", i);
 			fprintf(pMtlFile, "map_Kd ../%s/PAGE_%d.tga\r\n", (char*)justLevFilename, i);
@@ -363,41 +396,103 @@ void SaveModelPagesMTL()
 	}
 }
 
+static String GetLevelModelName(const ModelRef_t* ref)
+{
+	return strlen(ref->name) > 0 ? String::fromCString(ref->name) : String::fromPrintf("MOD_%d", ref->index);
+}
+
+struct ModelExportJob_t
+{
+	LevelContext_t*		level{ nullptr };
+	Array<int>			modelIndices;
+};
+
+static void ExportLevelModelJob(void* userData, int index)
+{
+	ModelExportJob_t& job = *(ModelExportJob_t*)userData;
+	ExportLevelModel(*job.level, job.modelIndices[index]);
+}
+
 //-------------------------------------------------------------
 // Exports all models from level
 //-------------------------------------------------------------
-void ExportAllModels()
+void ExportAllModels(LevelContext_t& level)
 {
-	MsgInfo("Exporting all models...\n");
+	// models with same name are written to same file
+	// only last one is exported, same as when exporting them one by one
+	HashMap<String, int> outputIndex;
 
 	for (int i = 0; i < MAX_MODELS; i++)
 	{
-		ModelRef_t* ref = g_levModels.GetModelByIndex(i);
+		ModelRef_t* ref = level.models.GetModelByIndex(i);
 
-		if (!ref || !ref->model)
-			continue;
+		if (ref && ref->model)
+			outputIndex[GetLevelModelName(ref).toLowerCase()] = i;
+	}
 
-		String modelName = strlen(ref->name) > 0 ? String::fromCString(ref->name) : String::fromPrintf("MOD_%d", ref->index);
-		String modelPath = String::fromPrintf("%s/%s", (char*)g_levname_moddir, (char*)modelName);
+	ModelExportJob_t job;
+	job.level = &level;
+	job.modelIndices.reserve(outputIndex.size());
 
-		// export model
-		ExportMDLToOBJ(ref->model, modelPath, i, ref->size);
-	}
+	for (HashMap<String, int>::Iterator it = outputIndex.begin(); it != outputIndex.end(); ++it)
+		job.modelIndices.append(*it);
+
+	MsgInfo("Exporting all models using %d threads...\n", GetNumWorkerThreads(level));
+
+	RunParallelJobs(level, job.modelIndices.size(), ExportLevelModelJob, &job);
+}
+
+//-------------------------------------------------------------
+// Exports single loaded level model, returns false if it's not loaded
+//-------------------------------------------------------------
+bool ExportLevelModel(LevelContext_t& level, int index)
+{
+	ModelRef_t* ref = level.models.GetModelByIndex(index);
+
+	if (!ref || !ref->model)
+		return false;
+
+	String modelName = GetLevelModelName(ref);
+	String modelPath = String::fromPrintf("%s/%s", (char*)level.modelsDir, (char*)modelName);
+
+	// instances take vertices from referenced model
+	uint64 sourceHash = HashData(ref->model, ref->size);
+
+	ModelRef_t* vertexRef = ref->model->instance_number > 0 ? level.models.GetModelByIndex(ref->model->instance_number) : nullptr;
+
+	if (vertexRef && vertexRef->model)
+		sourceHash = HashData(vertexRef->model, vertexRef->size, sourceHash);
+
+	String manifestKey = String::fromPrintf("model/%d", index);
+	String outputFilename = modelPath + (g_extract_mdls ? ".MDL" : ".obj");
+
+	if (level.exportManifest.IsUpToDate(manifestKey, sourceHash, outputFilename))
+		return true;
+
+	// export model
+	ExportMDLToOBJ(&level.models, ref->model, modelPath, index, ref->size);
+
+	level.exportManifest.Update(manifestKey, sourceHash);
+
+	return true;
+}
+
+static void ExportCarModelJob(void* userData, int index)
+{
+	LevelContext_t& level = *(LevelContext_t*)userData;
+	CarModelData_t* modelRef = level.models.GetCarModel(index);
+
+	ExportCarModel(level, modelRef->cleanmodel, modelRef->cleanSize, index, "clean");
+	ExportCarModel(level, modelRef->dammodel, modelRef->cleanSize, index, "damaged");
+	ExportCarModel(level, modelRef->lowmodel, modelRef->lowSize, index, "low");
 }
 
 //-------------------------------------------------------------
 // Exports all CAR models from level
 //-------------------------------------------------------------
-void ExportAllCarModels()
+void ExportAllCarModels(LevelContext_t& level)
 {
 	MsgInfo("Exporting car models...\n");
 
-	for (int i = 0; i < MAX_CAR_MODELS; i++)
-	{
-		CarModelData_t* modelRef = g_levModels.GetCarModel(i);
-		
-		ExportCarModel(modelRef->cleanmodel, modelRef->cleanSize, i, "clean");
-		ExportCarModel(modelRef->dammodel, modelRef->cleanSize, i, "damaged");
-		ExportCarModel(modelRef->lowmodel, modelRef->lowSize, i, "low");
-	}
+	RunParallelJobs(level, MAX_CAR_MODELS, ExportCarModelJob, &level);
 }
\ No newline at end of file
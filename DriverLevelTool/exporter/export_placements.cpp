@@ -0,0 +1,196 @@
+#include "driver_level.h"
+#include "driver_routines/level.h"
+
+#include "core/cmdlib.h"
+#include "core/VirtualStream.h"
+#include <string.h>
+#include <nstd/Directory.hpp>
+#include <nstd/File.hpp>
+
+extern bool				g_export_models;
+
+
+//-------------------------------------------------------------
+// Binary placements file:
+//	PLACEMENTS_HEADER
+//	PLACEMENT_RECORD	[numPlacements]
+//	model names			[numModelNames] as ushort index, ubyte length, chars
+//-------------------------------------------------------------
+
+#define PLACEMENTS_IDENT		(('M' << 24) | ('C' << 16) | ('L' << 8) | 'P')	// 'PLCM'
+#define PLACEMENTS_VERSION		1
+
+struct PLACEMENTS_HEADER
+{
+	int				ident;
+	int				version;
+	int				regionSize;		// cells across region
+	int				cellSize;		// cell size in world units
+	int				numPlacements;
+	int				numModelNames;
+};
+
+struct PLACEMENT_RECORD
+{
+	CELL_OBJECT		co;				// unpacked cell object, position in world units
+	ushort			region;
+	ushort			cell;			// cell index within region
+};
+
+struct PlacementsExport_t
+{
+	LevelContext_t*				level{ nullptr };
+	const ModelExportFilters*	filters{ nullptr };
+	IVirtualStream*				stream{ nullptr };
+	int							format{ PLACEMENTS_NONE };
+
+	int							numPlacements{ 0 };
+	bool						modelExported[MAX_MODELS];
+	bool						modelUsed[MAX_MODELS];
+};
+
+//-------------------------------------------------------------
+// Writes cell object placement, exports it's model if not done yet
+//-------------------------------------------------------------
+static void WritePlacement(void* userData, const CELL_OBJECT& co, int regionIdx, int cellIdx)
+{
+	PlacementsExport_t& ctx = *(PlacementsExport_t*)userData;
+
+	ModelRef_t* ref = ctx.level->models.GetModelByIndex(co.type);
+
+	if (!ref || !ref->model)
+		return;
+
+	if (!ctx.filters->Check(ref->model))
+		return;
+
+	// area models are only loaded with their regions
+	if (!ctx.modelExported[co.type])
+		ctx.modelExported[co.type] = ExportLevelModel(*ctx.level, co.type);
+
+	ctx.modelUsed[co.type] = true;
+
+	if (ctx.format == PLACEMENTS_BINARY)
+	{
+		PLACEMENT_RECORD record;
+		record.co = co;
+		record.region = regionIdx;
+		record.cell = cellIdx;
+
+		ctx.stream->Write(&record, 1, sizeof(record));
+	}
+	else
+	{
+		ctx.stream->Print("%d,%d,%d,%s,%d,%d,%d,%d\n", regionIdx, cellIdx, co.type,
+			ref->name ? ref->name : "",
+			co.pos.vx, co.pos.vy, co.pos.vz, co.yang);
+	}
+
+	ctx.numPlacements++;
+}
+
+//-------------------------------------------------------------
+// Exports model library once and cell object placements
+// as a table instead of baking them into region geometry
+//-------------------------------------------------------------
+void ExportWorldPlacements(LevelContext_t& level, const ModelExportFilters& filters, int format)
+{
+	MsgInfo("Exporting world model library and placements...\n");
+
+	if (!level.stream)
+	{
+		MsgError("Unable to export placements - level file is not opened!\n");
+		return;
+	}
+
+	const OUT_CELL_FILE_HEADER& mapInfo = level.map->GetMapInfo();
+
+	String levNameOnly = File::basename(level.name, File::extension(level.name));
+	String filename = String::fromPrintf("%s/regions/%s_placements.%s", (char*)File::dirname(level.name), (char*)levNameOnly,
+		format == PLACEMENTS_BINARY ? "bin" : "csv");
+
+	Directory::create(File::dirname(level.name) + "/regions");
+
+	FILE* fp = fopen(filename, "wb");
+
+	if (!fp)
+	{
+		MsgError("Unable to create '%s'\n", (char*)filename);
+		return;
+	}
+
+	CFileStream stream(fp);
+
+	PlacementsExport_t* ctx = new PlacementsExport_t();
+	ctx->level = &level;
+	ctx->filters = &filters;
+	ctx->stream = &stream;
+	ctx->format = format;
+
+	memset(ctx->modelExported, 0, sizeof(ctx->modelExported));
+	memset(ctx->modelUsed, 0, sizeof(ctx->modelUsed));
+
+	// permanent models
+	Directory::create(level.modelsDir);
+
+	if (!g_export_models)
+	{
+		SaveModelPagesMTL(level);
+		ExportAllModels(level);
+	}
+
+	for (int i = 0; i < MAX_MODELS; i++)
+	{
+		ModelRef_t* ref = level.models.GetModelByIndex(i);
+		ctx->modelExported[i] = ref && ref->model;
+	}
+
+	PLACEMENTS_HEADER header;
+	header.ident = PLACEMENTS_IDENT;
+	header.version = PLACEMENTS_VERSION;
+	header.regionSize = mapInfo.region_size;
+	header.cellSize = mapInfo.cell_size;
+	header.numPlacements = 0;
+	header.numModelNames = 0;
+
+	// counts are written when done
+	if (format == PLACEMENTS_BINARY)
+		stream.Write(&header, 1, sizeof(header));
+	else
+		stream.Print("region,cell,model,name,x,y,z,yang\n");
+
+	ForEachWorldCellObject(level, WritePlacement, ctx);
+
+	if (format == PLACEMENTS_BINARY)
+	{
+		// model names table
+		for (int i = 0; i < MAX_MODELS; i++)
+		{
+			if (!ctx->modelUsed[i])
+				continue;
+
+			ModelRef_t* ref = level.models.GetModelByIndex(i);
+
+			const ushort index = i;
+			const char* name = ref->name ? ref->name : "";
+			const ubyte length = strlen(name);
+
+			stream.Write(&index, 1, sizeof(index));
+			stream.Write(&length, 1, sizeof(length));
+			stream.Write(name, 1, length);
+
+			header.numModelNames++;
+		}
+
+		header.numPlacements = ctx->numPlacements;
+
+		stream.Seek(0, VS_SEEK_SET);
+		stream.Write(&header, 1, sizeof(header));
+	}
+
+	fclose(fp);
+
+	MsgAccept("Written %d placements to '%s'\n", ctx->numPlacements, (char*)filename);
+
+	delete ctx;
+}
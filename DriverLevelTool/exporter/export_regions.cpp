@@ -1,12 +1,17 @@
 #include "driver_level.h"
 #include "driver_routines/level.h"
+#include "exporter/export_manifest.h"
 
 #include "core/cmdlib.h"
 #include "core/VirtualStream.h"
 #include "util/util.h"
+#include <stdio.h>
 #include <string.h>
+#include <nstd/Array.hpp>
 #include <nstd/Directory.hpp>
 #include <nstd/File.hpp>
+#include <nstd/Mutex.hpp>
+#include <nstd/Thread.hpp>
 
 
 #include "driver_routines/regions_d1.h"
@@ -14,38 +19,209 @@
 
 #include "math/Matrix.h"
 
-static const char* s_UnityScriptTemplate =
+// Unity script is streamed - prologue, model loads and instances, then epilogue
+static const char* s_UnityScriptPrologue =
 "using System.Collections;\n\
 using System.Collections.Generic;\n\
 using UnityEngine;\n\
 public class %s : MonoBehaviour\n\
 {\n\
 	void Start()\n\
+	{\n";
+
+static const char* s_UnityScriptEpilogue =
+"	}\n\
+	void Update()\n\
 	{\n\
-%s\n\
 	}\n\
-	void Update()\n\
+}";
+
+//-------------------------------------------------------------
+// Unity region data asset (loaded as TextAsset by DriverRegionAsset.cs):
+//	UNITY_REGION_HEADER
+//	model names				[numModels] as ushort length, chars
+//	UNITY_REGION_INSTANCE	[numInstances]
+//-------------------------------------------------------------
+
+#define UNITY_REGION_IDENT		(('G' << 24) | ('R' << 16) | ('R' << 8) | 'D')	// 'DRRG'
+#define UNITY_REGION_VERSION	1
+
+struct UNITY_REGION_HEADER
+{
+	int				ident;
+	int				version;
+	int				region;
+	int				numModels;
+	int				numInstances;
+};
+
+struct UNITY_REGION_INSTANCE
+{
+	int				model;			// index in asset model names
+	float			position[3];
+	float			rotationY;		// degrees
+};
+
+static const char* s_UnityRegionAssetLoader =
+"using System.IO;\n\
+using System.Text;\n\
+using UnityEngine;\n\
+public class DriverRegionAsset : MonoBehaviour\n\
+{\n\
+	public TextAsset regionData;\n\
+	public string modelsPath = \"%s/\";\n\
+	void Start()\n\
 	{\n\
+		using (var reader = new BinaryReader(new MemoryStream(regionData.bytes)))\n\
+		{\n\
+			if (reader.ReadInt32() != %d || reader.ReadInt32() != %d)\n\
+			{\n\
+				Debug.LogError(\"Invalid region data \" + regionData.name);\n\
+				return;\n\
+			}\n\
+			reader.ReadInt32();\n\
+			var models = new GameObject[reader.ReadInt32()];\n\
+			int numInstances = reader.ReadInt32();\n\
+			for (int i = 0; i < models.Length; i++)\n\
+			{\n\
+				string name = Encoding.ASCII.GetString(reader.ReadBytes(reader.ReadUInt16()));\n\
+				models[i] = Resources.Load(modelsPath + name) as GameObject;\n\
+			}\n\
+			for (int i = 0; i < numInstances; i++)\n\
+			{\n\
+				var model = models[reader.ReadInt32()];\n\
+				var position = new Vector3(reader.ReadSingle(), reader.ReadSingle(), reader.ReadSingle());\n\
+				var rotation = Quaternion.Euler(0.0f, reader.ReadSingle(), 0.0f);\n\
+				if (model)\n\
+					Instantiate(model, position, rotation);\n\
+			}\n\
+		}\n\
 	}\n\
 }";
 
+struct UnityRegionAsset_t
+{
+	Array<int>						modelSlots;		// asset model per level model, -1 if not used
+	Array<ModelRef_t*>				models;
+	Array<UNITY_REGION_INSTANCE>	instances;
+};
+
 extern bool				g_export_models;
 extern bool				g_export_worldUnityScript;
+extern bool				g_export_worldUnityAsset;
+
+
+static String GetUnityModelName(ModelRef_t* ref)
+{
+	return ref->name && *ref->name ? String::fromCString(ref->name) : String::fromPrintf("MOD_%d", ref->index);
+}
+
+//-------------------------------------------------------------
+// Adds cell object to region asset, model names are stored once
+//-------------------------------------------------------------
+static void AddUnityRegionInstance(UnityRegionAsset_t& asset, ModelRef_t* ref, const Vector3D& position, float rotationDeg)
+{
+	if (asset.modelSlots.size() != MAX_MODELS)
+		asset.modelSlots.resize(MAX_MODELS, -1);
+
+	if (asset.modelSlots[ref->index] == -1)
+	{
+		asset.modelSlots[ref->index] = asset.models.size();
+		asset.models.append(ref);
+	}
+
+	UNITY_REGION_INSTANCE instance;
+	instance.model = asset.modelSlots[ref->index];
+	instance.position[0] = position.x;
+	instance.position[1] = position.y;
+	instance.position[2] = position.z;
+	instance.rotationY = rotationDeg;
+
+	asset.instances.append(instance);
+}
+
+//-------------------------------------------------------------
+// Writes region asset and resets it for the next region
+//-------------------------------------------------------------
+static void WriteUnityRegionAsset(IVirtualStream* stream, UnityRegionAsset_t& asset, int regionIdx)
+{
+	UNITY_REGION_HEADER header;
+	header.ident = UNITY_REGION_IDENT;
+	header.version = UNITY_REGION_VERSION;
+	header.region = regionIdx;
+	header.numModels = asset.models.size();
+	header.numInstances = asset.instances.size();
+
+	stream->Write(&header, 1, sizeof(header));
+
+	for (usize i = 0; i < asset.models.size(); i++)
+	{
+		String modelName = GetUnityModelName(asset.models[i]);
+
+		const ushort length = modelName.length();
+		stream->Write(&length, 1, sizeof(length));
+		stream->Write((const char*)modelName, 1, length);
+
+		asset.modelSlots[asset.models[i]->index] = -1;
+	}
+
+	if (asset.instances.size())
+		stream->Write(&asset.instances[0], sizeof(UNITY_REGION_INSTANCE), asset.instances.size());
+
+	asset.models.clear();
+	asset.instances.clear();
+}
+
+//-------------------------------------------------------------
+// Writes cell object as Unity instance or transformed OBJ model
+//-------------------------------------------------------------
+static void ExportCellObject(LevelContext_t& level, IVirtualStream* levelFileStream, UnityRegionAsset_t* unityAsset, const CELL_OBJECT& co, ModelRef_t* ref,
+	int regionIdx, int objectIdx, const char* regionName, int& lobj_first_v, int& lobj_first_t, WriteMDLToObjStream_t writeModel)
+{
+	Vector3D absCellPosition(co.pos.vx * -EXPORT_SCALING, co.pos.vy * -EXPORT_SCALING, co.pos.vz * EXPORT_SCALING);
+	float cellRotationRad = co.yang / 64.0f * PI_F * 2.0f;
+
+	if (g_export_worldUnityScript)
+	{
+		float cellRotationDeg = RAD2DEG(cellRotationRad) + 180;
+
+		if (unityAsset)
+		{
+			AddUnityRegionInstance(*unityAsset, ref, absCellPosition, -cellRotationDeg);
+			return;
+		}
 
-extern String			g_levname_moddir;
-extern String			g_levname;
+		levelFileStream->Print("var reg%d_o%d = Instantiate(%s, new Vector3(%gf,%gf,%gf), Quaternion.Euler(0.0f,%gf,0.0f)) as GameObject;\n",
+			regionIdx, objectIdx, (char*)GetUnityModelName(ref), absCellPosition.x, absCellPosition.y, absCellPosition.z, -cellRotationDeg);
+	}
+	else
+	{
+		// transform objects and save
+		Matrix4x4 transform = translate(absCellPosition);
+		transform = transform * rotateY4(cellRotationRad) * scale4(1.0f, 1.0f, 1.0f);
+
+		writeModel(levelFileStream, &level.models, ref->model, ref->size, co.type, regionName,
+			false, transform, &lobj_first_v, &lobj_first_t);
+	}
+}
 
 //-------------------------------------------------------------
 // Processes Driver 1 region
 //-------------------------------------------------------------
-int ExportRegionDriver1(CDriver1LevelRegion* region, IVirtualStream* levelFileStream, const ModelExportFilters& filters, int& lobj_first_v, int& lobj_first_t)
+int ExportRegionDriver1(LevelContext_t& level, CDriver1LevelRegion* region, IVirtualStream* levelFileStream, UnityRegionAsset_t* unityAsset, const ModelExportFilters& filters, int& lobj_first_v, int& lobj_first_t,
+	WriteMDLToObjStream_t writeModel = WriteMDLToObjStream)
 {
-	CDriver1LevelMap* levMapDriver1 = (CDriver1LevelMap*)g_levMap;
+	CDriver1LevelMap* levMapDriver1 = (CDriver1LevelMap*)level.map;
 	const OUT_CELL_FILE_HEADER& mapInfo = levMapDriver1->GetMapInfo();
 
 	int numRegionObjects = 0;
 
-	if (g_export_worldUnityScript)
+	char regionName[32];
+	sprintf(regionName, "reg%d", region->GetNumber());
+
+	const bool unityScriptText = g_export_worldUnityScript && !unityAsset;
+
+	if (unityScriptText)
 		levelFileStream->Print("// Region %d\n", region->GetNumber());
 	
 	CELL_ITERATOR_CACHE cache;
@@ -58,44 +234,21 @@ int ExportRegionDriver1(CDriver1LevelRegion* region, IVirtualStream* levelFileSt
 
 		for(CELL_OBJECT* co = region->StartIterator(&iterator, i); co; co = levMapDriver1->GetNextCop(&iterator))
 		{
-			Vector3D absCellPosition(co->pos.vx * -EXPORT_SCALING, co->pos.vy * -EXPORT_SCALING, co->pos.vz * EXPORT_SCALING);
-			float cellRotationRad = co->yang / 64.0f * PI_F * 2.0f;
-
-			ModelRef_t* ref = g_levModels.GetModelByIndex(co->type);
+			ModelRef_t* ref = level.models.GetModelByIndex(co->type);
 
 			if (ref)
 			{
-				MODEL* model = ref->model;
-
-				if (!filters.Check(model))
+				if (!filters.Check(ref->model))
 					continue;
 
-				if (g_export_worldUnityScript)
-				{
-					String cellModelName = ref->name ? String::fromCString(ref->name) : String::fromPrintf("MOD_%d", ref->index);
-
-					float cellRotationDeg = RAD2DEG(cellRotationRad) + 180;
-					
-					levelFileStream->Print("var reg%d_o%d = Instantiate(%s, new Vector3(%gf,%gf,%gf), Quaternion.Euler(0.0f,%gf,0.0f)) as GameObject;\n",
-						region->GetNumber(), numRegionObjects, (char*)cellModelName, absCellPosition.x, absCellPosition.y, absCellPosition.z, -cellRotationDeg);
-				}
-				else
-				{
-					// transform objects and save
-					Matrix4x4 transform = translate(absCellPosition);
-					transform = transform * rotateY4(cellRotationRad) * scale4(1.0f, 1.0f, 1.0f);
-
-					WriteMDLToObjStream(levelFileStream, model, ref->size, co->type,
-						String::fromPrintf("reg%d", region->GetNumber()),
-						false, transform, &lobj_first_v, &lobj_first_t);
-				}
+				ExportCellObject(level, levelFileStream, unityAsset, *co, ref, region->GetNumber(), numRegionObjects, regionName, lobj_first_v, lobj_first_t, writeModel);
 			}
 
 			numRegionObjects++;
 		}
 	}
 
-	if (g_export_worldUnityScript)
+	if (unityScriptText)
 		levelFileStream->Print("// total region cells %d\n", numRegionObjects);
 
 	return numRegionObjects;
@@ -104,14 +257,20 @@ int ExportRegionDriver1(CDriver1LevelRegion* region, IVirtualStream* levelFileSt
 //-------------------------------------------------------------
 // Processes Driver 2 region
 //-------------------------------------------------------------
-int ExportRegionDriver2(CDriver2LevelRegion* region, IVirtualStream* levelFileStream, const ModelExportFilters& filters, int& lobj_first_v, int& lobj_first_t)
+int ExportRegionDriver2(LevelContext_t& level, CDriver2LevelRegion* region, IVirtualStream* levelFileStream, UnityRegionAsset_t* unityAsset, const ModelExportFilters& filters, int& lobj_first_v, int& lobj_first_t,
+	WriteMDLToObjStream_t writeModel = WriteMDLToObjStream)
 {
-	CDriver2LevelMap* levMapDriver2 = (CDriver2LevelMap*)g_levMap;
+	CDriver2LevelMap* levMapDriver2 = (CDriver2LevelMap*)level.map;
 	const OUT_CELL_FILE_HEADER& mapInfo = levMapDriver2->GetMapInfo();
 
 	int numRegionObjects = 0;
 
-	if (g_export_worldUnityScript)
+	char regionName[32];
+	sprintf(regionName, "reg%d", region->GetNumber());
+
+	const bool unityScriptText = g_export_worldUnityScript && !unityAsset;
+
+	if (unityScriptText)
 		levelFileStream->Print("// Region %d\n", region->GetNumber());
 
 	CELL_ITERATOR_CACHE cache;
@@ -127,50 +286,27 @@ int ExportRegionDriver2(CDriver2LevelRegion* region, IVirtualStream* levelFileSt
 			CELL_OBJECT co;
 			CDriver2LevelMap::UnpackCellObject(co, pco, ci.nearCell);
 
-			Vector3D absCellPosition(co.pos.vx * -EXPORT_SCALING, co.pos.vy * -EXPORT_SCALING, co.pos.vz * EXPORT_SCALING);
-			float cellRotationRad = co.yang / 64.0f * PI_F * 2.0f;
-
-			ModelRef_t* ref = g_levModels.GetModelByIndex(co.type);
+			ModelRef_t* ref = level.models.GetModelByIndex(co.type);
 
 			if (ref)
 			{
-				MODEL* model = ref->model;
-
-				if (!filters.Check(model))
+				if (!filters.Check(ref->model))
 					continue;
 
-				if (g_export_worldUnityScript)
-				{
-					String modelName = strlen(ref->name) > 0 ? String::fromCString(ref->name) : String::fromPrintf("MOD_%d", ref->index);
-
-					float cellRotationDeg = RAD2DEG(cellRotationRad) + 180;
-
-					levelFileStream->Print("var reg%d_o%d = Instantiate(%s, new Vector3(%gf,%gf,%gf), Quaternion.Euler(0.0f,%gf,0.0f)) as GameObject;\n",
-						region->GetNumber(), numRegionObjects, (char*)modelName, absCellPosition.x, absCellPosition.y, absCellPosition.z, -cellRotationDeg);
-				}
-				else
-				{
-					// transform objects and save
-					Matrix4x4 transform = translate(absCellPosition);
-					transform = transform * rotateY4(cellRotationRad) * scale4(1.0f, 1.0f, 1.0f);
-
-					WriteMDLToObjStream(levelFileStream, model, ref->size, co.type,
-						String::fromPrintf("reg%d", region->GetNumber()),
-						false, transform, &lobj_first_v, &lobj_first_t);
-				}
+				ExportCellObject(level, levelFileStream, unityAsset, co, ref, region->GetNumber(), numRegionObjects, regionName, lobj_first_v, lobj_first_t, writeModel);
 			}
 
 			numRegionObjects++;
 		}
 	}
 
-	if (g_export_worldUnityScript)
+	if (unityScriptText)
 		levelFileStream->Print("// total region cells %d\n", numRegionObjects);
 
 	return numRegionObjects;
 }
 
-void PrintRegionHeader(IVirtualStream* levelStream, const ModelExportFilters& filters)
+void PrintRegionHeader(LevelContext_t& level, IVirtualStream* levelStream, const ModelExportFilters& filters)
 {
 	if (!g_export_worldUnityScript)
 	{
@@ -178,13 +314,13 @@ void PrintRegionHeader(IVirtualStream* levelStream, const ModelExportFilters& fi
 	}
 
 	int numModels = 0;
-	levelStream->Print("var modelsPath = \"%s/\";\n", (char*)File::basename(g_levname_moddir));
+	levelStream->Print("var modelsPath = \"%s/\";\n", (char*)File::basename(level.modelsDir));
 
 	levelStream->Print("// Load resources\n");
 	levelStream->Print("// You must have them placed to Assets/Resources/ folder\n");
 	for (int i = 0; i < MAX_MODELS; i++)
 	{
-		ModelRef_t* ref = g_levModels.GetModelByIndex(i);
+		ModelRef_t* ref = level.models.GetModelByIndex(i);
 
 		if (!ref || ref && !ref->model)
 			continue;
@@ -194,7 +330,7 @@ void PrintRegionHeader(IVirtualStream* levelStream, const ModelExportFilters& fi
 		if (!filters.Check(model))
 			continue;
 
-		String modelName = strlen(ref->name) > 0 ? String::fromCString(ref->name) : String::fromPrintf("MOD_%d", ref->index);
+		String modelName = GetUnityModelName(ref);
 
 		// load the resource
 		levelStream->Print("var %s = Resources.Load(modelsPath + \"%s\") as GameObject;\n", (char*)modelName, (char*)modelName);
@@ -204,35 +340,246 @@ void PrintRegionHeader(IVirtualStream* levelStream, const ModelExportFilters& fi
 	levelStream->Print("// total %d models\n", numModels);
 }
 
+struct RegionExportJob_t
+{
+	LevelContext_t*				level{ nullptr };
+	const ModelExportFilters*	filters{ nullptr };
+	bool*						regionsToExport{ nullptr };
+
+	String						justLevFilename;
+	String						levNameOnly;
+
+	uint64						sharedSourceHash{ 0 };	// filters and permanent models
+
+	// worker threads print same way as exporting thread
+	ThreadSpewFunc_fn			spewFunc{ nullptr };
+	void*						spewUserData{ nullptr };
+
+	// guards level map spooling and fields below
+	Mutex						mutex;
+	Array<int>					regionsInProgress;
+	Array<bool>					spooledByExport;		// regions already spooled by viewer must stay
+	int							nextRegion{ 0 };
+	int							totalRegions{ 0 };
+	int							numCellObjectsRead{ 0 };
+};
+
+struct RegionExportThread_t
+{
+	RegionExportJob_t*			job{ nullptr };
+	SPOOL_CONTEXT				spoolContext;
+	Thread						thread;
+	bool						started{ false };
+};
+
+static String GetRegionOutputFilename(const RegionExportJob_t& job, int regionIdx)
+{
+	const char* ext = "obj";
+
+	if (g_export_worldUnityScript)
+		ext = g_export_worldUnityAsset ? "bytes" : "cs";
+
+	return String::fromPrintf("%s/regions/%s_reg%d.%s", (char*)File::dirname(job.level->name), (const char*)job.levNameOnly, regionIdx, ext);
+}
+
+//-------------------------------------------------------------
+// Hashes spooled region data and models of it's area
+//-------------------------------------------------------------
+static uint64 GetRegionSourceHash(const RegionExportJob_t& job, const SPOOL_CONTEXT& spoolContext, CBaseLevelRegion* region)
+{
+	const Spool* spool = region->GetSpoolInfo();
+
+	const int numBlocks = spool->roadm_size + spool->roadh_size + spool->pvs_size +
+		spool->cell_data_size[0] + spool->cell_data_size[1] + spool->cell_data_size[2];
+
+	uint64 hash = HashData(spool, sizeof(Spool), job.sharedSourceHash);
+	hash = HashStreamRange(spoolContext.dataStream, spoolContext.lumpInfo->spooled_offset + spool->offset * SPOOL_CD_BLOCK_SIZE, numBlocks * SPOOL_CD_BLOCK_SIZE, hash);
+
+	const int areaDataIdx = region->GetAreaDataIdx();
+
+	if (areaDataIdx != -1)
+	{
+		const AreaDataStr& areaData = job.level->map->GetAreaData(areaDataIdx);
+
+		hash = HashData(&areaData, sizeof(AreaDataStr), hash);
+		hash = HashStreamRange(spoolContext.dataStream, spoolContext.lumpInfo->spooled_offset + areaData.model_offset * SPOOL_CD_BLOCK_SIZE, areaData.model_size * SPOOL_CD_BLOCK_SIZE, hash);
+	}
+
+	return hash;
+}
+
+//-------------------------------------------------------------
+// Spools next region to be exported
+// Regions not changed since last export are skipped
+//-------------------------------------------------------------
+static CBaseLevelRegion* SpoolNextExportRegion(RegionExportJob_t& job, const SPOOL_CONTEXT& spoolContext, uint64& sourceHash)
+{
+	for (;;)
+	{
+		int regionIdx;
+
+		{
+			Mutex::Guard guard(job.mutex);
+
+			if (job.nextRegion >= job.totalRegions)
+				return nullptr;
+
+			regionIdx = job.nextRegion++;
+		}
+
+		if (job.regionsToExport && job.regionsToExport[regionIdx] == false)
+			continue;
+
+		CBaseLevelRegion* region = job.level->map->GetRegion(regionIdx);
+
+		if (region->IsEmpty())
+			continue;
+
+		// hashing reads through thread's own stream
+		sourceHash = GetRegionSourceHash(job, spoolContext, region);
+
+		if (job.level->exportManifest.IsUpToDate(String::fromPrintf("region/%d", regionIdx), sourceHash, GetRegionOutputFilename(job, regionIdx)))
+			continue;
+
+		Mutex::Guard guard(job.mutex);
+
+		// load region
+		// it will also load area data models for it
+		job.spooledByExport[regionIdx] = job.level->map->SpoolRegion(spoolContext, regionIdx);
+
+		job.regionsInProgress.append(regionIdx);
+		return region;
+	}
+}
+
+//-------------------------------------------------------------
+// Frees exported region, evicts area data over the budget
+//-------------------------------------------------------------
+static void FinishExportRegion(RegionExportJob_t& job, CBaseLevelRegion* region, int numCellObjects)
+{
+	Mutex::Guard guard(job.mutex);
+
+	job.numCellObjectsRead += numCellObjects;
+
+	int* found = job.regionsInProgress.find(region->GetNumber());
+	if (found)
+		job.regionsInProgress.remove(found - &job.regionsInProgress[0]);
+
+	// region is not needed anymore, it's area data stays cached for neighbour regions
+	if (job.spooledByExport[region->GetNumber()])
+	{
+		region->FreeAll();
+		job.spooledByExport[region->GetNumber()] = false;
+	}
+
+	// regions being exported by other threads must stay
+	for (usize i = 0; i < job.regionsInProgress.size(); i++)
+		job.level->map->TouchRegion(job.regionsInProgress[i]);
+
+	// keep memory flat on big maps
+	job.level->map->TrimRegionCache();
+}
+
+//-------------------------------------------------------------
+// Region export worker
+//-------------------------------------------------------------
+static uint ExportRegionsThread(void* param)
+{
+	RegionExportThread_t& ctx = *(RegionExportThread_t*)param;
+	RegionExportJob_t& job = *ctx.job;
+	LevelContext_t& level = *job.level;
+	const ModelExportFilters& filters = *job.filters;
+
+	SetThreadSpewFunction(job.spewFunc, job.spewUserData);
+
+	// region asset is collected in memory, instance records are small
+	UnityRegionAsset_t unityAsset;
+	UnityRegionAsset_t* regionAsset = g_export_worldUnityScript && g_export_worldUnityAsset ? &unityAsset : nullptr;
+
+	CBaseLevelRegion* region;
+	uint64 sourceHash;
+
+	while ((region = SpoolNextExportRegion(job, ctx.spoolContext, sourceHash)) != nullptr)
+	{
+		const int regionIdx = region->GetNumber();
+
+		FILE* regionFile = fopen(GetRegionOutputFilename(job, regionIdx), "wb");
+		CFileStream regionStream(regionFile);
+
+		const bool unityScriptText = g_export_worldUnityScript && !regionAsset;
+
+		if (unityScriptText)
+		{
+			String regionName = String::fromPrintf("%s_reg%d", (char*)job.levNameOnly, regionIdx);
+			regionStream.Print(s_UnityScriptPrologue, (char*)regionName);
+
+			// header lists loaded models which are changed by spooling
+			Mutex::Guard guard(job.mutex);
+			PrintRegionHeader(level, &regionStream, filters);
+		}
+		else if (!g_export_worldUnityScript)
+		{
+			regionStream.Print("mtllib %s_LEVELMODEL.mtl\r\n", (char*)job.justLevFilename);
+		}
+
+		// OBJ indices are counted per region file
+		int lobj_first_v = 0;
+		int lobj_first_t = 0;
+		int numCellObjects;
+
+		if (level.map->GetFormat() >= LEV_FORMAT_DRIVER2_ALPHA16)
+		{
+			numCellObjects = ExportRegionDriver2(level, (CDriver2LevelRegion*)region, &regionStream, regionAsset, filters, lobj_first_v, lobj_first_t);
+		}
+		else
+		{
+			numCellObjects = ExportRegionDriver1(level, (CDriver1LevelRegion*)region, &regionStream, regionAsset, filters, lobj_first_v, lobj_first_t);
+		}
+
+		if (unityScriptText)
+			regionStream.Print(s_UnityScriptEpilogue);
+		else if (regionAsset)
+			WriteUnityRegionAsset(&regionStream, unityAsset, regionIdx);
+
+		fclose(regionFile);
+
+		level.exportManifest.Update(String::fromPrintf("region/%d", regionIdx), sourceHash);
+
+		Msg("Exported region %d\n", regionIdx);
+
+		FinishExportRegion(job, region, numCellObjects);
+	}
+
+	return 0;
+}
+
 //-------------------------------------------------------------
 // Exports all level regions to OBJ file
 //-------------------------------------------------------------
-void ExportRegions(const ModelExportFilters& filters, bool* regionsToExport)
+void ExportRegions(LevelContext_t& level, const ModelExportFilters& filters, bool* regionsToExport)
 {
 	MsgInfo("Exporting cell points and world model...\n");
-	const OUT_CELL_FILE_HEADER& mapInfo = g_levMap->GetMapInfo();
+	const OUT_CELL_FILE_HEADER& mapInfo = level.map->GetMapInfo();
 
-	const int dim_x = g_levMap->GetRegionsAcross();
-	const int dim_y = g_levMap->GetRegionsDown();
+	const int dim_x = level.map->GetRegionsAcross();
+	const int dim_y = level.map->GetRegionsDown();
 
-	Msg("World size:\n [%dx%d] cells\n [%dx%d] regions\n", g_levMap->GetCellsAcross(), g_levMap->GetCellsDown(), dim_x, dim_y);
+	Msg("World size:\n [%dx%d] cells\n [%dx%d] regions\n", level.map->GetCellsAcross(), level.map->GetCellsDown(), dim_x, dim_y);
 
-	int numCellObjectsRead = 0;
-	
-	String justLevFilename = File::basename(g_levname, File::extension(g_levname));
-	String levFileNameWithoutExt = File::dirname(g_levname) + "/" + justLevFilename;
-	String levNameOnly = File::basename(g_levname, File::extension(g_levname));
+	String justLevFilename = File::basename(level.name, File::extension(level.name));
+	String levFileNameWithoutExt = File::dirname(level.name) + "/" + justLevFilename;
+	String levNameOnly = File::basename(level.name, File::extension(level.name));
 
-	Directory::create(File::dirname(g_levname) + "/regions");
+	Directory::create(File::dirname(level.name) + "/regions");
 
 	if (!g_export_worldUnityScript)
 	{
 		// create material file
-		FILE* pMtlFile = fopen(String::fromPrintf("%s/regions/%s_LEVELMODEL.mtl", (char*)File::dirname(g_levname), (char*)levNameOnly), "wb");
+		FILE* pMtlFile = fopen(String::fromPrintf("%s/regions/%s_LEVELMODEL.mtl", (char*)File::dirname(level.name), (char*)levNameOnly), "wb");
 
 		if (pMtlFile)
 		{
-			for (int i = 0; i < g_levTextures.GetTPageCount(); i++)
+			for (int i = 0; i < level.textures.GetTPageCount(); i++)
 			{
 				fprintf(pMtlFile, "newmtl page_%d\r\n", i);
 				fprintf(pMtlFile, "map_Kd ../%s_textures/PAGE_%d.tga\r\n", (char*)justLevFilename, i);
@@ -241,97 +588,127 @@ void ExportRegions(const ModelExportFilters& filters, bool* regionsToExport)
 			fclose(pMtlFile);
 		}
 	}
+	else if (g_export_worldUnityAsset)
+	{
+		// region assets are instantiated by single loader script
+		// it is shared by levels in same folder which batch export may write at once
+		static Mutex s_loaderScriptMutex;
+		Mutex::Guard guard(s_loaderScriptMutex);
 
+		FILE* pLoaderFile = fopen(String::fromPrintf("%s/regions/DriverRegionAsset.cs", (char*)File::dirname(level.name)), "wb");
+
+		if (pLoaderFile)
+		{
+			fprintf(pLoaderFile, s_UnityRegionAssetLoader, (char*)File::basename(level.modelsDir), UNITY_REGION_IDENT, UNITY_REGION_VERSION);
+			fclose(pLoaderFile);
+		}
+	}
 
-	// temp memory stream for Unity text
-	CMemoryStream tempMemStream;
-	tempMemStream.Open(nullptr, VS_OPEN_WRITE | VS_OPEN_TEXT, 65535 * 2048);
 
-	// Open file stream for spooling
-	FILE* fp = fopen(g_levname, "rb");
-	if (!fp)
+	// spool from level file that is already opened
+	if (!level.stream)
 	{
-		MsgError("Unable to export regions - cannot open level file!\n");
+		MsgError("Unable to export regions - level file is not opened!\n");
 		return;
 	}
 
-	CFileStream stream(fp);
+	RegionExportJob_t job;
+	job.level = &level;
+	job.filters = &filters;
+	job.regionsToExport = regionsToExport;
+	job.justLevFilename = justLevFilename;
+	job.levNameOnly = levNameOnly;
+	job.totalRegions = level.map->GetRegionsAcross() * level.map->GetRegionsDown();
+	job.spooledByExport.resize(job.totalRegions, false);
+	job.spewFunc = GetThreadSpewFunction(&job.spewUserData);
 
-	SPOOL_CONTEXT spoolContext;
-	spoolContext.dataStream = &stream;
-	spoolContext.lumpInfo = &g_levInfo;
+	// region output also depends on filters, permanent models and model names
+	job.sharedSourceHash = HashData(&filters, sizeof(filters));
 
-	int totalRegions = g_levMap->GetRegionsAcross() * g_levMap->GetRegionsDown();
-		
-	for (int i = 0; i < totalRegions; i++)
+	for (int i = 0; i < MAX_MODELS; i++)
 	{
-		if (regionsToExport && regionsToExport[i] == false)
-			continue;
+		ModelRef_t* ref = level.models.GetModelByIndex(i);
 
-		// load region
-		// it will also load area data models for it
-		g_levMap->SpoolRegion(spoolContext, i);
+		if (ref && ref->model)
+			job.sharedSourceHash = HashData(ref->model, ref->size, job.sharedSourceHash);
+	}
 
-		CBaseLevelRegion* region = g_levMap->GetRegion(i);
+	// Unity output refers to models by their names
+	if (g_export_worldUnityScript)
+	{
+		const char* modelName;
 
-		if (region->IsEmpty())
-			continue;
+		for (int i = 0; (modelName = level.models.GetModelNameByIndex(i)) != nullptr; i++)
+			job.sharedSourceHash = HashData(modelName, strlen(modelName) + 1, job.sharedSourceHash);
+	}
+
+	const int numThreads = GetNumWorkerThreads(level);
+	MsgInfo("Exporting regions using %d threads\n", numThreads);
 
-		FILE* regionFile = nullptr;
+	// each thread has it's own level stream
+	// they are closed after regions are freed since region data may point into them
+	Array<IVirtualStream*> threadStreams;
+	threadStreams.resize(numThreads, nullptr);
 
-		if(g_export_worldUnityScript)
+	RegionExportThread_t* threads = new RegionExportThread_t[numThreads];
+	int numStarted = 0;
+
+	for (int i = 0; i < numThreads; i++)
+	{
+		threadStreams[i] = OpenLevelStream(level.name);
+
+		if (!threadStreams[i])
 		{
-			regionFile = fopen(String::fromPrintf("%s/regions/%s_reg%d.cs", (char*)File::dirname(g_levname), (char*)levNameOnly, i), "wb");
+			MsgError("Unable to open level file for region export thread %d!\n", i);
+			break;
 		}
-		else
+
+		threads[i].job = &job;
+		threads[i].spoolContext.dataStream = threadStreams[i];
+		threads[i].spoolContext.lumpInfo = &level.info;
+
+		if (!threads[i].thread.start(ExportRegionsThread, &threads[i]))
 		{
-			regionFile = fopen(String::fromPrintf("%s/regions/%s_reg%d.obj", (char*)File::dirname(g_levname), (char*)levNameOnly, i), "wb");
-			fprintf(regionFile, "mtllib %s_LEVELMODEL.mtl\r\n", (char*)justLevFilename);
+			MsgError("Unable to start region export thread %d!\n", i);
+			break;
 		}
 
-		CFileStream regionStream(regionFile);
-		PrintRegionHeader(&regionStream, filters);
+		threads[i].started = true;
+		numStarted++;
+	}
 
-		IVirtualStream* writeStream = g_export_worldUnityScript ? (IVirtualStream*)&tempMemStream : (IVirtualStream*)&regionStream;
+	// do it on this thread if none of workers could start
+	if (numStarted == 0 && threadStreams[0])
+		ExportRegionsThread(&threads[0]);
 
-		Msg("Exporting region %d...", i);
-			
-		int lobj_first_v = 0;
-		int lobj_first_t = 0;
+	for (int i = 0; i < numThreads; i++)
+	{
+		if (threads[i].started)
+			threads[i].thread.join();
+	}
 
-		if (g_levMap->GetFormat() >= LEV_FORMAT_DRIVER2_ALPHA16)
-		{
-			numCellObjectsRead += ExportRegionDriver2((CDriver2LevelRegion*)region, writeStream, filters, lobj_first_v, lobj_first_t);
-		}
-		else
-		{
-			numCellObjectsRead += ExportRegionDriver1((CDriver1LevelRegion*)region, writeStream, filters, lobj_first_v, lobj_first_t);
-		}
+	delete[] threads;
 
-		// format into Unity CS script
-		if (g_export_worldUnityScript)
-		{
-			String regionName = String::fromPrintf("%s_reg%d", (char*)levNameOnly, i);
-				
-			int zero = 0;
-			tempMemStream.Write(&zero, 1, sizeof(zero));
-				
-			fprintf(regionFile, s_UnityScriptTemplate, (char*)regionName, tempMemStream.GetBasePointer());
-			tempMemStream.Seek(0, VS_SEEK_SET);
-		}
+	const int numCellObjectsRead = job.numCellObjectsRead;
 
-		fclose(regionFile);
+	// free everything that was spooled by export threads
+	for (int i = 0; i < job.totalRegions; i++)
+	{
+		CBaseLevelRegion* region = level.map->GetRegion(i);
 
-		Msg("DONE\n");
+		if (region && job.spooledByExport[i])
+			region->FreeAll();
 	}
 
+	for (int i = 0; i < numThreads; i++)
+		CloseLevelStream(threadStreams[i]);
+
 	// @FIXME: it doesn't really match up but still correct
 	//int numCellsObjectsFile = mapInfo.num_cell_objects;
 
 	//if (numCellObjectsRead != numCellsObjectsFile)
 	//	MsgError("numAllObjects mismatch: in file: %d, read %d\n", numCellsObjectsFile, numCellObjectsRead);
 
-	MsgAccept("Successfully exported world\n", (char*)g_levname);
-
-	fclose(fp);
-}
\ No newline at end of file
+	MsgInfo("Area data cache: %d hits, %d misses\n", level.map->GetAreaCacheHits(), level.map->GetAreaCacheMisses());
+	MsgAccept("Successfully exported world\n", (char*)level.name);
+}
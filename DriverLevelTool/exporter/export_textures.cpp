@@ -1,4 +1,5 @@
 #include "driver_level.h"
+#include "exporter/export_manifest.h"
 #include "core/cmdlib.h"
 #include "core/VirtualStream.h"
 
@@ -11,10 +12,7 @@
 #include <nstd/File.hpp>
 #include <nstd/Directory.hpp>
 #include <nstd/Array.hpp>
-
-extern String	g_levname_moddir;
-extern String	g_levname_texdir;
-extern String	g_levname;
+#include <nstd/Time.hpp>
 
 extern bool g_export_textures;
 extern bool g_export_overmap;
@@ -37,7 +35,7 @@ void GetTPageDetailPalettes(Array<TEXCLUT*>& out, CTexturePage* tpage, TexDetail
 //-------------------------------------------------------------
 // writes 4-bit TIM image file from TPAGE
 //-------------------------------------------------------------
-void ExportTIM(CTexturePage* tpage, int detail)
+void ExportTIM(LevelContext_t& level, CTexturePage* tpage, int detail)
 {
 	if (detail < 0 || detail >= tpage->GetDetailCount())
 	{
@@ -62,7 +60,7 @@ void ExportTIM(CTexturePage* tpage, int detail)
 	Array<TEXCLUT*> palettes;
 	GetTPageDetailPalettes(palettes, tpage, texdetail);
 
-	const char* textureName = g_levTextures.GetTextureDetailName(&texdetail->info);
+	const char* textureName = level.textures.GetTextureDetailName(&texdetail->info);
 
 	Msg("Saving %s' %d (xywh: %d %d %d %d)\n", textureName, detail, ox, oy, w, h);
 
@@ -117,7 +115,7 @@ void ExportTIM(CTexturePage* tpage, int detail)
 	}
 
 	// compose TIMs
-	SaveTIM_4bit(String::fromPrintf("%s/PAGE_%d/%s_%d.TIM", (char*)g_levname_texdir, tpage->GetId(), textureName, detail),
+	SaveTIM_4bit(String::fromPrintf("%s/PAGE_%d/%s_%d.TIM", (char*)level.texturesDir, tpage->GetId(), textureName, detail),
 		image_data, img_size, ox, oy, w, h, 
 		(ubyte*)clut_data, palettes.size() );
 
@@ -125,10 +123,40 @@ void ExportTIM(CTexturePage* tpage, int detail)
 	delete[] clut_data;
 }
 
+//-------------------------------------------------------------
+// Hashes texture page bitmap, palettes and details
+//-------------------------------------------------------------
+static uint64 GetTexturePageHash(LevelContext_t& level, CTexturePage* tpage)
+{
+	const TexBitmap_t& bitmap = tpage->GetBitmap();
+
+	uint64 hash = HashData(bitmap.data, TEXPAGE_SIZE / 2);
+	hash = HashData(bitmap.clut, bitmap.numPalettes * sizeof(TEXCLUT), hash);
+
+	for (int i = 0; i < tpage->GetDetailCount(); i++)
+	{
+		TexDetailInfo_t* detail = tpage->GetTextureDetail(i);
+		const char* name = level.textures.GetTextureDetailName(&detail->info);
+
+		hash = HashData(&detail->info, sizeof(TEXINF), hash);
+		hash = HashData(name, strlen(name), hash);
+
+		for (int j = 0; j < 32; j++)
+		{
+			if (detail->extraCLUTs[j])
+				hash = HashData(detail->extraCLUTs[j], sizeof(TEXCLUT), hash);
+			else
+				hash = HashData(&j, sizeof(j), hash);
+		}
+	}
+
+	return hash;
+}
+
 //-------------------------------------------------------------
 // Exports entire texture page
 //-------------------------------------------------------------
-void ExportTexturePage(CTexturePage* tpage)
+void ExportTexturePage(LevelContext_t& level, CTexturePage* tpage)
 {
 	if (!tpage)
 		return;
@@ -145,9 +173,20 @@ void ExportTexturePage(CTexturePage* tpage)
 
 	int numDetails = tpage->GetDetailCount();
 
+	// skip if not changed since last export
+	String manifestKey = String::fromPrintf("tpage/%d", tpage->GetId());
+	String outputFilename = g_explode_tpages ? 
+		String::fromPrintf("%s/PAGE_%d.ini", (char*)level.texturesDir, tpage->GetId()) :
+		String::fromPrintf("%s/PAGE_%d.tga", (char*)level.texturesDir, tpage->GetId());
+
+	const uint64 sourceHash = GetTexturePageHash(level, tpage);
+
+	if (level.exportManifest.IsUpToDate(manifestKey, sourceHash, outputFilename))
+		return;
+
 	// Write an INI file with texture page info
 	{
-		FILE* pIniFile = fopen(String::fromPrintf("%s/PAGE_%d.ini", (char*)g_levname_texdir, tpage->GetId()), "wb");
+		FILE* pIniFile = fopen(String::fromPrintf("%s/PAGE_%d.ini", (char*)level.texturesDir, tpage->GetId()), "wb");
 
 		if (pIniFile)
 		{
@@ -172,7 +211,7 @@ void ExportTexturePage(CTexturePage* tpage)
 
 				fprintf(pIniFile, "[detail_%d]\r\n", i);
 				fprintf(pIniFile, "id=%d\r\n", detail->info.id);
-				fprintf(pIniFile, "name=%s\r\n", g_levTextures.GetTextureDetailName(&detail->info));
+				fprintf(pIniFile, "name=%s\r\n", level.textures.GetTextureDetailName(&detail->info));
 				fprintf(pIniFile, "xywh=%d,%d,%d,%d\r\n",x, y, w, h);
 				fprintf(pIniFile, "\r\n");
 			}
@@ -183,126 +222,223 @@ void ExportTexturePage(CTexturePage* tpage)
 
 	if (g_explode_tpages)
 	{
-		MsgInfo("Exploding texture '%s/PAGE_%d'\n", (char*)g_levname_texdir, tpage->GetId());
+		MsgInfo("Exploding texture '%s/PAGE_%d'\n", (char*)level.texturesDir, tpage->GetId());
 
 		// make folder and place all tims in there
-		Directory::create(String::fromPrintf("%s/PAGE_%d", (char*)g_levname_texdir, tpage->GetId()));
+		Directory::create(String::fromPrintf("%s/PAGE_%d", (char*)level.texturesDir, tpage->GetId()));
 
 		for (int i = 0; i < numDetails; i++)
 		{
-			ExportTIM(tpage, i);
+			ExportTIM(level, tpage, i);
 		}
 
+		level.exportManifest.Update(manifestKey, sourceHash);
 		return;
 	}
 
 #define TEX_CHANNELS 4
 
-	int imgSize = TEXPAGE_SIZE * TEX_CHANNELS;
-
-	uint* color_data = (uint*)malloc(imgSize);
+	const TexturePageVariants_t* variants = level.textureCache.AcquirePage(tpage, true, !g_export_worldUnityScript);
 
-	memset(color_data, 0, imgSize);
+	MsgInfo("Writing texture '%s/PAGE_%d.tga'\n", (char*)level.texturesDir, tpage->GetId());
+	SaveTGA(String::fromPrintf("%s/PAGE_%d.tga", (char*)level.texturesDir, tpage->GetId()), (ubyte*)variants->data[0], TEXPAGE_SIZE_Y, TEXPAGE_SIZE_Y, TEX_CHANNELS);
 
-	// Dump whole TPAGE indexes
-	for (int y = 0; y < 256; y++)
+	// also save different palettes
+	for (int i = 1; i < variants->numVariants; i++)
 	{
-		for (int x = 0; x < 256; x++)
-		{
-			ubyte clindex = bitmap.data[y * 128 + (x >> 1)];
+		MsgInfo("Writing texture %s/PAGE_%d_%d.tga\n", (char*)level.texturesDir, tpage->GetId(), i - 1);
+		SaveTGA(String::fromPrintf("%s/PAGE_%d_%d.tga", (char*)level.texturesDir, tpage->GetId(), i - 1), (ubyte*)variants->data[i], TEXPAGE_SIZE_Y, TEXPAGE_SIZE_Y, TEX_CHANNELS);
+	}
 
-			if (0 != (x & 1))
-				clindex >>= 4;
+	level.textureCache.ReleasePage(variants);
 
-			clindex &= 0xF;
+	level.exportManifest.Update(manifestKey, sourceHash);
+}
 
-			int ypos = (TEXPAGE_SIZE_Y - y - 1) * TEXPAGE_SIZE_Y;
+static void ExportTexturePageJob(void* userData, int pageIdx)
+{
+	LevelContext_t& level = *(LevelContext_t*)userData;
+	ExportTexturePage(level, level.textures.GetTPage(pageIdx));
+}
 
-			color_data[ypos + x] = clindex * 32;
-		}
-	}
+//-------------------------------------------------------------
+// Exports all texture pages
+//-------------------------------------------------------------
+void ExportAllTextures(LevelContext_t& level)
+{
+	// preload area texture pages, already loaded ones are skipped
+	// world export does not keep them as regions are evicted
+	MsgInfo("Preloading area TPages (%d)\n", level.map->GetAreaDataCount());
 
-	for (int i = 0; i < numDetails; i++)
+	// spool from level file that is already opened
+	if (level.stream)
 	{
-		tpage->ConvertIndexedTextureToRGBA(color_data, i, nullptr, true, !g_export_worldUnityScript);
-	}
-
-	MsgInfo("Writing texture '%s/PAGE_%d.tga'\n", (char*)g_levname_texdir, tpage->GetId());
-	SaveTGA(String::fromPrintf("%s/PAGE_%d.tga", (char*)g_levname_texdir, tpage->GetId()), (ubyte*)color_data, TEXPAGE_SIZE_Y, TEXPAGE_SIZE_Y, TEX_CHANNELS);
+		SPOOL_CONTEXT spoolContext;
+		spoolContext.dataStream = level.stream;
+		spoolContext.lumpInfo = &level.info;
 
-	int numPalettes = 0;
-	for (int pal = 0; pal < 16; pal++)
-	{
-		bool anyMatched = false;
+		int numAreas = level.map->GetAreaDataCount();
 
-		for (int j = 0; j < numDetails; j++)
+		for (int i = 0; i < numAreas; i++)
 		{
-			TexDetailInfo_t* detail = tpage->GetTextureDetail(j);
-			
-			if(detail->extraCLUTs[pal])
-			{
-				tpage->ConvertIndexedTextureToRGBA(color_data, j, detail->extraCLUTs[pal], true, !g_export_worldUnityScript);
-				anyMatched = true;
-			}
+			level.map->LoadInAreaTPages(spoolContext, i);
 		}
+	}
+	else
+		MsgError("Unable to preload spooled area TPages!\n");
+
+	// pages are independent from now on
+	MsgInfo("Exporting texture data using %d threads\n", GetNumWorkerThreads(level));
+
+	RunParallelJobs(level, level.textures.GetTPageCount(), ExportTexturePageJob, &level);
+}
 
-		if (anyMatched)
+//-------------------------------------------------------------
+// Old per-texel conversion, kept as reference for -benchtexels
+//-------------------------------------------------------------
+static void ConvertIndexedTextureToRGBAReference(CTexturePage* tpage, uint* dest_color_data, int detail, bool outputBGR)
+{
+	const TexBitmap_t& bitmap = tpage->GetBitmap();
+	const TEXCLUT* clut = &bitmap.clut[detail];
+	const TEXINF& texInfo = tpage->GetTextureDetail(detail)->info;
+
+	const int ox = texInfo.x;
+	const int oy = texInfo.y;
+	const int w = texInfo.width ? texInfo.width : TEXPAGE_SIZE_Y;
+	const int h = texInfo.height ? texInfo.height : TEXPAGE_SIZE_Y;
+
+	for (int y = oy; y < oy + h; y++)
+	{
+		for (int x = ox; x < ox + w; x++)
 		{
-			MsgInfo("Writing texture %s/PAGE_%d_%d.tga\n", (char*)g_levname_texdir, tpage->GetId(), numPalettes);
-			SaveTGA(String::fromPrintf("%s/PAGE_%d_%d.tga", (char*)g_levname_texdir, tpage->GetId(), numPalettes), (ubyte*)color_data, TEXPAGE_SIZE_Y, TEXPAGE_SIZE_Y, TEX_CHANNELS);
-			numPalettes++;
+			ubyte clindex = bitmap.data[y * TEXPAGE_SIZE_X + x / 2];
+
+			if (0 != (x & 1))
+				clindex >>= 4;
+
+			clindex &= 15;
+
+			const int ypos = (TEXPAGE_SIZE_Y - y - 1) * TEXPAGE_SIZE_Y;
+
+			TVec4D<ubyte> color = outputBGR ? rgb5a1_ToBGRA8(clut->colors[clindex]) : rgb5a1_ToRGBA8(clut->colors[clindex]);
+			dest_color_data[ypos + x] = *(uint*)(&color);
 		}
 	}
-
-	free(color_data);
 }
 
 //-------------------------------------------------------------
-// Exports all texture pages
+// Measures texture page conversion with every supported
+// CPU path and checks output against reference conversion
 //-------------------------------------------------------------
-void ExportAllTextures()
+void BenchmarkTextureConversion(LevelContext_t& level)
 {
-	// preload region data if needed
-	if (!g_export_world)
+	Array<CTexturePage*> tpages;
+
+	for (int i = 0; i < level.textures.GetTPageCount(); i++)
 	{
-		MsgInfo("Preloading area TPages (%d)\n", g_levMap->GetAreaDataCount());
+		CTexturePage* tpage = level.textures.GetTPage(i);
 
-		// Open file stream
-		FILE* fp = fopen(g_levname, "rb");
-		if (fp)
-		{
-			CFileStream stream(fp);
+		if (tpage->GetBitmap().data && tpage->GetDetailCount())
+			tpages.append(tpage);
+	}
 
-			SPOOL_CONTEXT spoolContext;
-			spoolContext.dataStream = &stream;
-			spoolContext.lumpInfo = &g_levInfo;
+	if (!tpages.size())
+	{
+		MsgError("Unable to benchmark - no texture pages loaded!\n");
+		return;
+	}
+
+	MsgInfo("Benchmarking texture conversion of %d pages...\n", (int)tpages.size());
+
+	uint* referenceData = (uint*)malloc(TEXPAGE_SIZE * sizeof(uint));
+	uint* colorData = (uint*)malloc(TEXPAGE_SIZE * sizeof(uint));
+
+	const int bestPath = GetTexelExpandPath();
+	double referenceSeconds = 0.0;
+
+	// -1 is reference
+	for (int path = -1; path < TEXEL_EXPAND_PATH_COUNT; path++)
+	{
+		if (path >= 0 && !SetTexelExpandPath(path))
+		{
+			MsgWarning("  %-10s: not supported by CPU\n", GetTexelExpandPathName(path));
+			continue;
+		}
 
-			int numAreas = g_levMap->GetAreaDataCount();
+		int64 totalTicks = 0;
+		int iterations = 0;
+		bool identical = true;
 
-			for (int i = 0; i < numAreas; i++)
+		// run for about a second
+		do
+		{
+			for (usize i = 0; i < tpages.size(); i++)
 			{
-				g_levMap->LoadInAreaTPages(spoolContext, i);
+				CTexturePage* tpage = tpages[i];
+
+				for (int bgr = 0; bgr < 2; bgr++)
+				{
+					memset(colorData, 0, TEXPAGE_SIZE * sizeof(uint));
+
+					const int64 startTicks = Time::microTicks();
+
+					for (int j = 0; j < tpage->GetDetailCount(); j++)
+					{
+						if (path < 0)
+							ConvertIndexedTextureToRGBAReference(tpage, colorData, j, bgr);
+						else
+							tpage->ConvertIndexedTextureToRGBA(colorData, j, nullptr, bgr, true);
+					}
+
+					totalTicks += Time::microTicks() - startTicks;
+
+					// check only first run, reference is computed again
+					if (path >= 0 && iterations == 0)
+					{
+						memset(referenceData, 0, TEXPAGE_SIZE * sizeof(uint));
+
+						for (int j = 0; j < tpage->GetDetailCount(); j++)
+							ConvertIndexedTextureToRGBAReference(tpage, referenceData, j, bgr);
+
+						if (memcmp(referenceData, colorData, TEXPAGE_SIZE * sizeof(uint)))
+						{
+							MsgError("  %s output of page %d differs from reference!\n", GetTexelExpandPathName(path), tpage->GetId());
+							identical = false;
+						}
+					}
+				}
 			}
 
-			fclose(fp);
+			iterations++;
+		} while (totalTicks < 1000000 && iterations < 1000);
+
+		const double seconds = (double)totalTicks / 1000000.0 / iterations;
+		const double mpixPerSecond = seconds > 0.0 ? (double)tpages.size() * 2 * TEXPAGE_SIZE / 1000000.0 / seconds : 0.0;
+
+		if (path < 0)
+		{
+			referenceSeconds = seconds;
+			MsgInfo("  %-10s: %.3f ms, %.1f Mpix/s (%d runs)\n", "reference", seconds * 1000.0, mpixPerSecond, iterations);
 		}
 		else
-			MsgError("Unable to preload spooled area TPages!\n");
+		{
+			MsgInfo("  %-10s: %.3f ms, %.1f Mpix/s (%d runs), %.2fx faster, %s\n", GetTexelExpandPathName(path), seconds * 1000.0, mpixPerSecond, iterations,
+				seconds > 0.0 ? referenceSeconds / seconds : 0.0, identical ? "identical" : "MISMATCH");
+		}
 	}
 
-	MsgInfo("Exporting texture data\n");
-	for (int i = 0; i < g_levTextures.GetTPageCount(); i++)
-	{
-		ExportTexturePage(g_levTextures.GetTPage(i));
-	}
+	SetTexelExpandPath(bestPath);
+
+	free(referenceData);
+	free(colorData);
 }
 
 //-------------------------------------------------------------
 // converts and writes TGA file of overlay map
 //-------------------------------------------------------------
-void ExportOverlayMap()
+void ExportOverlayMap(LevelContext_t& level)
 {
-	const int numValid = g_levTextures.GetOverlayMapSegmentCount();
+	const int numValid = level.textures.GetOverlayMapSegmentCount();
 
 	MsgWarning("overlay map segment count: %d\n", numValid);
 
@@ -330,7 +466,7 @@ void ExportOverlayMap()
 		{
 			int idx = x + y * wide;
 
-			g_levTextures.GetOverlayMapSegmentRGBA(tempSegment, x + y * wide, true);
+			level.textures.GetOverlayMapSegmentRGBA(tempSegment, x + y * wide, true);
 
 			numTilesProcessed++;
 
@@ -353,7 +489,91 @@ void ExportOverlayMap()
 		MsgWarning("Missed tiles: %d\n", numValid-numTilesProcessed);
 	}
 
-	SaveTGA(String::fromPrintf("%s/MAP.tga", (char*)g_levname_texdir), (ubyte*)rgba, overmapWidth, overmapHeight, TEX_CHANNELS);
+	SaveTGA(String::fromPrintf("%s/MAP.tga", (char*)level.texturesDir), (ubyte*)rgba, overmapWidth, overmapHeight, TEX_CHANNELS);
 
 	delete[] rgba;
-}
\ No newline at end of file
+}
+
+//-------------------------------------------------------------
+// Measures overlay map RNC2 unpacking with old and table driven
+// decoders and checks they give the same result
+//-------------------------------------------------------------
+void BenchmarkOverlayMapUnpack(LevelContext_t& level)
+{
+	Array<char*> segments;
+
+	for (int i = 0; i < 256; i++)
+	{
+		char* rncData = level.textures.GetOverlayMapSegmentData(i);
+
+		if (rncData)
+			segments.append(rncData);
+	}
+
+	if (!segments.size())
+	{
+		MsgError("Unable to benchmark - no overlay map loaded!\n");
+		return;
+	}
+
+	MsgInfo("Benchmarking RNC2 unpacking of %d overlay map segments...\n", (int)segments.size());
+
+	// same as GetOverlayMapSegmentRGBA
+	const int segmentSize = 16 * 32;
+
+	char* referenceData = new char[segments.size() * segmentSize];
+	char* unpackedData = new char[segments.size() * segmentSize];
+
+	memset(referenceData, 0, segments.size() * segmentSize);
+	memset(unpackedData, 0, segments.size() * segmentSize);
+
+	const char* decoderNames[] = { "reference", "table" };
+	double decoderSeconds[2];
+
+	for (int i = 0; i < 2; i++)
+	{
+		char* dest = i == 0 ? referenceData : unpackedData;
+
+		int64 totalTicks = 0;
+		int iterations = 0;
+
+		// run for about a second
+		do
+		{
+			const int64 startTicks = Time::microTicks();
+
+			for (usize j = 0; j < segments.size(); j++)
+			{
+				if (i == 0)
+					UnpackRNCReference(segments[j], dest + j * segmentSize);
+				else
+					UnpackRNC(segments[j], dest + j * segmentSize);
+			}
+
+			totalTicks += Time::microTicks() - startTicks;
+			iterations++;
+		} while (totalTicks < 1000000 && iterations < 1000);
+
+		decoderSeconds[i] = (double)totalTicks / 1000000.0 / iterations;
+
+		const double mbPerSecond = decoderSeconds[i] > 0.0 ? (double)segments.size() * segmentSize / (1024.0 * 1024.0) / decoderSeconds[i] : 0.0;
+
+		MsgInfo("  %-10s: %.3f ms, %.1f MB/s (%d runs)\n", decoderNames[i], decoderSeconds[i] * 1000.0, mbPerSecond, iterations);
+	}
+
+	int numMismatched = 0;
+
+	for (usize j = 0; j < segments.size(); j++)
+	{
+		if (memcmp(referenceData + j * segmentSize, unpackedData + j * segmentSize, segmentSize))
+			numMismatched++;
+	}
+
+	if (numMismatched)
+		MsgError("%d segments differ from reference decoder!\n", numMismatched);
+	else if (decoderSeconds[1] > 0.0)
+		MsgAccept("Output is identical, table decoder is %.2fx faster\n", decoderSeconds[0] / decoderSeconds[1]);
+
+	delete[] referenceData;
+	delete[] unpackedData;
+}
@@ -0,0 +1,80 @@
+#include "driver_level.h"
+#include "driver_routines/level.h"
+
+#include "core/cmdlib.h"
+
+#include "driver_routines/regions_d1.h"
+#include "driver_routines/regions_d2.h"
+
+static void WalkRegionDriver1(LevelContext_t& level, CDriver1LevelRegion* region, CellObjectFunc_t func, void* userData)
+{
+	CDriver1LevelMap* levMapDriver1 = (CDriver1LevelMap*)level.map;
+	const OUT_CELL_FILE_HEADER& mapInfo = levMapDriver1->GetMapInfo();
+
+	CELL_ITERATOR_CACHE cache;
+
+	for (int i = 0; i < mapInfo.region_size * mapInfo.region_size; i++)
+	{
+		CELL_ITERATOR_D1 iterator;
+		iterator.cache = &cache;
+
+		for (CELL_OBJECT* co = region->StartIterator(&iterator, i); co; co = levMapDriver1->GetNextCop(&iterator))
+			func(userData, *co, region->GetNumber(), i);
+	}
+}
+
+static void WalkRegionDriver2(LevelContext_t& level, CDriver2LevelRegion* region, CellObjectFunc_t func, void* userData)
+{
+	CDriver2LevelMap* levMapDriver2 = (CDriver2LevelMap*)level.map;
+	const OUT_CELL_FILE_HEADER& mapInfo = levMapDriver2->GetMapInfo();
+
+	CELL_ITERATOR_CACHE cache;
+
+	for (int i = 0; i < mapInfo.region_size * mapInfo.region_size; i++)
+	{
+		CELL_ITERATOR_D2 ci;
+		ci.cache = &cache;
+
+		for (PACKED_CELL_OBJECT* pco = region->StartIterator(&ci, i); pco; pco = levMapDriver2->GetNextPackedCop(&ci))
+		{
+			CELL_OBJECT co;
+			CDriver2LevelMap::UnpackCellObject(co, pco, ci.nearCell);
+
+			func(userData, co, region->GetNumber(), i);
+		}
+	}
+}
+
+//-------------------------------------------------------------
+// Spools every region and walks it's cell objects
+// Regions are freed right after, only area data is cached
+//-------------------------------------------------------------
+void ForEachWorldCellObject(LevelContext_t& level, CellObjectFunc_t func, void* userData)
+{
+	SPOOL_CONTEXT spoolContext;
+	spoolContext.dataStream = level.stream;
+	spoolContext.lumpInfo = &level.info;
+
+	const int totalRegions = level.map->GetRegionsAcross() * level.map->GetRegionsDown();
+
+	for (int i = 0; i < totalRegions; i++)
+	{
+		// regions that were already resident must stay
+		const bool spooled = level.map->SpoolRegion(spoolContext, i);
+
+		CBaseLevelRegion* region = level.map->GetRegion(i);
+
+		if (!region->IsEmpty())
+		{
+			if (level.map->GetFormat() >= LEV_FORMAT_DRIVER2_ALPHA16)
+				WalkRegionDriver2(level, (CDriver2LevelRegion*)region, func, userData);
+			else
+				WalkRegionDriver1(level, (CDriver1LevelRegion*)region, func, userData);
+		}
+
+		if (spooled)
+			region->FreeAll();
+
+		level.map->TrimRegionCache();
+	}
+}
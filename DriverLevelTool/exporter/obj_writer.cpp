@@ -0,0 +1,231 @@
+#include "obj_writer.h"
+
+#include <string.h>
+
+#include "core/IVirtualStream.h"
+
+#define OBJ_MAX_NUMBER_CHARS		48		// longest formatted number plus separators
+
+static const uint64 s_powersOf10[] = {
+	1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL,
+	10000000ULL, 100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL
+};
+
+static char* FormatUnsigned(char* out, uint64 value)
+{
+	char temp[24];
+	int len = 0;
+
+	do
+	{
+		temp[len++] = '0' + (char)(value % 10);
+		value /= 10;
+	} while (value);
+
+	while (len)
+		*out++ = temp[--len];
+
+	return out;
+}
+
+static char* FormatFloat(char* out, float value)
+{
+	double v = value;
+
+	// NaN, infinity or garbage is not valid for OBJ
+	if (v != v || v > 1e18 || v < -1e18)
+	{
+		*out++ = '0';
+		return out;
+	}
+
+	const bool negative = v < 0.0;
+	if (negative)
+		v = -v;
+
+	// choose number of decimals for 6 significant digits
+	int decimals;
+	if (v >= 1.0)
+	{
+		int intDigits = 1;
+		double limit = 10.0;
+
+		while (intDigits < 6 && v >= limit)
+		{
+			intDigits++;
+			limit *= 10.0;
+		}
+
+		decimals = 6 - intDigits;
+	}
+	else
+	{
+		decimals = 6;
+		double limit = 0.1;
+
+		while (decimals < 12 && v < limit)
+		{
+			decimals++;
+			limit *= 0.1;
+		}
+	}
+
+	const uint64 scaled = (uint64)(v * (double)s_powersOf10[decimals] + 0.5);
+	uint64 fracPart = scaled % s_powersOf10[decimals];
+
+	if (negative && scaled)
+		*out++ = '-';
+
+	out = FormatUnsigned(out, scaled / s_powersOf10[decimals]);
+
+	if (fracPart)
+	{
+		while (fracPart % 10 == 0)
+		{
+			fracPart /= 10;
+			decimals--;
+		}
+
+		*out++ = '.';
+
+		// zero padded fraction
+		char* end = out + decimals;
+		for (char* p = end; p > out; )
+		{
+			*--p = '0' + (char)(fracPart % 10);
+			fracPart /= 10;
+		}
+
+		out = end;
+	}
+
+	return out;
+}
+
+//-------------------------------------------------------------
+
+CObjWriter::CObjWriter(IVirtualStream* stream) : m_stream(stream), m_bytesWritten(0), m_used(0)
+{
+}
+
+CObjWriter::~CObjWriter()
+{
+	Flush();
+}
+
+void CObjWriter::Flush()
+{
+	if (m_used > 0)
+		m_stream->Write(m_buffer, 1, m_used);
+
+	m_bytesWritten += m_used;
+	m_used = 0;
+}
+
+int64 CObjWriter::GetBytesWritten() const
+{
+	return m_bytesWritten + m_used;
+}
+
+void CObjWriter::Reserve(int size)
+{
+	if (m_used + size > OBJ_WRITER_BUFFER_SIZE)
+		Flush();
+}
+
+void CObjWriter::WriteString(const char* str)
+{
+	int len = strlen(str);
+
+	while (len > 0)
+	{
+		if (m_used == OBJ_WRITER_BUFFER_SIZE)
+			Flush();
+
+		int count = OBJ_WRITER_BUFFER_SIZE - m_used;
+		if (count > len)
+			count = len;
+
+		memcpy(m_buffer + m_used, str, count);
+		m_used += count;
+		str += count;
+		len -= count;
+	}
+}
+
+void CObjWriter::WriteChar(char c)
+{
+	Reserve(1);
+	m_buffer[m_used++] = c;
+}
+
+void CObjWriter::WriteInt(int value)
+{
+	Reserve(OBJ_MAX_NUMBER_CHARS);
+
+	char* out = m_buffer + m_used;
+	char* start = out;
+
+	if (value < 0)
+	{
+		*out++ = '-';
+		out = FormatUnsigned(out, (uint64)(-(int64)value));
+	}
+	else
+		out = FormatUnsigned(out, (uint64)value);
+
+	m_used += out - start;
+}
+
+void CObjWriter::WriteFloat(float value)
+{
+	Reserve(OBJ_MAX_NUMBER_CHARS);
+
+	char* out = m_buffer + m_used;
+	m_used += FormatFloat(out, value) - out;
+}
+
+void CObjWriter::WriteNewLine()
+{
+	Reserve(2);
+	m_buffer[m_used++] = '\r';
+	m_buffer[m_used++] = '\n';
+}
+
+void CObjWriter::WriteVector2(const char* tag, float x, float y)
+{
+	WriteString(tag);
+	Reserve(OBJ_MAX_NUMBER_CHARS * 2);
+
+	char* out = m_buffer + m_used;
+	char* start = out;
+
+	*out++ = ' ';
+	out = FormatFloat(out, x);
+	*out++ = ' ';
+	out = FormatFloat(out, y);
+	*out++ = '\r';
+	*out++ = '\n';
+
+	m_used += out - start;
+}
+
+void CObjWriter::WriteVector3(const char* tag, float x, float y, float z)
+{
+	WriteString(tag);
+	Reserve(OBJ_MAX_NUMBER_CHARS * 3);
+
+	char* out = m_buffer + m_used;
+	char* start = out;
+
+	*out++ = ' ';
+	out = FormatFloat(out, x);
+	*out++ = ' ';
+	out = FormatFloat(out, y);
+	*out++ = ' ';
+	out = FormatFloat(out, z);
+	*out++ = '\r';
+	*out++ = '\n';
+
+	m_used += out - start;
+}
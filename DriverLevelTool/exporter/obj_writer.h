@@ -0,0 +1,49 @@
+#ifndef OBJ_WRITER_H
+#define OBJ_WRITER_H
+
+#include "core/dktypes.h"
+
+class IVirtualStream;
+
+//----------------------------------------------------------------------------------
+// Buffered Wavefront OBJ text writer
+// Numbers are formatted without printf so output does not depend on locale.
+// Buffer is owned by writer, so each thread can use it's own writer
+//----------------------------------------------------------------------------------
+
+#define OBJ_WRITER_BUFFER_SIZE		(16 * 1024)
+
+class CObjWriter
+{
+public:
+	CObjWriter(IVirtualStream* stream);
+	~CObjWriter();
+
+	// writes buffered text into stream
+	void				Flush();
+
+	void				WriteString(const char* str);
+	void				WriteChar(char c);
+	void				WriteInt(int value);
+
+	// up to 6 significant digits like %g, but never uses exponent
+	void				WriteFloat(float value);
+
+	void				WriteNewLine();
+
+	// "<tag> x y\r\n" and "<tag> x y z\r\n"
+	void				WriteVector2(const char* tag, float x, float y);
+	void				WriteVector3(const char* tag, float x, float y, float z);
+
+	int64				GetBytesWritten() const;
+
+protected:
+	void				Reserve(int size);
+
+	IVirtualStream*		m_stream;
+	int64				m_bytesWritten;
+	int					m_used;
+	char				m_buffer[OBJ_WRITER_BUFFER_SIZE];
+};
+
+#endif // OBJ_WRITER_H
@@ -0,0 +1,302 @@
+#include "texture_cache.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <nstd/Array.hpp>
+#include <nstd/String.hpp>
+
+#include "core/cmdlib.h"
+#include "driver_routines/textures.h"
+#include "exporter/export_manifest.h"
+
+struct CTextureVariantCache::Entry_t : TexturePageVariants_t
+{
+	uint64		clutHash{ 0 };
+	uint		key{ 0 };
+	int			refs{ 0 };
+	int64		lastUseTick{ 0 };
+	int64		sizeBytes{ 0 };
+	bool		stale{ false };		// replaced while in use, freed on release
+};
+
+// page bitmap is the same for page id, only palettes are hashed
+static uint64 GetPageCLUTHash(CTexturePage* tpage)
+{
+	const TexBitmap_t& bitmap = tpage->GetBitmap();
+
+	uint64 hash = HashData(bitmap.clut, bitmap.numPalettes * sizeof(TEXCLUT));
+
+	for (int i = 0; i < tpage->GetDetailCount(); i++)
+	{
+		TexDetailInfo_t* detail = tpage->GetTextureDetail(i);
+
+		for (int pal = 0; pal < MAX_TEXTURE_VARIANTS - 1; pal++)
+		{
+			if (detail->extraCLUTs[pal])
+				hash = HashData(detail->extraCLUTs[pal], sizeof(TEXCLUT), hash);
+			else
+				hash = HashData(&pal, sizeof(pal), hash);
+		}
+	}
+
+	return hash;
+}
+
+//-------------------------------------------------------------
+
+CTextureVariantCache::CTextureVariantCache()
+{
+}
+
+CTextureVariantCache::~CTextureVariantCache()
+{
+	Clear();
+}
+
+void CTextureVariantCache::SetBudget(int64 budgetBytes)
+{
+	Mutex::Guard guard(m_mutex);
+	m_budgetBytes = budgetBytes;
+}
+
+//-------------------------------------------------------------
+// Converts page with base palettes and every extra CLUT set
+//-------------------------------------------------------------
+CTextureVariantCache::Entry_t* CTextureVariantCache::ConvertPage(CTexturePage* tpage, bool outputBGR, bool originalTransparencyKey)
+{
+	const int imgSize = TEXPAGE_SIZE * sizeof(uint);
+	const int numDetails = tpage->GetDetailCount();
+
+	Entry_t* entry = new Entry_t();
+
+	uint* color_data = (uint*)malloc(imgSize);
+
+	// texels not covered by details show their indexes
+	tpage->ConvertIndexesToRGBA(color_data);
+
+	for (int i = 0; i < numDetails; i++)
+		tpage->ConvertIndexedTextureToRGBA(color_data, i, nullptr, outputBGR, originalTransparencyKey);
+
+	entry->data[entry->numVariants++] = color_data;
+
+	// each palette set is drawn over previous variant
+	for (int pal = 0; pal < MAX_TEXTURE_VARIANTS - 1; pal++)
+	{
+		uint* variant_data = nullptr;
+
+		for (int j = 0; j < numDetails; j++)
+		{
+			TexDetailInfo_t* detail = tpage->GetTextureDetail(j);
+
+			if (!detail->extraCLUTs[pal])
+				continue;
+
+			if (!variant_data)
+			{
+				variant_data = (uint*)malloc(imgSize);
+				memcpy(variant_data, color_data, imgSize);
+			}
+
+			tpage->ConvertIndexedTextureToRGBA(variant_data, j, detail->extraCLUTs[pal], outputBGR, originalTransparencyKey);
+		}
+
+		if (variant_data)
+		{
+			entry->data[entry->numVariants++] = variant_data;
+			color_data = variant_data;
+		}
+	}
+
+	entry->sizeBytes = (int64)entry->numVariants * imgSize;
+
+	return entry;
+}
+
+void CTextureVariantCache::FreeEntry(Entry_t* entry)
+{
+	for (int i = 0; i < entry->numVariants; i++)
+		free(entry->data[i]);
+
+	delete entry;
+}
+
+//-------------------------------------------------------------
+// Returns converted page variants
+//-------------------------------------------------------------
+const TexturePageVariants_t* CTextureVariantCache::AcquirePage(CTexturePage* tpage, bool outputBGR, bool originalTransparencyKey)
+{
+	if (!tpage || !tpage->GetBitmap().data)
+		return nullptr;
+
+	const uint key = (tpage->GetId() << 2) | (outputBGR ? 1 : 0) | (originalTransparencyKey ? 2 : 0);
+	const uint64 clutHash = GetPageCLUTHash(tpage);
+
+	{
+		Mutex::Guard guard(m_mutex);
+
+		HashMap<uint, Entry_t*>::Iterator it = m_entries.find(key);
+
+		if (it != m_entries.end() && (*it)->clutHash == clutHash)
+		{
+			Entry_t* entry = *it;
+
+			entry->refs++;
+			entry->lastUseTick = ++m_useTick;
+			m_numHits++;
+
+			return entry;
+		}
+	}
+
+	// convert without lock, other pages may be converted meanwhile
+	Entry_t* newEntry = ConvertPage(tpage, outputBGR, originalTransparencyKey);
+	newEntry->clutHash = clutHash;
+	newEntry->key = key;
+
+	Mutex::Guard guard(m_mutex);
+
+	m_numConversions++;
+
+	HashMap<uint, Entry_t*>::Iterator it = m_entries.find(key);
+
+	if (it != m_entries.end())
+	{
+		Entry_t* entry = *it;
+
+		// converted by other thread
+		if (entry->clutHash == clutHash)
+		{
+			FreeEntry(newEntry);
+
+			entry->refs++;
+			entry->lastUseTick = ++m_useTick;
+
+			return entry;
+		}
+
+		// palettes were changed
+		m_entries.remove(it);
+
+		if (entry->refs > 0)
+		{
+			entry->stale = true;
+		}
+		else
+		{
+			m_residentBytes -= entry->sizeBytes;
+			FreeEntry(entry);
+		}
+	}
+
+	newEntry->refs = 1;
+	newEntry->lastUseTick = ++m_useTick;
+
+	m_entries.append(key, newEntry);
+	m_residentBytes += newEntry->sizeBytes;
+
+	if (m_residentBytes > m_peakResidentBytes)
+		m_peakResidentBytes = m_residentBytes;
+
+	Trim();
+
+	return newEntry;
+}
+
+void CTextureVariantCache::ReleasePage(const TexturePageVariants_t* variants)
+{
+	if (!variants)
+		return;
+
+	Mutex::Guard guard(m_mutex);
+
+	Entry_t* entry = (Entry_t*)variants;
+	entry->refs--;
+
+	if (entry->stale && entry->refs <= 0)
+	{
+		m_residentBytes -= entry->sizeBytes;
+		FreeEntry(entry);
+	}
+
+	Trim();
+}
+
+//-------------------------------------------------------------
+// Frees least recently used pages that are not in use
+// while cache is over the budget. Must be called under lock
+//-------------------------------------------------------------
+void CTextureVariantCache::Trim()
+{
+	if (m_budgetBytes <= 0 || m_residentBytes <= m_budgetBytes)
+		return;
+
+	Array<Entry_t*> candidates;
+	candidates.reserve(m_entries.size());
+
+	for (HashMap<uint, Entry_t*>::Iterator it = m_entries.begin(); it != m_entries.end(); ++it)
+	{
+		if ((*it)->refs <= 0)
+			candidates.append(*it);
+	}
+
+	// least recently used first
+	if (candidates.size())
+	{
+		qsort(&candidates[0], candidates.size(), sizeof(Entry_t*), [](const void* a, const void* b) {
+			const Entry_t* ea = *(const Entry_t**)a;
+			const Entry_t* eb = *(const Entry_t**)b;
+
+			return ea->lastUseTick < eb->lastUseTick ? -1 : (ea->lastUseTick > eb->lastUseTick ? 1 : 0);
+		});
+	}
+
+	for (usize i = 0; i < candidates.size() && m_residentBytes > m_budgetBytes; i++)
+	{
+		Entry_t* entry = candidates[i];
+
+		m_entries.remove(entry->key);
+		m_residentBytes -= entry->sizeBytes;
+
+		FreeEntry(entry);
+	}
+}
+
+//-------------------------------------------------------------
+// Frees all cached pages, ones in use are freed on release
+//-------------------------------------------------------------
+void CTextureVariantCache::Clear()
+{
+	Mutex::Guard guard(m_mutex);
+
+	for (HashMap<uint, Entry_t*>::Iterator it = m_entries.begin(); it != m_entries.end(); ++it)
+	{
+		Entry_t* entry = *it;
+
+		if (entry->refs > 0)
+		{
+			entry->stale = true;
+			continue;
+		}
+
+		m_residentBytes -= entry->sizeBytes;
+		FreeEntry(entry);
+	}
+
+	m_entries.clear();
+}
+
+int64 CTextureVariantCache::GetPeakResidentBytes() const
+{
+	return m_peakResidentBytes;
+}
+
+int CTextureVariantCache::GetNumHits() const
+{
+	return m_numHits;
+}
+
+int CTextureVariantCache::GetNumConversions() const
+{
+	return m_numConversions;
+}
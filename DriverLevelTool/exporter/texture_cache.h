@@ -0,0 +1,64 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <nstd/HashMap.hpp>
+#include <nstd/Mutex.hpp>
+
+#include "core/dktypes.h"
+
+class CTexturePage;
+
+//----------------------------------------------------------------------------------
+// Converted texture cache
+// Keeps RGBA/BGRA conversions of texture pages with all their palette variants,
+// so re-spooled pages in viewer and repeated exports are not converted again
+//----------------------------------------------------------------------------------
+
+#define MAX_TEXTURE_VARIANTS		17		// base palettes + 16 extra CLUT sets
+
+struct TexturePageVariants_t
+{
+	// [0] uses base palettes, next ones have extra CLUTs applied on top of previous
+	uint*		data[MAX_TEXTURE_VARIANTS];
+	int			numVariants{ 0 };
+};
+
+class CTextureVariantCache
+{
+public:
+	CTextureVariantCache();
+	~CTextureVariantCache();
+
+	void							SetBudget(int64 budgetBytes);		// 0 means unlimited
+
+	// converts page or takes it from cache. Must be released after use
+	const TexturePageVariants_t*	AcquirePage(CTexturePage* tpage, bool outputBGR, bool originalTransparencyKey);
+	void							ReleasePage(const TexturePageVariants_t* variants);
+
+	void							Clear();
+
+	int64							GetPeakResidentBytes() const;
+	int								GetNumHits() const;
+	int								GetNumConversions() const;
+
+protected:
+	struct Entry_t;
+
+	static Entry_t*					ConvertPage(CTexturePage* tpage, bool outputBGR, bool originalTransparencyKey);
+	static void						FreeEntry(Entry_t* entry);
+
+	void							Trim();
+
+	Mutex							m_mutex;
+	HashMap<uint, Entry_t*>			m_entries;
+
+	int64							m_budgetBytes{ 0 };
+	int64							m_residentBytes{ 0 };
+	int64							m_peakResidentBytes{ 0 };
+	int64							m_useTick{ 0 };
+
+	int								m_numHits{ 0 };
+	int								m_numConversions{ 0 };
+};
+
+#endif // TEXTURE_CACHE_H
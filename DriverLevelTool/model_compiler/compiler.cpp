@@ -16,8 +16,6 @@
 
 #include "core/cmdlib.h"
 
-extern String	g_levname;
-
 struct CompilerTPage
 {
 	int		id{ -1 };
@@ -71,7 +69,7 @@ static void FreeTextureDetails()
 //--------------------------------------------------------------------------
 // Loads INI files to get a clue of texture details
 //--------------------------------------------------------------------------
-static void InitTextureDetailsForModel(smdmodel_t* model)
+static void InitTextureDetailsForModel(smdmodel_t* model, const char* levFilename)
 {
 	// get texture pages from source model
 	Array<int> tpage_ids;
@@ -94,7 +92,8 @@ static void InitTextureDetailsForModel(smdmodel_t* model)
 	g_compilerTPages = new CompilerTPage[textured_groups.size()];
 	g_numCompilerTPages = textured_groups.size();
 
-	String lev_no_ext = File::dirname(g_levname) + "/" + File::basename(g_levname, File::extension(g_levname));
+	String levname = String::fromCString(levFilename);
+	String lev_no_ext = File::dirname(levname) + "/" + File::basename(levname, File::extension(levname));
 
 	// load INI files
 	for(usize i = 0; i < textured_groups.size(); i++)
@@ -541,11 +540,11 @@ static MODEL* CompileMDL(CMemoryStream* stream, smdmodel_t* model, int& resultSi
 //--------------------------------------------------------------------------
 // Compiler function
 //--------------------------------------------------------------------------
-void CompileOBJModelToMDL(const char* filename, const char* outputName, bool generate_denting)
+void CompileOBJModelToMDL(const char* levFilename, const char* filename, const char* outputName, bool generate_denting)
 {
 	smdmodel_t model;
 
-	if(g_levname.length() == 0)
+	if(!levFilename || strlen(levFilename) == 0)
 	{
 		MsgError("Level name must be specified!\n");
 		return;
@@ -570,7 +569,7 @@ void CompileOBJModelToMDL(const char* filename, const char* outputName, bool gen
 		return;
 	}
 
-	InitTextureDetailsForModel(&model);
+	InitTextureDetailsForModel(&model, levFilename);
 
 	CMemoryStream stream;
 	stream.Open(nullptr, VS_OPEN_WRITE, 512 * 1024);
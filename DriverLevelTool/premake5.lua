@@ -24,7 +24,8 @@ project "DriverLevelTool"
             "-fpermissive",
         }
 		links {
-			"dl"
+			"dl",
+			"pthread"
         }
         
         cppdialect "C++11"
@@ -6,10 +6,12 @@
 #include "rendermodel.h"
 
 #include "math/Volume.h"
+#include "driver_routines/spooler.h"
 
 #include "convert.h"
 
 extern bool g_displayHeightMap;
+extern CRegionSpooler g_regionSpooler;
 
 const float Z_NEAR = 0.01f;
 const float Z_FAR = 100.0f;
@@ -28,7 +30,7 @@ Vector3D g_cameraMoveDir(0);
 //-------------------------------------------------------
 // Updates camera movement for level viewer
 //-------------------------------------------------------
-void UpdateCameraMovement(float deltaTime, float speedModifier)
+void UpdateCameraMovement(LevelContext_t& level, float deltaTime, float speedModifier)
 {
 	Vector3D forward, right;
 	AngleVectors(g_cameraAngles, &forward, &right);
@@ -54,9 +56,16 @@ void UpdateCameraMovement(float deltaTime, float speedModifier)
 
 	VECTOR_NOPAD cameraPosition = ToFixedVector(g_cameraPosition);
 
+	// no collision until camera region is spooled
+	XZPAIR cameraCell;
+	level.map->WorldPositionToCellXZ(cameraCell, cameraPosition, { -512, -512 });
+
+	if (!g_regionSpooler.IsRegionReady(level.map->GetRegionIndex(cameraCell)))
+		return;
+
 	VECTOR_NOPAD outCameraPos;
 	sdPlane outPlane;
-	g_levMap->FindSurface(cameraPosition, outCameraPos, outPlane);
+	level.map->FindSurface(cameraPosition, outCameraPos, outPlane);
 
 	// debug display
 	/*if (g_displayHeightMap)
@@ -64,7 +73,7 @@ void UpdateCameraMovement(float deltaTime, float speedModifier)
 		// draw the cell
 		VECTOR_NOPAD cameraCell = cameraPosition;
 		cameraCell.vy = outCameraPos.vy;
-		DebugDrawDriver2HeightmapCell(cameraCell);
+		DebugDrawDriver2HeightmapCell(level, cameraCell);
 	}*/
 
 	if (cameraPosition.vy < outCameraPos.vy)
@@ -4,6 +4,7 @@
 #include "math/Vector.h"
 
 class Volume;
+struct LevelContext_t;
 
 extern Vector3D g_cameraVelocity;
 extern Vector3D g_cameraPosition;
@@ -11,7 +12,7 @@ extern Vector3D g_cameraAngles;
 
 extern Vector3D g_cameraMoveDir;
 
-void UpdateCameraMovement(float deltaTime, float speedModifier);
+void UpdateCameraMovement(LevelContext_t& level, float deltaTime, float speedModifier);
 
 void SetupCameraViewAndMatrices(const Vector3D& cameraPosition, const Vector3D& cameraAngles, Volume& outFrustum);
 
@@ -2,14 +2,16 @@
 #include <utility>
 
 #include "debug_overlay.h"
+#include "driver_level.h"
 #include "driver_routines/regions_d2.h"
+#include "driver_routines/spooler.h"
 #include "math/isin.h"
 #include "math/Vector.h"
 #include "math/Plane.h"
 #include "core/cmdlib.h"
 #include "util/util.h"
 
-extern CBaseLevelMap* g_levMap;
+extern CRegionSpooler g_regionSpooler;
 
 struct HeightmapDebugData
 {
@@ -17,11 +19,13 @@ struct HeightmapDebugData
 	Array<std::pair<sdNode, int>>	nodeStack;
 	VECTOR_NOPAD	cellPos;
 	int				planeIdx{ 0 };
+
+	const DRIVER2_CURVE*			curves{ nullptr };
 };
 
 extern int SdHeightOnPlane(const VECTOR_NOPAD& position, const sdPlane* plane, const DRIVER2_CURVE* curves);
 
-static void MakeVertexPlane(Array<Vector3D>& verts, sdPlane& plane, const Vector3D& origin, float size)
+static void MakeVertexPlane(Array<Vector3D>& verts, sdPlane& plane, const DRIVER2_CURVE* curves, const Vector3D& origin, float size)
 {
 	verts.clear();
 	verts.reserve(4);
@@ -39,7 +43,7 @@ static void MakeVertexPlane(Array<Vector3D>& verts, sdPlane& plane, const Vector
 		VECTOR_NOPAD vec{ tmp.x, 0, tmp.z };
 
 		// use fixed point because floats sucks (getting lots of incorrect heights)
-		points[i].y = SdHeightOnPlane(vec, &plane, ((CDriver2LevelMap*)g_levMap)->GetCurve(0x4000)) / ONE_F;
+		points[i].y = SdHeightOnPlane(vec, &plane, curves) / ONE_F;
 		points[i].x += origin.x;
 		points[i].z += origin.z;
 	}
@@ -148,7 +152,7 @@ static void DebugDriver2SdCell_R(int level, sdNode* parent, sdNode* node, sdPlan
 			Plane plane;
 			plane.normal = normalize(Vector3D(pl.a, pl.b, pl.c) / 16384.0f);
 			plane.offset = pl.d / ONE_F;
-			MakeVertexPlane(dbgData.planeVerts, pl, cpos, 512 / ONE_F);
+			MakeVertexPlane(dbgData.planeVerts, pl, dbgData.curves, cpos, 512 / ONE_F);
 		}
 
 		// clip surface by planes
@@ -207,7 +211,7 @@ static void DebugDriver2SdCell_R(int level, sdNode* parent, sdNode* node, sdPlan
 //-------------------------------------------------------------
 // Displays heightmap cell BSP
 //-------------------------------------------------------------
-void DebugDrawDriver2HeightmapCell(const VECTOR_NOPAD& cellPos)
+void DebugDrawDriver2HeightmapCell(LevelContext_t& level, const VECTOR_NOPAD& cellPos)
 {
 	// cell bounds
 	const int cellMinX = (((cellPos.vx - 512) >> 10) << 10) + 512;
@@ -219,8 +223,13 @@ void DebugDrawDriver2HeightmapCell(const VECTOR_NOPAD& cellPos)
 	cellLookupPos.vz = cellPos.vz - 512;
 
 	XZPAIR cell;
-	g_levMap->WorldPositionToCellXZ(cell, cellLookupPos);
-	CDriver2LevelRegion* region = (CDriver2LevelRegion*)g_levMap->GetRegion(cell);
+	level.map->WorldPositionToCellXZ(cell, cellLookupPos);
+
+	// region may be still loading
+	if (!g_regionSpooler.IsRegionReady(level.map->GetRegionIndex(cell)))
+		return;
+
+	CDriver2LevelRegion* region = (CDriver2LevelRegion*)level.map->GetRegion(cell);
 
 	static HeightmapDebugData dbgData{};
 	dbgData.planeIdx = 0;
@@ -228,6 +237,7 @@ void DebugDrawDriver2HeightmapCell(const VECTOR_NOPAD& cellPos)
 	dbgData.cellPos.vx = cellMinX;
 	dbgData.cellPos.vy = cellPos.vy;
 	dbgData.cellPos.vz = cellMinZ;
+	dbgData.curves = ((CDriver2LevelMap*)level.map)->GetCurve(0x4000);
 
 	region->IterateHeightmapAtCell(cellLookupPos, DebugDriver2SdCell_R, &dbgData);
 }
\ No newline at end of file
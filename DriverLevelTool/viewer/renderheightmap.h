@@ -3,7 +3,8 @@
 
 #include "math/Vector.h"
 struct VECTOR_NOPAD;
+struct LevelContext_t;
 
-void DebugDrawDriver2HeightmapCell(const VECTOR_NOPAD& cellPos);
+void DebugDrawDriver2HeightmapCell(LevelContext_t& level, const VECTOR_NOPAD& cellPos);
 
 #endif // RENDERHEIGHTMAP_H
\ No newline at end of file
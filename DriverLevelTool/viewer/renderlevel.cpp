@@ -1,4 +1,5 @@
 #include "debug_overlay.h"
+#include "driver_level.h"
 #include "gl_renderer.h"
 
 #include <string.h>
@@ -7,6 +8,7 @@
 #include "driver_routines/models.h"
 #include "driver_routines/regions_d1.h"
 #include "driver_routines/regions_d2.h"
+#include "driver_routines/spooler.h"
 #include "driver_routines/textures.h"
 #include "math/Volume.h"
 #include "math/isin.h"
@@ -17,16 +19,7 @@
 #include "convert.h"
 #include "camera.h"
 
-// extern some vars
-extern String					g_levname;
-extern String					g_levname_moddir;
-extern String					g_levname_texdir;
-extern OUT_CITYLUMP_INFO		g_levInfo;
-extern CDriverLevelTextures		g_levTextures;
-extern CDriverLevelModels		g_levModels;
-extern CBaseLevelMap*			g_levMap;
-
-extern FILE* g_levFile;
+extern CRegionSpooler g_regionSpooler;
 
 extern bool g_nightMode;
 extern bool g_displayCollisionBoxes;
@@ -46,9 +39,9 @@ const float MODEL_LOD_LOW_MIN_DISTANCE = 5.0f;
 // returns specific model or LOD model
 // based on the distance from camera
 //-------------------------------------------------------
-ModelRef_t* GetModelCheckLods(int index, float distSqr)
+ModelRef_t* GetModelCheckLods(LevelContext_t& level, int index, float distSqr)
 {
-	ModelRef_t* baseRef = g_levModels.GetModelByIndex(index);
+	ModelRef_t* baseRef = level.models.GetModelByIndex(index);
 
 	if (g_noLod)
 		return baseRef;
@@ -57,13 +50,13 @@ ModelRef_t* GetModelCheckLods(int index, float distSqr)
 	if (baseRef->highDetailId != 0xFFFF)
 	{
 		if (distSqr < MODEL_LOD_HIGH_MIN_DISTANCE * MODEL_LOD_HIGH_MIN_DISTANCE)
-			return g_levModels.GetModelByIndex(baseRef->highDetailId);
+			return level.models.GetModelByIndex(baseRef->highDetailId);
 	}
 
 	if (baseRef->lowDetailId != 0xFFFF)
 	{
 		if (distSqr > MODEL_LOD_LOW_MIN_DISTANCE * MODEL_LOD_LOW_MIN_DISTANCE)
-			return g_levModels.GetModelByIndex(baseRef->lowDetailId);
+			return level.models.GetModelByIndex(baseRef->lowDetailId);
 	}
 
 	return retRef;
@@ -74,7 +67,7 @@ int g_drawnCells;
 int g_drawnModels;
 int g_drawnPolygons;
 
-void DrawCellObject(const CELL_OBJECT& co, const Vector3D& cameraPos, float cameraAngleY, const Volume& frustrumVolume, bool buildingLighting)
+void DrawCellObject(LevelContext_t& level, const CELL_OBJECT& co, const Vector3D& cameraPos, float cameraAngleY, const Volume& frustrumVolume, bool buildingLighting)
 {
 	if (co.type >= MAX_MODELS)
 	{
@@ -87,7 +80,7 @@ void DrawCellObject(const CELL_OBJECT& co, const Vector3D& cameraPos, float came
 
 	const float distanceFromCamera = lengthSqr(absCellPosition - cameraPos);
 
-	ModelRef_t* ref = GetModelCheckLods(co.type, distanceFromCamera);
+	ModelRef_t* ref = GetModelCheckLods(level, co.type, distanceFromCamera);
 
 	if (!ref->model)
 		return;
@@ -141,9 +134,9 @@ void DrawCellObject(const CELL_OBJECT& co, const Vector3D& cameraPos, float came
 
 	// apply lighting
 	if ((isGround || !buildingLighting) && g_nightMode)
-		CRenderModel::SetupLightingProperties(nightAmbientScale, nightLightScale);
+		CRenderModel::SetupLightingProperties(level.map->GetMapInfo(), nightAmbientScale, nightLightScale);
 	else
-		CRenderModel::SetupLightingProperties(ambientScale, lightScale);
+		CRenderModel::SetupLightingProperties(level.map->GetMapInfo(), ambientScale, lightScale);
 
 	renderModel->SetupModelShader();
 	renderModel->SetDrawBuffer();
@@ -172,11 +165,60 @@ void DrawCellObject(const CELL_OBJECT& co, const Vector3D& cameraPos, float came
 		CRenderModel::DrawModelCollisionBox(ref, co.pos, co.yang);
 }
 
+//-------------------------------------------------------
+// Queues regions that camera is going to reach
+// within lookAheadTime, ordered by arrival time
+//-------------------------------------------------------
+void PrefetchLevelRegions(LevelContext_t& level, const Vector3D& cameraPos, const Vector3D& cameraVelocity, float lookAheadTime)
+{
+	// previous predictions are no longer valid
+	g_regionSpooler.CancelPrefetch();
+
+	const float speed = length(cameraVelocity);
+
+	if (speed < 0.1f || lookAheadTime <= 0.0f)
+		return;
+
+	const OUT_CELL_FILE_HEADER& mapInfo = level.map->GetMapInfo();
+	const int regionsAcross = level.map->GetRegionsAcross();
+	const int regionsDown = level.map->GetRegionsDown();
+
+	// cells drawn around camera
+	const int drawRadius = (int)(sqrtf((float)g_cellsDrawDistance) * 0.5f) + 1;
+
+	// step half of region so none is skipped
+	const float stepDistance = float(mapInfo.cell_size * mapInfo.region_size) / ONE_F * 0.5f;
+	const float timeStep = stepDistance / speed;
+
+	int numSteps = (int)(lookAheadTime / timeStep) + 1;
+	if (numSteps > 64)
+		numSteps = 64;
+
+	for (int i = 1; i <= numSteps; i++)
+	{
+		const float eta = MIN(timeStep * i, lookAheadTime);
+
+		XZPAIR cell;
+		level.map->WorldPositionToCellXZ(cell, ToFixedVector(cameraPos + cameraVelocity * eta));
+
+		const int minRegionX = MAX(cell.x - drawRadius, 0) / mapInfo.region_size;
+		const int minRegionZ = MAX(cell.z - drawRadius, 0) / mapInfo.region_size;
+		const int maxRegionX = MIN((cell.x + drawRadius) / mapInfo.region_size, regionsAcross - 1);
+		const int maxRegionZ = MIN((cell.z + drawRadius) / mapInfo.region_size, regionsDown - 1);
+
+		for (int z = minRegionZ; z <= maxRegionZ; z++)
+		{
+			for (int x = minRegionX; x <= maxRegionX; x++)
+				g_regionSpooler.RequestRegion(x + z * regionsAcross, eta);
+		}
+	}
+}
+
 //-------------------------------------------------------
 // Draws Driver 2 level region cells
 // and spools the world if needed
 //-------------------------------------------------------
-void DrawLevelDriver2(const Vector3D& cameraPos, float cameraAngleY, const Volume& frustrumVolume)
+void DrawLevelDriver2(LevelContext_t& level, const Vector3D& cameraPos, float cameraAngleY, const Volume& frustrumVolume)
 {
 	CELL_ITERATOR_CACHE iteratorCache;
 	g_drawnCells = 0;
@@ -185,12 +227,7 @@ void DrawLevelDriver2(const Vector3D& cameraPos, float cameraAngleY, const Volum
 
 	VECTOR_NOPAD cameraPosition = ToFixedVector(cameraPos);
 
-	CDriver2LevelMap* levMapDriver2 = (CDriver2LevelMap*)g_levMap;
-	CFileStream spoolStream(g_levFile);
-
-	SPOOL_CONTEXT spoolContext;
-	spoolContext.dataStream = &spoolStream;
-	spoolContext.lumpInfo = &g_levInfo;
+	CDriver2LevelMap* levMapDriver2 = (CDriver2LevelMap*)level.map;
 
 	XZPAIR cell;
 	levMapDriver2->WorldPositionToCellXZ(cell, cameraPosition);
@@ -219,7 +256,7 @@ void DrawLevelDriver2(const Vector3D& cameraPos, float cameraAngleY, const Volum
 			icell.x = cell.x + hloop;
 			icell.z = cell.z + vloop;
 
-			CBaseLevelRegion* reg = g_levMap->GetRegion(icell);
+			CBaseLevelRegion* reg = level.map->GetRegion(icell);
 			if (currentRegion != reg)
 				memset(&iteratorCache, 0, sizeof(iteratorCache));
 			currentRegion = reg;
@@ -234,9 +271,11 @@ void DrawLevelDriver2(const Vector3D& cameraPos, float cameraAngleY, const Volum
 				ci.cache = &iteratorCache;
 				PACKED_CELL_OBJECT* ppco;
 
-				levMapDriver2->SpoolRegion(spoolContext, icell);
-
-				ppco = levMapDriver2->GetFirstPackedCop(&ci, icell);
+				// regions are loaded in background, skip cells until their region is published
+				if (g_regionSpooler.RequestRegion(levMapDriver2->GetRegionIndex(icell)))
+					ppco = levMapDriver2->GetFirstPackedCop(&ci, icell);
+				else
+					ppco = nullptr;
 
 				if (ppco)
 					g_drawnCells++;
@@ -293,7 +332,7 @@ void DrawLevelDriver2(const Vector3D& cameraPos, float cameraAngleY, const Volum
 		CELL_OBJECT co;
 		CDriver2LevelMap::UnpackCellObject(co, drawObjects[i].pco, drawObjects[i].nearCell);
 
-		DrawCellObject(co, cameraPos, cameraAngleY, frustrumVolume, true);
+		DrawCellObject(level, co, cameraPos, cameraAngleY, frustrumVolume, true);
 	}
 
 	if (g_displayHeightMap)
@@ -304,7 +343,7 @@ void DrawLevelDriver2(const Vector3D& cameraPos, float cameraAngleY, const Volum
 			ipos.vx += hloop * 1024;
 			ipos.vz += vloop * 1024;
 
-			DebugDrawDriver2HeightmapCell(ipos);
+			DebugDrawDriver2HeightmapCell(level, ipos);
 
 			if (dir == 0)
 			{
@@ -574,7 +613,7 @@ void DrawLevelDriver2(const Vector3D& cameraPos, float cameraAngleY, const Volum
 // Draws Driver 2 level region cells
 // and spools the world if needed
 //-------------------------------------------------------
-void DrawLevelDriver1(const Vector3D& cameraPos, float cameraAngleY, const Volume& frustrumVolume)
+void DrawLevelDriver1(LevelContext_t& level, const Vector3D& cameraPos, float cameraAngleY, const Volume& frustrumVolume)
 {
 	CELL_ITERATOR_CACHE iteratorCache;
 	CELL_ITERATOR_D1 ci;
@@ -593,12 +632,7 @@ void DrawLevelDriver1(const Vector3D& cameraPos, float cameraAngleY, const Volum
 
 	VECTOR_NOPAD cameraPosition = ToFixedVector(cameraPos);
 
-	CDriver1LevelMap* levMapDriver1 = (CDriver1LevelMap*)g_levMap;
-	CFileStream spoolStream(g_levFile);
-
-	SPOOL_CONTEXT spoolContext;
-	spoolContext.dataStream = &spoolStream;
-	spoolContext.lumpInfo = &g_levInfo;
+	CDriver1LevelMap* levMapDriver1 = (CDriver1LevelMap*)level.map;
 
 	levMapDriver1->WorldPositionToCellXZ(cell, cameraPosition);
 
@@ -622,7 +656,7 @@ void DrawLevelDriver1(const Vector3D& cameraPos, float cameraAngleY, const Volum
 			icell.x = cell.x + hloop;
 			icell.z = cell.z + vloop;
 
-			CBaseLevelRegion* reg = g_levMap->GetRegion(icell);
+			CBaseLevelRegion* reg = level.map->GetRegion(icell);
 
 			if (currentRegion != reg)
 				memset(&iteratorCache, 0, sizeof(iteratorCache));
@@ -631,9 +665,10 @@ void DrawLevelDriver1(const Vector3D& cameraPos, float cameraAngleY, const Volum
 			if (icell.x > -1 && icell.x < levMapDriver1->GetCellsAcross() &&
 				icell.z > -1 && icell.z < levMapDriver1->GetCellsDown())
 			{
-				levMapDriver1->SpoolRegion(spoolContext, icell);
-
-				pco = levMapDriver1->GetFirstCop(&ci, icell);
+				if (g_regionSpooler.RequestRegion(levMapDriver1->GetRegionIndex(icell)))
+					pco = levMapDriver1->GetFirstCop(&ci, icell);
+				else
+					pco = nullptr;
 
 				if(pco)
 					g_drawnCells++;
@@ -683,7 +718,7 @@ void DrawLevelDriver1(const Vector3D& cameraPos, float cameraAngleY, const Volum
 
 	for (uint i = 0; i < drawObjects.size(); i++)
 	{
-		DrawCellObject(*drawObjects[i], cameraPos, cameraAngleY, frustrumVolume, true);
+		DrawCellObject(level, *drawObjects[i], cameraPos, cameraAngleY, frustrumVolume, true);
 	}
 
 	if (g_displayRoads)
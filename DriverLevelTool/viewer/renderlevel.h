@@ -2,7 +2,10 @@
 #define RENDERLEVEL_H
 
 class Volume;
-void DrawLevelDriver1(const Vector3D& cameraPos, float cameraAngleY, const Volume& frustrumVolume);
-void DrawLevelDriver2(const Vector3D& cameraPos, float cameraAngleY, const Volume& frustrumVolume);
+struct LevelContext_t;
+
+void PrefetchLevelRegions(LevelContext_t& level, const Vector3D& cameraPos, const Vector3D& cameraVelocity, float lookAheadTime);
+void DrawLevelDriver1(LevelContext_t& level, const Vector3D& cameraPos, float cameraAngleY, const Volume& frustrumVolume);
+void DrawLevelDriver2(LevelContext_t& level, const Vector3D& cameraPos, float cameraAngleY, const Volume& frustrumVolume);
 
 #endif // RENDERLEVEL_H
\ No newline at end of file
@@ -530,15 +530,11 @@ void CRenderModel::SetupModelShader()
 	GR_SetShaderConstantVector4D(g_modelShader.lightColorConstantId, g_worldRenderProperties.lightColor);
 }
 
-extern CBaseLevelMap* g_levMap;
-
 // sets up lighting properties
-void CRenderModel::SetupLightingProperties(float ambientScale /*= 1.0f*/, float lightScale /*= 1.0f*/)
+void CRenderModel::SetupLightingProperties(const OUT_CELL_FILE_HEADER& mapInfo, float ambientScale /*= 1.0f*/, float lightScale /*= 1.0f*/)
 {
-	const OUT_CELL_FILE_HEADER& cellHeader = g_levMap->GetMapInfo();
-	
-	Vector3D lightVector = normalize(FromFixedVector(cellHeader.light_source));
-	float lightLevel = 0.5f;// cellHeader.ambient_light_level / ONE_F;
+	Vector3D lightVector = normalize(FromFixedVector(mapInfo.light_source));
+	float lightLevel = 0.5f;// mapInfo.ambient_light_level / ONE_F;
 	
 	g_worldRenderProperties.ambientColor = ColorRGBA(0.95f, 0.9f, 1.0f, 0.8f * ambientScale * lightLevel);
 	g_worldRenderProperties.lightColor = ColorRGBA(1.0f, 1.0f, 1.0f, 0.4f * lightScale);
@@ -571,4 +567,5 @@ void CRenderModel::OnModelFreed(ModelRef_t* ref)
 		model->Destroy();
 
 	delete model;
+	ref->userData = nullptr;
 }
\ No newline at end of file
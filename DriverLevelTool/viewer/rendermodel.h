@@ -6,6 +6,7 @@
 #define RENDER_SCALING			(1.0f / ONE_F)
 
 struct ModelRef_t;
+struct OUT_CELL_FILE_HEADER;
 struct GrVAO;
 
 struct modelBatch_t
@@ -32,7 +33,7 @@ public:
 
 	static void			DrawModelCollisionBox(ModelRef_t* ref, const VECTOR_NOPAD& position, int rotation);
 	static void			SetupModelShader();
-	static void			SetupLightingProperties(float ambientScale = 1.0f, float lightScale = 1.0f);
+	static void			SetupLightingProperties(const OUT_CELL_FILE_HEADER& mapInfo, float ambientScale = 1.0f, float lightScale = 1.0f);
 	static void			InitModelShader();
 
 	// callbacks for creating/destroying renderer objects
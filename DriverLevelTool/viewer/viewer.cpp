@@ -26,6 +26,7 @@
 #include "driver_routines/models.h"
 #include "driver_routines/regions_d1.h"
 #include "driver_routines/regions_d2.h"
+#include "driver_routines/spooler.h"
 #include "driver_routines/textures.h"
 
 #include "backends/imgui_impl_opengl3.h"
@@ -49,6 +50,7 @@ bool g_displayRoadConnections = false;
 bool g_noLod = false;
 
 int g_cellsDrawDistance = 441;
+float g_regionPrefetchTime = 2.0f;		// seconds of camera movement to spool regions ahead
 
 int g_currentModel = 0;
 int g_currentCarResidentModel = 0;
@@ -66,75 +68,24 @@ bool g_holdShift = false;
 TextureID g_hwTexturePages[128][16];
 extern TextureID g_whiteTexture;
 
+extern LevelContext_t g_viewerLevel;
+
 // Creates hardware texture
 void InitHWTexturePage(CTexturePage* tpage)
 {
-	const TexBitmap_t& bitmap = tpage->GetBitmap();
+	// re-spooled pages are taken from cache
+	const TexturePageVariants_t* variants = g_viewerLevel.textureCache.AcquirePage(tpage, false, false);
 
-	if (bitmap.data == nullptr)
+	if (!variants)
 		return;
 
-	int imgSize = TEXPAGE_SIZE * 4;
-	uint* color_data = (uint*)malloc(imgSize);
-
-	memset(color_data, 0, imgSize);
-
-	// Dump whole TPAGE indexes
-	for (int y = 0; y < 256; y++)
-	{
-		for (int x = 0; x < 256; x++)
-		{
-			ubyte clindex = bitmap.data[y * 128 + (x >> 1)];
-
-			if (0 != (x & 1))
-				clindex >>= 4;
-
-			clindex &= 0xF;
-
-			int ypos = (TEXPAGE_SIZE_Y - y - 1) * TEXPAGE_SIZE_Y;
-
-			color_data[ypos + x] = clindex * 32;
-		}
-	}
-
-	int numDetails = tpage->GetDetailCount();
-
-	// FIXME: load indexes instead?
-
-	for (int i = 0; i < numDetails; i++)
-		tpage->ConvertIndexedTextureToRGBA(color_data, i, &bitmap.clut[i], false, false);
-
 	int tpageId = tpage->GetId();
-	
-	g_hwTexturePages[tpageId][0] = GR_CreateRGBATexture(TEXPAGE_SIZE_Y, TEXPAGE_SIZE_Y, (ubyte*)color_data);
 
-	// also load different palettes
-	int numPalettes = 0;
-	for (int pal = 0; pal < 16; pal++)
-	{
-		bool anyMatched = false;
-
-		for (int j = 0; j < numDetails; j++)
-		{
-			TexDetailInfo_t* detail = tpage->GetTextureDetail(j);
+	// base palettes and different palettes
+	for (int i = 0; i < variants->numVariants && i < 16; i++)
+		g_hwTexturePages[tpageId][i] = GR_CreateRGBATexture(TEXPAGE_SIZE_Y, TEXPAGE_SIZE_Y, (ubyte*)variants->data[i]);
 
-			if (detail->extraCLUTs[pal])
-			{
-				tpage->ConvertIndexedTextureToRGBA(color_data, j, detail->extraCLUTs[pal], false, false);
-				anyMatched = true;
-			}
-		}
-
-		if (anyMatched)
-		{
-			g_hwTexturePages[tpageId][numPalettes + 1] = GR_CreateRGBATexture(TEXPAGE_SIZE_Y, TEXPAGE_SIZE_Y, (ubyte*)color_data);
-			numPalettes++;
-		}
-	}
-	
-	
-	// no longer need in RGBA data
-	free(color_data);
+	g_viewerLevel.textureCache.ReleasePage(variants);
 }
 
 void FreeHWTexturePage(CTexturePage* tpage)
@@ -159,11 +110,13 @@ TextureID GetHWTexture(int tpage, int pal)
 	return g_hwTexturePages[tpage][pal];
 }
 
+LevelContext_t					g_viewerLevel;		// level opened in viewer
+
 // Dummy texture initilization
 void InitHWTextures()
 {
 	// set loading callbacks
-	g_levTextures.SetLoadingCallbacks(InitHWTexturePage, FreeHWTexturePage);
+	g_viewerLevel.textures.SetLoadingCallbacks(InitHWTexturePage, FreeHWTexturePage);
 	
 	for (int i = 0; i < 128; i++)
 	{
@@ -174,44 +127,29 @@ void InitHWTextures()
 
 //-----------------------------------------------------------------
 
-// extern some vars
-extern String					g_levname;
-extern String					g_levname_moddir;
-extern String					g_levname_texdir;
-extern OUT_CITYLUMP_INFO		g_levInfo;
-extern CDriverLevelTextures		g_levTextures;
-extern CDriverLevelModels		g_levModels;
-extern CBaseLevelMap*			g_levMap;
-
-FILE* g_levFile = nullptr;
+CRegionSpooler					g_regionSpooler;
+IVirtualStream*					g_spoolStream = nullptr;		// separate stream for spooler thread
 
 //-------------------------------------------------------
 // Perorms level loading and renderer data initialization
 //-------------------------------------------------------
 bool LoadLevelFile()
 {
-	g_levFile = fopen(g_levname, "rb");
-	if (!g_levFile)
-	{
-		MsgError("Cannot open %s\n", (char*)g_levname);
-		return false;
-	}
-
-	CFileStream stream(g_levFile);
-	ELevelFormat levFormat = CDriverLevelLoader::DetectLevelFormat(&stream);
+	g_viewerLevel.models.SetModelLoadingCallbacks(CRenderModel::OnModelLoaded, CRenderModel::OnModelFreed);
 
-	g_levModels.SetModelLoadingCallbacks(CRenderModel::OnModelLoaded, CRenderModel::OnModelFreed);
+	if (!LoadLevel(g_viewerLevel))
+		return false;
 
-	// create map accordingly
-	if (levFormat >= LEV_FORMAT_DRIVER2_ALPHA16 || levFormat == LEV_FORMAT_AUTODETECT)
-		g_levMap = new CDriver2LevelMap();
-	else
-		g_levMap = new CDriver1LevelMap();
+	// regions are spooled in background using it's own stream
+	g_spoolStream = OpenLevelStream(g_viewerLevel.name);
 
-	CDriverLevelLoader loader;
-	loader.Initialize(g_levInfo, &g_levTextures, &g_levModels, g_levMap);
+	if (!g_spoolStream || !g_regionSpooler.Start(g_viewerLevel.map, g_spoolStream, &g_viewerLevel.info))
+	{
+		MsgError("Cannot start region spooling!\n");
+		return false;
+	}
 
-	return loader.Load(&stream);
+	return true;
 }
 
 //-------------------------------------------------------
@@ -221,13 +159,13 @@ void FreeLevelData()
 {
 	MsgWarning("Freeing level data ...\n");
 
-	g_levMap->FreeAll();
-	g_levTextures.FreeAll();
-	g_levModels.FreeAll();
+	g_regionSpooler.Stop();
 
-	delete g_levMap;
+	FreeLevel(g_viewerLevel);
 
-	fclose(g_levFile);
+	if (g_spoolStream)
+		CloseLevelStream(g_spoolStream);
+	g_spoolStream = nullptr;
 }
 
 //-------------------------------------------------------
@@ -245,12 +183,16 @@ void RenderLevelView()
 	GR_SetCullMode(CULL_FRONT);
 
 	// reset lighting
-	CRenderModel::SetupLightingProperties();
+	CRenderModel::SetupLightingProperties(g_viewerLevel.map->GetMapInfo());
+
+	// publish regions loaded by spooler thread
+	g_regionSpooler.Update();
+	PrefetchLevelRegions(g_viewerLevel, g_cameraPosition, g_cameraVelocity, g_regionPrefetchTime);
 	
-	if(g_levMap->GetFormat() >= LEV_FORMAT_DRIVER2_ALPHA16)
-		DrawLevelDriver2(g_cameraPosition, g_cameraAngles.y, frustumVolume);
+	if(g_viewerLevel.map->GetFormat() >= LEV_FORMAT_DRIVER2_ALPHA16)
+		DrawLevelDriver2(g_viewerLevel, g_cameraPosition, g_cameraAngles.y, frustumVolume);
 	else
-		DrawLevelDriver1(g_cameraPosition, g_cameraAngles.y, frustumVolume);
+		DrawLevelDriver1(g_viewerLevel, g_cameraPosition, g_cameraAngles.y, frustumVolume);
 }
 
 float g_cameraDistance = 4.0f;
@@ -268,12 +210,12 @@ void RenderModelView()
 	CRenderModel::SetupModelShader();
 	SetupCameraViewAndMatrices(-forward * g_cameraDistance, g_cameraAngles, frustumVolume);
 
-	CRenderModel::SetupLightingProperties(0.5f, 0.5f);
+	CRenderModel::SetupLightingProperties(g_viewerLevel.map->GetMapInfo(), 0.5f, 0.5f);
 
 	GR_SetDepth(1);
 	GR_SetCullMode(CULL_FRONT);
 
-	ModelRef_t* ref = g_levModels.GetModelByIndex(g_currentModel);
+	ModelRef_t* ref = g_viewerLevel.models.GetModelByIndex(g_currentModel);
 
 	if(ref && ref->userData)
 	{
@@ -314,7 +256,7 @@ void RenderCarModelView()
 	CRenderModel::SetupModelShader();
 	SetupCameraViewAndMatrices(-forward * g_cameraDistance, g_cameraAngles, frustumVolume);
 
-	CRenderModel::SetupLightingProperties(1.0f, 0.5f);
+	CRenderModel::SetupLightingProperties(g_viewerLevel.map->GetMapInfo(), 1.0f, 0.5f);
 
 	GR_SetDepth(1);
 	GR_SetCullMode(CULL_FRONT);
@@ -330,7 +272,7 @@ void RenderCarModelView()
 //-------------------------------------------------------
 void UpdateCarRenderModel()
 {
-	CarModelData_t* carModel = g_levModels.GetCarModel(g_currentCarResidentModel);
+	CarModelData_t* carModel = g_viewerLevel.models.GetCarModel(g_currentCarResidentModel);
 
 	if (g_currentCarModel == 0)
 	{
@@ -365,24 +307,26 @@ void UpdateCarRenderModel()
 void SpoolAllAreaDatas()
 {
 	Msg("Spooling regions...\n");
-	// Open file stream
-	FILE* fp = fopen(g_levname, "rb");
-	if (fp)
-	{
-		CFileStream stream(fp);
 
+	// spooler must not touch regions while we load them
+	g_regionSpooler.Flush();
+
+	// everything stays resident from now on
+	g_viewerLevel.map->SetRegionCacheBudget(0);
+
+	// use already mapped level file
+	if (g_viewerLevel.stream)
+	{
 		SPOOL_CONTEXT spoolContext;
-		spoolContext.dataStream = &stream;
-		spoolContext.lumpInfo = &g_levInfo;
+		spoolContext.dataStream = g_viewerLevel.stream;
+		spoolContext.lumpInfo = &g_viewerLevel.info;
 
-		int totalRegions = g_levMap->GetRegionsAcross() * g_levMap->GetRegionsDown();
+		int totalRegions = g_viewerLevel.map->GetRegionsAcross() * g_viewerLevel.map->GetRegionsDown();
 		
 		for (int i = 0; i < totalRegions; i++)
 		{
-			g_levMap->SpoolRegion(spoolContext, i);
+			g_viewerLevel.map->SpoolRegion(spoolContext, i);
 		}
-
-		fclose(fp);
 	}
 	else
 		MsgError("Unable to spool area datas!\n");
@@ -430,7 +374,7 @@ void UpdateOverlayMapPreview()
 
 	GR_DestroyTexture(g_overheadMapTexture);
 
-	const int numValid = g_levTextures.GetOverlayMapSegmentCount();
+	const int numValid = g_viewerLevel.textures.GetOverlayMapSegmentCount();
 
 	const int overmapWidth = g_overlaymap_width * 32;
 	const int overmapHeight = (numValid / g_overlaymap_width) * 32;
@@ -452,7 +396,7 @@ void UpdateOverlayMapPreview()
 		{
 			int idx = x + y * wide;
 
-			g_levTextures.GetOverlayMapSegmentRGBA(tempSegment, x + y * wide);
+			g_viewerLevel.textures.GetOverlayMapSegmentRGBA(tempSegment, x + y * wide);
 
 			numTilesProcessed++;
 
@@ -482,12 +426,13 @@ void DisplayExportUI()
 {
 	extern bool g_extract_mdls;
 	extern bool g_export_worldUnityScript;
+	extern bool g_export_worldUnityAsset;
 	extern bool g_explode_tpages;
 	extern int g_overlaymap_width;
 	
 
-	const int dim_x = g_levMap->GetRegionsAcross();
-	const int dim_y = g_levMap->GetRegionsDown();
+	const int dim_x = g_viewerLevel.map->GetRegionsAcross();
+	const int dim_y = g_viewerLevel.map->GetRegionsDown();
 
 	ImGui::SetNextWindowSize(ImVec2(Math::max(dim_x * 24, 600), Math::max(dim_y * 20, 600)), ImGuiCond_Appearing);
 
@@ -518,7 +463,7 @@ void DisplayExportUI()
 					{
 						const int regIndex = y * dim_x + x;
 						ImGui::TableSetColumnIndex(x);
-						if (!g_levMap->GetRegion(regIndex)->IsEmpty())
+						if (!g_viewerLevel.map->GetRegion(regIndex)->IsEmpty())
 						{
 							ImGui::Checkbox((char*)String::fromPrintf("##reg%d", regIndex), &exportedRegions[regIndex]);
 							if (exportedRegions[regIndex])
@@ -533,6 +478,12 @@ void DisplayExportUI()
 			{
 				ImGui::Checkbox("Export as Unity objects", &g_export_worldUnityScript);
 
+				if (g_export_worldUnityScript)
+				{
+					ImGui::SameLine();
+					ImGui::Checkbox("As data assets", &g_export_worldUnityAsset);
+				}
+
 				ImGui::RadioButton("Filter off", &filters.mode, ModelExportFilters::MODE_DISABLE); ImGui::SameLine();
 				ImGui::RadioButton("Include only", &filters.mode, ModelExportFilters::MODE_EXCLUDE_ALL_INCLUDE_FLAGS); ImGui::SameLine();
 				ImGui::RadioButton("Exclude only", &filters.mode, ModelExportFilters::MODE_INCLUDE_ALL_EXCLUDE_FLAGS);
@@ -559,16 +510,16 @@ void DisplayExportUI()
 					g_extract_mdls = false;
 					g_explode_tpages = false;
 					
-					Directory::create(g_levname_moddir);
-					Directory::create(g_levname_texdir);
+					Directory::create(g_viewerLevel.modelsDir);
+					Directory::create(g_viewerLevel.texturesDir);
 
-					SaveModelPagesMTL();
+					SaveModelPagesMTL(g_viewerLevel);
 					
-					ExportAllModels();
-					ExportAllTextures();
+					ExportAllModels(g_viewerLevel);
+					ExportAllTextures(g_viewerLevel);
 				}
 				
-				ExportRegions(filters, exportedRegions);
+				ExportRegions(g_viewerLevel, filters, exportedRegions);
 				MsgInfo("Job done!\n");
 			}
 		}
@@ -579,9 +530,9 @@ void DisplayExportUI()
 			if (ImGui::Button("Export models"))
 			{
 				g_export_worldUnityScript = false;
-				Directory::create(g_levname_moddir);
-				SaveModelPagesMTL();
-				ExportAllModels();
+				Directory::create(g_viewerLevel.modelsDir);
+				SaveModelPagesMTL(g_viewerLevel);
+				ExportAllModels(g_viewerLevel);
 				MsgInfo("Job done!\n");
 			}
 		}
@@ -592,9 +543,9 @@ void DisplayExportUI()
 			if (ImGui::Button("Export car models"))
 			{
 				g_export_worldUnityScript = false;
-				Directory::create(g_levname_moddir);
-				SaveModelPagesMTL();
-				ExportAllCarModels();
+				Directory::create(g_viewerLevel.modelsDir);
+				SaveModelPagesMTL(g_viewerLevel);
+				ExportAllCarModels(g_viewerLevel);
 				MsgInfo("Job done!\n");
 			}
 		}
@@ -612,9 +563,9 @@ void DisplayExportUI()
 				s_selectedTpageUsedModels.clear();
 				showDetailsUsage = -1;
 			}
-			texturePageIdx = clamp(texturePageIdx, 0, g_levTextures.GetTPageCount()-1);
+			texturePageIdx = clamp(texturePageIdx, 0, g_viewerLevel.textures.GetTPageCount()-1);
 
-			CTexturePage* tpage = g_levTextures.GetTPage(texturePageIdx);
+			CTexturePage* tpage = g_viewerLevel.textures.GetTPage(texturePageIdx);
 			int tpageFlags = tpage->GetFlags();
 			ImGui::Image((void*)g_hwTexturePages[texturePageIdx][0], ImVec2(256, 256), ImVec2(0, 1), ImVec2(1, 0));
 
@@ -666,7 +617,7 @@ void DisplayExportUI()
 			{
 				if (g_viewerMode >= 1)
 				{
-					ModelRef_t* ref = (g_viewerMode == 2) ? &g_carModelRef : g_levModels.GetModelByIndex(g_currentModel);
+					ModelRef_t* ref = (g_viewerMode == 2) ? &g_carModelRef : g_viewerLevel.models.GetModelByIndex(g_currentModel);
 					if(ref)
 						countTextureRefs(ref->model, 0);
 				}
@@ -674,14 +625,14 @@ void DisplayExportUI()
 				{
 					for (int i = 0; i < MAX_MODELS; i++)
 					{
-						ModelRef_t* ref = g_levModels.GetModelByIndex(i);
+						ModelRef_t* ref = g_viewerLevel.models.GetModelByIndex(i);
 						if (ref)
 							countTextureRefs(ref->model, i);
 					}
 
 					for (int i = 0; i < MAX_CAR_MODELS; i++)
 					{
-						CarModelData_t* cmData = g_levModels.GetCarModel(i);
+						CarModelData_t* cmData = g_viewerLevel.models.GetCarModel(i);
 						countTextureRefs(cmData->cleanmodel, i | 0x2000);
 						countTextureRefs(cmData->lowmodel, i | 0x1000);
 						// we don't count damage models because vertices only used
@@ -701,7 +652,7 @@ void DisplayExportUI()
 						auto it = s_modelUsedPageDetails.find((uint)texturePageIdx | ((uint)n << 16));
 
 						TexDetailInfo_t* detail = tpage->GetTextureDetail(n);
-						if (ImGui::Selectable(varargs("%s (%d uses)", g_levTextures.GetTextureDetailName(&detail->info), it == s_modelUsedPageDetails.end() ? 0 : (*it).size()), (it != s_modelUsedPageDetails.end())))
+						if (ImGui::Selectable(varargs("%s (%d uses)", g_viewerLevel.textures.GetTextureDetailName(&detail->info), it == s_modelUsedPageDetails.end() ? 0 : (*it).size()), (it != s_modelUsedPageDetails.end())))
 						{
 							showDetailsUsage = n;
 						}
@@ -751,7 +702,7 @@ void DisplayExportUI()
 						}
 						else
 						{
-							ModelRef_t* ref = g_levModels.GetModelByIndex(idx);
+							ModelRef_t* ref = g_viewerLevel.models.GetModelByIndex(idx);
 							String text = String::fromPrintf("Model %d (%s)", idx, ref->name);
 							if (ImGui::Selectable(text, g_currentModel == idx))
 							{
@@ -782,7 +733,7 @@ void DisplayExportUI()
 				{
 					TexDetailInfo_t* detail = tpage->GetTextureDetail(showDetailsUsage);
 
-					ImGui::Text("Models using TPage %d Detail %s", texturePageIdx, g_levTextures.GetTextureDetailName(&detail->info));
+					ImGui::Text("Models using TPage %d Detail %s", texturePageIdx, g_viewerLevel.textures.GetTextureDetailName(&detail->info));
 					showListboxModelSelection(*detailIt);
 					ImGui::End();
 				}
@@ -793,8 +744,8 @@ void DisplayExportUI()
 			if (ImGui::Button("Export all textures"))
 			{
 				g_export_worldUnityScript = false;
-				Directory::create(g_levname_texdir);
-				ExportAllTextures();
+				Directory::create(g_viewerLevel.texturesDir);
+				ExportAllTextures(g_viewerLevel);
 				MsgInfo("Job done!\n");
 			}
 			ImGui::SameLine();
@@ -802,15 +753,15 @@ void DisplayExportUI()
 		}
 		else if (g_exportMode == 4)
 		{
-			const int numValid = g_levTextures.GetOverlayMapSegmentCount();
+			const int numValid = g_viewerLevel.textures.GetOverlayMapSegmentCount();
 
 			ImGui::Text("Overlay map tiles: %d", numValid);
 			ImGui::SameLine();
 			if (ImGui::Button("Export"))
 			{
 				g_export_worldUnityScript = false;
-				Directory::create(g_levname_texdir);
-				ExportOverlayMap();
+				Directory::create(g_viewerLevel.texturesDir);
+				ExportOverlayMap(g_viewerLevel);
 				MsgInfo("Job done!\n");
 			}
 
@@ -843,8 +794,8 @@ void DisplayExportUI()
 
 void DisplayAreaDataViewer()
 {
-	const int dim_x = g_levMap->GetRegionsAcross();
-	const int dim_y = g_levMap->GetRegionsDown();
+	const int dim_x = g_viewerLevel.map->GetRegionsAcross();
+	const int dim_y = g_viewerLevel.map->GetRegionsDown();
 
 	ImGui::SetNextWindowSize(ImVec2(Math::max(dim_x * 24, 600), Math::max(dim_y * 20 + 200, 600)), ImGuiCond_Appearing);
 
@@ -864,7 +815,7 @@ void DisplayAreaDataViewer()
 						for (int x = 0; x < dim_x; x++)
 						{
 							const int regIndex = y * dim_x + x;
-							CBaseLevelRegion* region = g_levMap->GetRegion(regIndex);
+							CBaseLevelRegion* region = g_viewerLevel.map->GetRegion(regIndex);
 
 							ImGui::TableSetColumnIndex(x);
 							if (region->GetAreaDataIdx() != -1)
@@ -890,13 +841,13 @@ void DisplayAreaDataViewer()
 			{
 				if (ImGui::BeginListBox("##areaDataList", ImVec2(256, dim_y * 15)))
 				{
-					const int totalRegions = g_levMap->GetRegionsAcross() * g_levMap->GetRegionsDown();
-					for (int n = 0; n < g_levMap->GetAreaDataCount(); n++)
+					const int totalRegions = g_viewerLevel.map->GetRegionsAcross() * g_viewerLevel.map->GetRegionsDown();
+					for (int n = 0; n < g_viewerLevel.map->GetAreaDataCount(); n++)
 					{
 						int refs = 0;
 						for (int i = 0; i < totalRegions; i++)
 						{
-							CBaseLevelRegion* region = g_levMap->GetRegion(i);
+							CBaseLevelRegion* region = g_viewerLevel.map->GetRegion(i);
 							if (region->GetAreaDataIdx() == n)
 								++refs;
 						}
@@ -913,8 +864,8 @@ void DisplayAreaDataViewer()
 
 		if(ImGui::BeginChild("AreaDetails"))
 		{
-			AreaDataStr& areaData = g_levMap->GetAreaData(selAreaData);
-			AreaTpageList& areaTpageList = g_levMap->GetAreaTpageList(selAreaData);
+			AreaDataStr& areaData = g_viewerLevel.map->GetAreaData(selAreaData);
+			AreaTpageList& areaTpageList = g_viewerLevel.map->GetAreaTpageList(selAreaData);
 
 			if (ImGui::BeginListBox("##tpageList", ImVec2(100, 180)))
 			{
@@ -1072,7 +1023,7 @@ void DisplayUI(float deltaTime)
 
 		if(g_viewerMode == 0)
 		{
-			ImGui::SetWindowSize(ImVec2(400, 120));
+			ImGui::SetWindowSize(ImVec2(400, 150));
 			
 			ImGui::TextColored(ImVec4(1.0f, 1.0f, 0.25f, 1.0f), "Position: X: %d Y: %d Z: %d",
 				int(g_cameraPosition.x * ONE_F), int(g_cameraPosition.y * ONE_F), int(g_cameraPosition.z * ONE_F));
@@ -1081,12 +1032,14 @@ void DisplayUI(float deltaTime)
 			ImGui::TextColored(ImVec4(1.0f, 1.0f, 1.0f, 0.5f), "Drawn cells: %d", g_drawnCells);
 			ImGui::TextColored(ImVec4(1.0f, 1.0f, 1.0f, 0.5f), "Drawn models: %d", g_drawnModels);
 			ImGui::TextColored(ImVec4(1.0f, 1.0f, 1.0f, 0.5f), "Drawn polygons: %d", g_drawnPolygons);
+			ImGui::TextColored(ImVec4(1.0f, 1.0f, 1.0f, 0.5f), "Resident regions: %d (%d KB)", g_viewerLevel.map->GetResidentRegionCount(), int(g_viewerLevel.map->GetResidentBytes() / 1024));
+			ImGui::TextColored(ImVec4(1.0f, 1.0f, 1.0f, 0.5f), "Area cache: %d hits, %d misses", g_viewerLevel.map->GetAreaCacheHits(), g_viewerLevel.map->GetAreaCacheMisses());
 		}
 		else if (g_viewerMode >= 1 )
 		{
 			ImGui::SetWindowSize(ImVec2(400, 720));
 			
-			ModelRef_t* ref = g_levModels.GetModelByIndex(g_currentModel);
+			ModelRef_t* ref = g_viewerLevel.models.GetModelByIndex(g_currentModel);
 
 			if (g_viewerMode == 2)
 				ref = &g_carModelRef;
@@ -1190,7 +1143,7 @@ void DisplayUI(float deltaTime)
 
 				for (int i = 0; i < MAX_MODELS; i++)
 				{
-					ModelRef_t* itemRef = g_levModels.GetModelByIndex(i);
+					ModelRef_t* itemRef = g_viewerLevel.models.GetModelByIndex(i);
 
 					if (!filter.IsActive() && !itemRef->name || itemRef->name && filter.PassFilter(itemRef->name))
 						modelRefs.append(i);
@@ -1204,7 +1157,7 @@ void DisplayUI(float deltaTime)
 					{
 						for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++)
 						{
-							ModelRef_t* ref = g_levModels.GetModelByIndex(modelRefs[i]);
+							ModelRef_t* ref = g_viewerLevel.models.GetModelByIndex(modelRefs[i]);
 							if (ref->index == -1)
 								continue;
 
@@ -1256,7 +1209,7 @@ void DisplayUI(float deltaTime)
 					{
 						for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++)
 						{
-							CarModelData_t* itemRef = g_levModels.GetCarModel(i);
+							CarModelData_t* itemRef = g_viewerLevel.models.GetCarModel(i);
 
 							const bool item_selected = (i == g_currentCarResidentModel);
 
@@ -1470,7 +1423,7 @@ void ViewerMainLoop()
 		{
 			float cameraSpeedModifier = g_holdShift ? 4.0f : 1.0f;
 			
-			UpdateCameraMovement(deltaTime, cameraSpeedModifier);
+			UpdateCameraMovement(g_viewerLevel, deltaTime, cameraSpeedModifier);
 			RenderLevelView();
 		}
 		else if(g_viewerMode == 1)
@@ -1500,8 +1453,10 @@ void ViewerMainLoop()
 //-------------------------------------------------------------
 // Main level viewer
 //-------------------------------------------------------------
-int ViewerMain()
+int ViewerMain(const char* levFilename)
 {
+	SetLevelFilename(g_viewerLevel, String::fromCString(levFilename));
+
 	if(!GR_Init("OpenDriver2 Level viewer", 1280, 720, 0))
 	{
 		MsgError("Failed to init graphics!\n");
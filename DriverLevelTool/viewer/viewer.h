@@ -1,6 +1,6 @@
 #ifndef VIEWER_H
 #define VIEWER_H
 
-int ViewerMain();
+int ViewerMain(const char* levFilename);
 
 #endif
\ No newline at end of file
@@ -66,6 +66,10 @@ public:
 
 	// returns stream type
 	virtual VirtStreamType_e	GetType() = 0;
+
+	// returns pointer to 'size' bytes at current position if stream contents stays
+	// resident and unchanged while stream is open (memory-mapped file), otherwise nullptr
+	virtual ubyte*				GetMappedPointer(long size) { return nullptr; }
 };
 
 #endif // IVRITUALSTREAM_H
\ No newline at end of file
@@ -3,6 +3,15 @@
 #include <stdarg.h> // va_*
 #include <malloc.h> // va_*
 
+#ifdef _WIN32
+#include <Windows.h>
+#else // POSIX
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 #define VSTREAM_GRANULARITY 1024	// 1kb
 
 // Opens memory stream, when creating new stream use nBufferSize parameter as base buffer
@@ -26,13 +35,31 @@ void IVirtualStream::Print(const char* pFmt, ...)
 {
 	va_list		argptr;
 
-	static char	string[4096];
+	// not static - streams can be printed from different threads
+	char		string[4096];
 
 	va_start (argptr,pFmt);
-	int wcount = vsprintf(string, pFmt, argptr);
+	int wcount = vsnprintf(string, sizeof(string), pFmt, argptr);
 	va_end (argptr);
 
-	Write(string, 1, wcount);
+	if (wcount < 0)
+		return;
+
+	if (wcount < (int)sizeof(string))
+	{
+		Write(string, 1, wcount);
+		return;
+	}
+
+	// too long for stack buffer
+	char* longString = (char*)malloc(wcount + 1);
+
+	va_start(argptr, pFmt);
+	vsnprintf(longString, wcount + 1, pFmt, argptr);
+	va_end(argptr);
+
+	Write(longString, 1, wcount);
+	free(longString);
 }
 
 //--------------------------
@@ -314,4 +341,417 @@ long CFileStream::GetSize()
 	Seek(pos, VS_SEEK_SET);
 
 	return length;
-}
\ No newline at end of file
+}
+
+//------------------------------------------------------------------------------
+// File stream with sector cache
+//------------------------------------------------------------------------------
+
+CCachedFileStream::CCachedFileStream(int numCacheSectors, int readAheadSectors, int sectorSize)
+{
+	m_pFilePtr = nullptr;
+	m_nSize = 0;
+	m_nPos = 0;
+	m_nFilePos = 0;
+
+	m_sectorSize = sectorSize;
+	m_numCacheSectors = numCacheSectors;
+
+	// read-ahead must not evict the sectors it is reading
+	m_readAheadSectors = readAheadSectors > numCacheSectors ? numCacheSectors : readAheadSectors;
+	if (m_readAheadSectors < 1)
+		m_readAheadSectors = 1;
+
+	m_cache = (ubyte*)malloc(m_numCacheSectors * m_sectorSize);
+	m_cacheSectors = (long*)malloc(m_numCacheSectors * sizeof(long));
+
+	m_cacheHits = 0;
+	m_cacheMisses = 0;
+	m_fileReads = 0;
+	m_fileSeeks = 0;
+	m_bytesRead = 0;
+}
+
+CCachedFileStream::~CCachedFileStream()
+{
+	Close();
+
+	free(m_cache);
+	free(m_cacheSectors);
+}
+
+bool CCachedFileStream::Open(const char* filename)
+{
+	Close();
+
+	m_pFilePtr = fopen(filename, "rb");
+
+	if (!m_pFilePtr)
+		return false;
+
+	fseek(m_pFilePtr, 0, SEEK_END);
+	m_nSize = ftell(m_pFilePtr);
+	fseek(m_pFilePtr, 0, SEEK_SET);
+
+	for (int i = 0; i < m_numCacheSectors; i++)
+		m_cacheSectors[i] = -1;
+
+	m_nPos = 0;
+	m_nFilePos = 0;
+
+	return true;
+}
+
+void CCachedFileStream::Close()
+{
+	if (m_pFilePtr)
+		fclose(m_pFilePtr);
+
+	m_pFilePtr = nullptr;
+	m_nSize = 0;
+	m_nPos = 0;
+	m_nFilePos = 0;
+}
+
+// returns cached sector data, reads sectors from file if needed
+ubyte* CCachedFileStream::GetSector(long sector)
+{
+	int slot = sector % m_numCacheSectors;
+
+	if (m_cacheSectors[slot] == sector)
+	{
+		m_cacheHits++;
+		return m_cache + slot * m_sectorSize;
+	}
+
+	m_cacheMisses++;
+
+	// read ahead sequential sectors which are not cached yet
+	int numSectors = 1;
+	while (numSectors < m_readAheadSectors)
+	{
+		long nextSector = sector + numSectors;
+
+		if (nextSector * m_sectorSize >= m_nSize || m_cacheSectors[nextSector % m_numCacheSectors] == nextSector)
+			break;
+
+		// contiguous slots only
+		if ((slot + numSectors) >= m_numCacheSectors)
+			break;
+
+		numSectors++;
+	}
+
+	long readOffset = sector * m_sectorSize;
+
+	// coalesce seeks
+	if (m_nFilePos != readOffset)
+	{
+		fseek(m_pFilePtr, readOffset, SEEK_SET);
+		m_fileSeeks++;
+	}
+
+	size_t numRead = fread(m_cache + slot * m_sectorSize, 1, numSectors * m_sectorSize, m_pFilePtr);
+
+	m_nFilePos = readOffset + numRead;
+	m_bytesRead += numRead;
+	m_fileReads++;
+
+	// short read leaves rest of slots with garbage, only complete sectors and end of file are cached
+	size_t numCovered = numRead / m_sectorSize;
+
+	if (numRead % m_sectorSize && readOffset + (long)numRead >= m_nSize)
+		numCovered++;
+
+	for (int i = 0; i < numSectors; i++)
+		m_cacheSectors[slot + i] = (size_t)i < numCovered ? sector + i : -1;
+
+	return m_cache + slot * m_sectorSize;
+}
+
+size_t CCachedFileStream::Read(void *dest, size_t count, size_t size)
+{
+	if (!m_pFilePtr || !size || m_nPos >= m_nSize)
+		return 0;
+
+	const size_t nAvailable = (size_t)(m_nSize - m_nPos);
+	size_t nReadBytes = size * count;
+
+	if (nReadBytes > nAvailable)
+		nReadBytes = nAvailable;
+
+	ubyte* pDest = (ubyte*)dest;
+	size_t nRemaining = nReadBytes;
+
+	while (nRemaining > 0)
+	{
+		long sector = m_nPos / m_sectorSize;
+		int sectorOffset = m_nPos % m_sectorSize;
+
+		size_t nCopy = (size_t)(m_sectorSize - sectorOffset);
+		if (nCopy > nRemaining)
+			nCopy = nRemaining;
+
+		memcpy(pDest, GetSector(sector) + sectorOffset, nCopy);
+
+		pDest += nCopy;
+		m_nPos += nCopy;
+		nRemaining -= nCopy;
+	}
+
+	// same as fread - number of complete elements
+	return nReadBytes / size;
+}
+
+size_t CCachedFileStream::Write(const void *src, size_t count, size_t size)
+{
+	return 0;
+}
+
+int CCachedFileStream::Seek(long nOffset, VirtStreamSeek_e seekType)
+{
+	long newPos;
+
+	switch (seekType)
+	{
+		case VS_SEEK_SET:
+			newPos = nOffset;
+			break;
+		case VS_SEEK_CUR:
+			newPos = m_nPos + nOffset;
+			break;
+		case VS_SEEK_END:
+			newPos = m_nSize + nOffset;
+			break;
+		default:
+			return -1;
+	}
+
+	if (newPos < 0)
+		return -1;
+
+	m_nPos = newPos;
+
+	return 0;
+}
+
+long CCachedFileStream::Tell()
+{
+	return m_nPos;
+}
+
+long CCachedFileStream::GetSize()
+{
+	return m_nSize;
+}
+
+int CCachedFileStream::Flush()
+{
+	return 0;
+}
+
+//------------------------------------------------------------------------------
+// Memory-mapped file stream
+//------------------------------------------------------------------------------
+
+CMappedFileStream::CMappedFileStream()
+{
+	m_pStart = nullptr;
+	m_pCurrent = nullptr;
+	m_nSize = 0;
+
+#ifdef _WIN32
+	m_hFile = INVALID_HANDLE_VALUE;
+	m_hMapping = nullptr;
+#endif
+}
+
+CMappedFileStream::~CMappedFileStream()
+{
+	Close();
+}
+
+// maps whole file into memory for reading
+bool CMappedFileStream::Open(const char* filename)
+{
+	Close();
+
+#ifdef _WIN32
+	HANDLE hFile = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+
+	if (hFile == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(hFile, &fileSize) || fileSize.QuadPart == 0)
+	{
+		CloseHandle(hFile);
+		return false;
+	}
+
+	HANDLE hMapping = CreateFileMappingA(hFile, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+
+	if (!hMapping)
+	{
+		CloseHandle(hFile);
+		return false;
+	}
+
+	void* data = MapViewOfFile(hMapping, FILE_MAP_COPY, 0, 0, 0);
+
+	if (!data)
+	{
+		CloseHandle(hMapping);
+		CloseHandle(hFile);
+		return false;
+	}
+
+	m_hFile = hFile;
+	m_hMapping = hMapping;
+	m_nSize = (long)fileSize.QuadPart;
+#else
+	int fd = open(filename, O_RDONLY);
+
+	if (fd == -1)
+		return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	// copy-on-write so data viewed in place can still be modified by the user
+	void* data = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+
+	// mapping stays valid after descriptor is closed
+	close(fd);
+
+	if (data == MAP_FAILED)
+		return false;
+
+	m_nSize = (long)st.st_size;
+#endif
+
+	m_pStart = (ubyte*)data;
+	m_pCurrent = m_pStart;
+
+	return true;
+}
+
+// unmaps file
+void CMappedFileStream::Close()
+{
+	if (!m_pStart)
+		return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(m_pStart);
+	CloseHandle((HANDLE)m_hMapping);
+	CloseHandle((HANDLE)m_hFile);
+
+	m_hFile = INVALID_HANDLE_VALUE;
+	m_hMapping = nullptr;
+#else
+	munmap(m_pStart, m_nSize);
+#endif
+
+	m_pStart = nullptr;
+	m_pCurrent = nullptr;
+	m_nSize = 0;
+}
+
+size_t CMappedFileStream::Read(void *dest, size_t count, size_t size)
+{
+	if (!m_pStart || !size)
+		return 0;
+
+	long nCurPos = Tell();
+
+	if (nCurPos >= m_nSize)
+		return 0;
+
+	const size_t nAvailable = (size_t)(m_nSize - nCurPos);
+	size_t nReadBytes = size * count;
+
+	if (nReadBytes > nAvailable)
+		nReadBytes = nAvailable;
+
+	memcpy(dest, m_pCurrent, nReadBytes);
+
+	m_pCurrent += nReadBytes;
+
+	// same as fread - number of complete elements
+	return nReadBytes / size;
+}
+
+size_t CMappedFileStream::Write(const void *src, size_t count, size_t size)
+{
+	return 0;
+}
+
+int CMappedFileStream::Seek(long nOffset, VirtStreamSeek_e seekType)
+{
+	long newPos;
+
+	switch (seekType)
+	{
+		case VS_SEEK_SET:
+			newPos = nOffset;
+			break;
+		case VS_SEEK_CUR:
+			newPos = Tell() + nOffset;
+			break;
+		case VS_SEEK_END:
+			newPos = m_nSize + nOffset;
+			break;
+		default:
+			return -1;
+	}
+
+	if (newPos < 0)
+		return -1;
+
+	m_pCurrent = m_pStart + newPos;
+
+	return 0;
+}
+
+long CMappedFileStream::Tell()
+{
+	return m_pCurrent - m_pStart;
+}
+
+long CMappedFileStream::GetSize()
+{
+	return m_nSize;
+}
+
+int CMappedFileStream::Flush()
+{
+	return 0;
+}
+
+// returns current pointer to the mapped data
+ubyte* CMappedFileStream::GetCurrentPointer()
+{
+	return m_pCurrent;
+}
+
+// returns base pointer to the mapped data
+ubyte* CMappedFileStream::GetBasePointer()
+{
+	return m_pStart;
+}
+
+// returns pointer to the mapped data at current position if 'size' bytes are available
+ubyte* CMappedFileStream::GetMappedPointer(long size)
+{
+	long nCurPos = Tell();
+
+	if (!m_pStart || nCurPos < 0 || size < 0 || nCurPos + size > m_nSize)
+		return nullptr;
+
+	return m_pCurrent;
+}
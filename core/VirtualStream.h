@@ -89,4 +89,111 @@ protected:
 	FILE*				m_pFilePtr;
 };
 
+//--------------------------
+// CCachedFileStream - read-only file stream with sector cache
+//--------------------------
+
+#define VSTREAM_SECTOR_SIZE			2048	// matches CD sector size
+
+class CCachedFileStream : public IVirtualStream
+{
+public:
+						CCachedFileStream(int numCacheSectors = 128, int readAheadSectors = 16, int sectorSize = VSTREAM_SECTOR_SIZE);
+						~CCachedFileStream();
+
+	bool				Open(const char* filename);
+	void				Close();
+
+	size_t				Read(void *dest, size_t count, size_t size);
+
+	// cached stream is read-only, always returns 0
+	size_t				Write(const void *src, size_t count, size_t size);
+
+	// only changes position, file is seeked on cache miss
+	int					Seek(long nOffset, VirtStreamSeek_e seekType);
+	long				Tell();
+	long				GetSize();
+	int					Flush();
+
+	VirtStreamType_e	GetType() { return m_pFilePtr ? VS_TYPE_FILE : VS_TYPE_INVALID; }
+
+	// statistics
+	int					GetCacheHits() const	{ return m_cacheHits; }
+	int					GetCacheMisses() const	{ return m_cacheMisses; }
+	int					GetFileReads() const	{ return m_fileReads; }
+	int					GetFileSeeks() const	{ return m_fileSeeks; }
+	long				GetBytesRead() const	{ return m_bytesRead; }
+
+protected:
+	// returns cached sector data, reads sectors from file if needed
+	ubyte*				GetSector(long sector);
+
+	FILE*				m_pFilePtr;
+	long				m_nSize;
+
+	long				m_nPos;			// stream position
+	long				m_nFilePos;		// actual file position
+
+	ubyte*				m_cache;
+	long*				m_cacheSectors;	// sector number in each cache slot, direct mapped
+
+	int					m_sectorSize;
+	int					m_numCacheSectors;
+	int					m_readAheadSectors;
+
+	int					m_cacheHits;
+	int					m_cacheMisses;
+	int					m_fileReads;
+	int					m_fileSeeks;
+	long				m_bytesRead;
+};
+
+//--------------------------
+// CMappedFileStream - read-only memory-mapped file stream
+//--------------------------
+
+class CMappedFileStream : public IVirtualStream
+{
+public:
+						CMappedFileStream();
+						~CMappedFileStream();
+
+	// maps whole file into memory for reading
+	bool				Open(const char* filename);
+
+	// unmaps file
+	void				Close();
+
+	size_t				Read(void *dest, size_t count, size_t size);
+
+	// mapped stream is read-only, always returns 0
+	size_t				Write(const void *src, size_t count, size_t size);
+
+	int					Seek(long nOffset, VirtStreamSeek_e seekType);
+	long				Tell();
+	long				GetSize();
+	int					Flush();
+
+	VirtStreamType_e	GetType() { return m_pStart ? VS_TYPE_FILE : VS_TYPE_INVALID; }
+
+	// returns current pointer to the mapped data
+	ubyte*				GetCurrentPointer();
+
+	// returns base pointer to the mapped data
+	ubyte*				GetBasePointer();
+
+	// returns pointer to the mapped data at current position if 'size' bytes are available
+	ubyte*				GetMappedPointer(long size);
+
+private:
+	ubyte*				m_pStart;
+	ubyte*				m_pCurrent;
+	long				m_nSize;
+
+#ifdef _WIN32
+	void*				m_hFile;
+	void*				m_hMapping;
+#endif
+};
+
 #endif // VIRTUALSTREAM_H
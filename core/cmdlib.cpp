@@ -15,11 +15,42 @@ void DefaultSpewFunc(SpewType_t type,const char* pMsg)
 //Spew callback
 static SpewFunc_fn g_fnConSpewFunc = DefaultSpewFunc;
 
+// Thread redirection
+static thread_local ThreadSpewFunc_fn g_fnThreadSpewFunc = nullptr;
+static thread_local void* g_threadSpewUserData = nullptr;
+
 void SetSpewFunction(SpewFunc_fn newfunc)
 {
 	g_fnConSpewFunc = newfunc;
 }
 
+void SetThreadSpewFunction(ThreadSpewFunc_fn func, void* userData)
+{
+	g_fnThreadSpewFunc = func;
+	g_threadSpewUserData = func ? userData : nullptr;
+}
+
+ThreadSpewFunc_fn GetThreadSpewFunction(void** userData)
+{
+	if (userData)
+		*userData = g_threadSpewUserData;
+
+	return g_fnThreadSpewFunc;
+}
+
+void SpewToOutput(SpewType_t type, const char* text)
+{
+	FILE* g_logFile = fopen("app.log", "a");
+
+	if(g_logFile)
+	{
+		fprintf(g_logFile, "%s", text);
+		fclose(g_logFile);
+	}
+
+	(g_fnConSpewFunc)(type,text);
+}
+
 void SpewMessageToOutput(SpewType_t spewtype,char const* pMsgFormat, va_list args)
 {
 	char pTempBuffer[2048];
@@ -28,15 +59,13 @@ void SpewMessageToOutput(SpewType_t spewtype,char const* pMsgFormat, va_list arg
 	/* Create the message.... */
 	len += vsprintf( &pTempBuffer[len], pMsgFormat, args );
 
-	FILE* g_logFile = fopen("app.log", "a");
-
-	if(g_logFile)
+	if (g_fnThreadSpewFunc)
 	{
-		fprintf(g_logFile, "%s", pTempBuffer);
-		fclose(g_logFile);
+		(g_fnThreadSpewFunc)(g_threadSpewUserData, spewtype, pTempBuffer);
+		return;
 	}
 
-	(g_fnConSpewFunc)(spewtype,pTempBuffer);
+	SpewToOutput(spewtype, pTempBuffer);
 }
 
 // developer message output
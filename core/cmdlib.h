@@ -16,6 +16,16 @@ void SetSpewFunction(SpewFunc_fn newfunc);
 
 void Install_ConsoleSpewFunction();
 
+// per-thread redirection, keeps messages of parallel jobs together
+typedef void (*ThreadSpewFunc_fn)(void* userData, SpewType_t type, const char* text);
+
+// messages of calling thread go to func instead of output. nullptr restores output
+void SetThreadSpewFunction(ThreadSpewFunc_fn func, void* userData);
+ThreadSpewFunc_fn GetThreadSpewFunction(void** userData);
+
+// writes message to output, ignoring thread redirection
+void SpewToOutput(SpewType_t type, const char* text);
+
 //---------------------------------------------------------------------------------------------------------------
 
 // developer message output
@@ -4,6 +4,22 @@
 #include <nstd/Array.hpp>
 #include "core/cmdlib.h"
 
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define TEXEL_EXPAND_X86
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#include <immintrin.h>
+#define TARGET_SSSE3
+#define TARGET_AVX2
+#else
+#include <immintrin.h>
+#define TARGET_SSSE3 __attribute__((target("ssse3")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+#endif // x86
+
 //-------------------------------------------------------------------------------
 
 // 16 bit color to BGRA
@@ -44,6 +60,254 @@ TVec4D<ubyte> rgb5a1_ToRGBA8(ushort color, bool originalTransparencyKey /*= true
 	return TVec4D<ubyte>(r, g, b, a);
 }
 
+void rgb5a1_ExpandCLUT(uint* dest, const ushort* colors, int numColors, bool outputBGR, bool originalTransparencyKey)
+{
+	for (int i = 0; i < numColors; i++)
+	{
+		TVec4D<ubyte> color = outputBGR ? rgb5a1_ToBGRA8(colors[i], originalTransparencyKey) : rgb5a1_ToRGBA8(colors[i], originalTransparencyKey);
+		dest[i] = *(uint*)&color;
+	}
+}
+
+//-------------------------------------------------------------------------------
+// 4 bit indexed to 32 bit expansion kernels
+// all of them take even startX and produce exactly same output
+//-------------------------------------------------------------------------------
+
+static void ExpandIndexed4bppScalar(uint* dest, const ubyte* src, int count, const uint* palette)
+{
+	int i = 0;
+
+	for (; i + 1 < count; i += 2)
+	{
+		const ubyte texels = *src++;
+
+		dest[i] = palette[texels & 15];
+		dest[i + 1] = palette[texels >> 4];
+	}
+
+	if (i < count)
+		dest[i] = palette[*src & 15];
+}
+
+#ifdef TEXEL_EXPAND_X86
+
+// splits palette into 4 byte planes so it can be looked up by pshufb
+static void SplitPalettePlanes(ubyte planes[4][16], const uint* palette)
+{
+	for (int i = 0; i < 16; i++)
+	{
+		planes[0][i] = palette[i] & 0xff;
+		planes[1][i] = (palette[i] >> 8) & 0xff;
+		planes[2][i] = (palette[i] >> 16) & 0xff;
+		planes[3][i] = (palette[i] >> 24) & 0xff;
+	}
+}
+
+TARGET_SSSE3 static void ExpandIndexed4bppSSSE3(uint* dest, const ubyte* src, int count, const uint* palette)
+{
+	ubyte planeData[4][16];
+	SplitPalettePlanes(planeData, palette);
+
+	const __m128i plane0 = _mm_loadu_si128((const __m128i*)planeData[0]);
+	const __m128i plane1 = _mm_loadu_si128((const __m128i*)planeData[1]);
+	const __m128i plane2 = _mm_loadu_si128((const __m128i*)planeData[2]);
+	const __m128i plane3 = _mm_loadu_si128((const __m128i*)planeData[3]);
+	const __m128i nibbleMask = _mm_set1_epi8(15);
+
+	int i = 0;
+
+	// 16 texels per iteration
+	for (; i + 16 <= count; i += 16)
+	{
+		const __m128i texels = _mm_loadl_epi64((const __m128i*)(src + i / 2));
+		const __m128i lo = _mm_and_si128(texels, nibbleMask);
+		const __m128i hi = _mm_and_si128(_mm_srli_epi16(texels, 4), nibbleMask);
+		const __m128i indices = _mm_unpacklo_epi8(lo, hi);
+
+		const __m128i b0 = _mm_shuffle_epi8(plane0, indices);
+		const __m128i b1 = _mm_shuffle_epi8(plane1, indices);
+		const __m128i b2 = _mm_shuffle_epi8(plane2, indices);
+		const __m128i b3 = _mm_shuffle_epi8(plane3, indices);
+
+		const __m128i b01lo = _mm_unpacklo_epi8(b0, b1);
+		const __m128i b01hi = _mm_unpackhi_epi8(b0, b1);
+		const __m128i b23lo = _mm_unpacklo_epi8(b2, b3);
+		const __m128i b23hi = _mm_unpackhi_epi8(b2, b3);
+
+		_mm_storeu_si128((__m128i*)(dest + i), _mm_unpacklo_epi16(b01lo, b23lo));
+		_mm_storeu_si128((__m128i*)(dest + i + 4), _mm_unpackhi_epi16(b01lo, b23lo));
+		_mm_storeu_si128((__m128i*)(dest + i + 8), _mm_unpacklo_epi16(b01hi, b23hi));
+		_mm_storeu_si128((__m128i*)(dest + i + 12), _mm_unpackhi_epi16(b01hi, b23hi));
+	}
+
+	ExpandIndexed4bppScalar(dest + i, src + i / 2, count - i, palette);
+}
+
+TARGET_AVX2 static void ExpandIndexed4bppAVX2(uint* dest, const ubyte* src, int count, const uint* palette)
+{
+	ubyte planeData[4][16];
+	SplitPalettePlanes(planeData, palette);
+
+	// pshufb works within 128 bit lanes so palette is duplicated in both
+	__m256i planes[4];
+	for (int p = 0; p < 4; p++)
+	{
+		const __m128i plane = _mm_loadu_si128((const __m128i*)planeData[p]);
+		planes[p] = _mm256_inserti128_si256(_mm256_castsi128_si256(plane), plane, 1);
+	}
+
+	const __m128i nibbleMask = _mm_set1_epi8(15);
+
+	int i = 0;
+
+	// 32 texels per iteration
+	for (; i + 32 <= count; i += 32)
+	{
+		const __m128i texels = _mm_loadu_si128((const __m128i*)(src + i / 2));
+		const __m128i lo = _mm_and_si128(texels, nibbleMask);
+		const __m128i hi = _mm_and_si128(_mm_srli_epi16(texels, 4), nibbleMask);
+
+		// texels 0..15 in low lane, 16..31 in high lane
+		const __m256i indices = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_unpacklo_epi8(lo, hi)), _mm_unpackhi_epi8(lo, hi), 1);
+
+		const __m256i b0 = _mm256_shuffle_epi8(planes[0], indices);
+		const __m256i b1 = _mm256_shuffle_epi8(planes[1], indices);
+		const __m256i b2 = _mm256_shuffle_epi8(planes[2], indices);
+		const __m256i b3 = _mm256_shuffle_epi8(planes[3], indices);
+
+		const __m256i b01lo = _mm256_unpacklo_epi8(b0, b1);
+		const __m256i b01hi = _mm256_unpackhi_epi8(b0, b1);
+		const __m256i b23lo = _mm256_unpacklo_epi8(b2, b3);
+		const __m256i b23hi = _mm256_unpackhi_epi8(b2, b3);
+
+		// per lane: 0..3, 4..7, 8..11, 12..15
+		const __m256i p0 = _mm256_unpacklo_epi16(b01lo, b23lo);
+		const __m256i p1 = _mm256_unpackhi_epi16(b01lo, b23lo);
+		const __m256i p2 = _mm256_unpacklo_epi16(b01hi, b23hi);
+		const __m256i p3 = _mm256_unpackhi_epi16(b01hi, b23hi);
+
+		_mm256_storeu_si256((__m256i*)(dest + i), _mm256_permute2x128_si256(p0, p1, 0x20));
+		_mm256_storeu_si256((__m256i*)(dest + i + 8), _mm256_permute2x128_si256(p2, p3, 0x20));
+		_mm256_storeu_si256((__m256i*)(dest + i + 16), _mm256_permute2x128_si256(p0, p1, 0x31));
+		_mm256_storeu_si256((__m256i*)(dest + i + 24), _mm256_permute2x128_si256(p2, p3, 0x31));
+	}
+
+	ExpandIndexed4bppScalar(dest + i, src + i / 2, count - i, palette);
+}
+
+static bool CPUSupportsPath(int path)
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+
+	const int maxLeaf = info[0];
+
+	__cpuid(info, 1);
+
+	if (path == TEXEL_EXPAND_SSSE3)
+		return (info[2] & (1 << 9)) != 0;
+
+	if (path == TEXEL_EXPAND_AVX2)
+	{
+		// OS must save YMM registers
+		const bool osxsave = (info[2] & (1 << 27)) != 0;
+
+		if (!osxsave || maxLeaf < 7 || (_xgetbv(0) & 6) != 6)
+			return false;
+
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+	}
+#else
+	__builtin_cpu_init();
+
+	if (path == TEXEL_EXPAND_SSSE3)
+		return __builtin_cpu_supports("ssse3");
+
+	if (path == TEXEL_EXPAND_AVX2)
+		return __builtin_cpu_supports("avx2");
+#endif
+
+	return false;
+}
+
+#else
+
+static bool CPUSupportsPath(int path)
+{
+	return false;
+}
+
+#endif // TEXEL_EXPAND_X86
+
+static int GetBestTexelExpandPath()
+{
+	for (int path = TEXEL_EXPAND_PATH_COUNT - 1; path > TEXEL_EXPAND_SCALAR; path--)
+	{
+		if (CPUSupportsPath(path))
+			return path;
+	}
+
+	return TEXEL_EXPAND_SCALAR;
+}
+
+static int s_texelExpandPath = GetBestTexelExpandPath();
+
+int GetTexelExpandPath()
+{
+	return s_texelExpandPath;
+}
+
+bool IsTexelExpandPathSupported(int path)
+{
+	return path == TEXEL_EXPAND_SCALAR || (path > TEXEL_EXPAND_SCALAR && path < TEXEL_EXPAND_PATH_COUNT && CPUSupportsPath(path));
+}
+
+bool SetTexelExpandPath(int path)
+{
+	if (!IsTexelExpandPathSupported(path))
+		return false;
+
+	s_texelExpandPath = path;
+	return true;
+}
+
+const char* GetTexelExpandPathName(int path)
+{
+	static const char* s_pathNames[] = { "scalar", "SSSE3", "AVX2" };
+
+	if (path < 0 || path >= TEXEL_EXPAND_PATH_COUNT)
+		return "unknown";
+
+	return s_pathNames[path];
+}
+
+void ExpandIndexed4bppRow(uint* dest, const ubyte* srcRow, int startX, int count, const uint* palette)
+{
+	if (count <= 0)
+		return;
+
+	const ubyte* src = srcRow + startX / 2;
+
+	// odd texel goes first so kernels start at byte boundary
+	if (startX & 1)
+	{
+		*dest++ = palette[*src++ >> 4];
+		count--;
+	}
+
+#ifdef TEXEL_EXPAND_X86
+	if (s_texelExpandPath == TEXEL_EXPAND_AVX2)
+		ExpandIndexed4bppAVX2(dest, src, count, palette);
+	else if (s_texelExpandPath == TEXEL_EXPAND_SSSE3)
+		ExpandIndexed4bppSSSE3(dest, src, count, palette);
+	else
+#endif
+		ExpandIndexed4bppScalar(dest, src, count, palette);
+}
+
 //-------------------------------------------------------------
 // Saves TGA file
 //-------------------------------------------------------------
@@ -48,6 +48,31 @@ TVec4D<ubyte> rgb5a1_ToBGRA8(ushort color, bool originalTransparencyKey /*= true
 // originalTransparencyKey makes it pink
 TVec4D<ubyte> rgb5a1_ToRGBA8(ushort color, bool originalTransparencyKey /*= true*/);
 
+// converts palette colors once so texels can be expanded by lookup
+// output is same as rgb5a1_ToBGRA8/rgb5a1_ToRGBA8 per color
+void rgb5a1_ExpandCLUT(uint* dest, const ushort* colors, int numColors, bool outputBGR, bool originalTransparencyKey);
+
+//-------------------------------------------------------------------
+
+enum ETexelExpandPath
+{
+	TEXEL_EXPAND_SCALAR = 0,
+	TEXEL_EXPAND_SSSE3,
+	TEXEL_EXPAND_AVX2,
+
+	TEXEL_EXPAND_PATH_COUNT
+};
+
+// expands texels [startX..startX+count) of 4 bit indexed row to 32 bit colors using 16 color palette
+// dest receives texel startX at dest[0]. Low nibble is the even texel
+void ExpandIndexed4bppRow(uint* dest, const ubyte* srcRow, int startX, int count, const uint* palette);
+
+// best path supported by CPU is used by default
+int			GetTexelExpandPath();
+bool		IsTexelExpandPathSupported(int path);
+bool		SetTexelExpandPath(int path);		// used by benchmark
+const char*	GetTexelExpandPathName(int path);
+
 //-------------------------------------------------------------------
 
 
@@ -0,0 +1,87 @@
+#include "parallel.h"
+
+#include "core/cmdlib.h"
+
+#include <nstd/Mutex.hpp>
+#include <nstd/System.hpp>
+#include <nstd/Thread.hpp>
+
+struct ParallelJobs_t
+{
+	ParallelJobFunc_t	func{ nullptr };
+	void*				userData{ nullptr };
+
+	// workers print same way as calling thread
+	ThreadSpewFunc_fn	spewFunc{ nullptr };
+	void*				spewUserData{ nullptr };
+
+	Mutex				mutex;
+	int					nextJob{ 0 };
+	int					numJobs{ 0 };
+};
+
+static uint ParallelJobsThread(void* param)
+{
+	ParallelJobs_t& jobs = *(ParallelJobs_t*)param;
+
+	SetThreadSpewFunction(jobs.spewFunc, jobs.spewUserData);
+
+	for (;;)
+	{
+		int jobIndex;
+
+		{
+			Mutex::Guard guard(jobs.mutex);
+
+			if (jobs.nextJob >= jobs.numJobs)
+				return 0;
+
+			jobIndex = jobs.nextJob++;
+		}
+
+		jobs.func(jobs.userData, jobIndex);
+	}
+}
+
+//-------------------------------------------------------------
+// Runs independent jobs on worker threads
+//-------------------------------------------------------------
+void RunParallelJobs(int numJobs, int numThreads, ParallelJobFunc_t func, void* userData)
+{
+	ParallelJobs_t jobs;
+	jobs.func = func;
+	jobs.userData = userData;
+	jobs.numJobs = numJobs;
+	jobs.spewFunc = GetThreadSpewFunction(&jobs.spewUserData);
+
+	if (numThreads <= 0)
+		numThreads = System::getProcessorCount();
+
+	if (numThreads > numJobs)
+		numThreads = numJobs;
+
+	// calling thread is one of them
+	const int numWorkers = numThreads > 1 ? numThreads - 1 : 0;
+
+	Thread* threads = new Thread[numWorkers];
+	int numStarted = 0;
+
+	for (int i = 0; i < numWorkers; i++)
+	{
+		if (!threads[i].start(ParallelJobsThread, &jobs))
+		{
+			MsgError("Unable to start worker thread %d!\n", i);
+			break;
+		}
+
+		numStarted++;
+	}
+
+	// this thread takes remaining jobs, does all of them if none of workers could start
+	ParallelJobsThread(&jobs);
+
+	for (int i = 0; i < numStarted; i++)
+		threads[i].join();
+
+	delete[] threads;
+}
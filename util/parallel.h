@@ -0,0 +1,10 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+typedef void	(*ParallelJobFunc_t)(void* userData, int jobIndex);
+
+// calls func for every job index on worker threads, returns when all are done
+// calling thread takes jobs too. numThreads <= 0 uses processor count
+void			RunParallelJobs(int numJobs, int numThreads, ParallelJobFunc_t func, void* userData);
+
+#endif // PARALLEL_H
@@ -9,6 +9,8 @@
 #include "core/cmdlib.h"
 #include "core/dktypes.h"
 
+#include <string.h>
+
 struct RNCheader
 {
     uint identifier;           //must contain 'R', 'N', 'C', method
@@ -112,7 +114,7 @@ unsigned short get_offset(unsigned char** byteStreamPtr)
 }
 
 /*____________________________________________________________________________*/
-//RNC2 unpack
+//RNC2 unpack, old bit by bit decoder. Kept as reference for -benchrnc
 
 int RNCunpack2(unsigned char* packed, unsigned long srcSize,
     unsigned char* unpacked, unsigned long dstSize)
@@ -177,17 +179,295 @@ int RNCunpack2(unsigned char* packed, unsigned long srcSize,
         return 0;
 }//end unpack2
 
+//--------------------------------------------------
+// Table driven RNC2 decoder
+//--------------------------------------------------
+
+// Bit bytes are interleaved with raw bytes - new bit byte is taken from
+// source only when it's first bit is needed. So bits can't be buffered
+// ahead; instead codes are looked up by peeking remaining bits of current
+// bit byte and the next source byte, which would be the next bit byte
+struct RNC2BitReader_t
+{
+	const ubyte*	src;
+	const ubyte*	srcEnd;
+	uint			bits;		// remaining bits of current bit byte, from MSB
+	int				numBits;
+};
+
+static inline uint RNC2_PeekBits(const RNC2BitReader_t& br, int count)
+{
+	uint window = br.bits;
+
+	if (br.numBits < count && br.src < br.srcEnd)
+		window |= (uint)*br.src << (24 - br.numBits);
+
+	return window >> (32 - count);
+}
+
+static inline void RNC2_SkipBits(RNC2BitReader_t& br, int count)
+{
+	if (count <= br.numBits)
+	{
+		br.bits <<= count;
+		br.numBits -= count;
+		return;
+	}
+
+	// fetch new bit byte
+	const uint next = br.src < br.srcEnd ? *br.src : 0;
+	br.src++;
+
+	count -= br.numBits;
+	br.bits = (next << 24) << count;
+	br.numBits = 8 - count;
+}
+
+static inline uint RNC2_GetBits(RNC2BitReader_t& br, int count)
+{
+	const uint value = RNC2_PeekBits(br, count);
+	RNC2_SkipBits(br, count);
+
+	return value;
+}
+
+static inline uint RNC2_GetByte(RNC2BitReader_t& br)
+{
+	const uint value = br.src < br.srcEnd ? *br.src : 0;
+	br.src++;
+
+	return value;
+}
+
+enum ERNC2Command
+{
+	RNC2_LITERAL = 0,
+	RNC2_MATCH,			// length from table, offset code follows
+	RNC2_SHORT_MATCH,	// length 2, offset byte follows
+	RNC2_LONG_MATCH,	// length byte follows, zero means end of block
+	RNC2_RAW_RUN,		// 4 bits of raw byte count follow
+};
+
+struct RNC2Code_t
+{
+	ubyte	numBits;
+	ubyte	command;	// ERNC2Command or offset high part
+	ubyte	length;
+};
+
+#define RNC2_COMMAND_BITS	5
+#define RNC2_OFFSET_BITS	6
+
+struct RNC2Tables_t
+{
+	RNC2Code_t	commands[1 << RNC2_COMMAND_BITS];
+	RNC2Code_t	offsets[1 << RNC2_OFFSET_BITS];
+
+	// fills all entries starting with code
+	static void Set(RNC2Code_t* table, int tableBits, uint code, int numBits, int command, int length = 0)
+	{
+		const int numEntries = 1 << (tableBits - numBits);
+
+		for (int i = 0; i < numEntries; i++)
+		{
+			RNC2Code_t& entry = table[(code << (tableBits - numBits)) | i];
+			entry.numBits = numBits;
+			entry.command = command;
+			entry.length = length;
+		}
+	}
+
+	RNC2Tables_t()
+	{
+		// same codes as RNCunpack2 decodes bit by bit
+		Set(commands, RNC2_COMMAND_BITS, 0x0, 1, RNC2_LITERAL);			// 0
+		Set(commands, RNC2_COMMAND_BITS, 0x6, 3, RNC2_SHORT_MATCH, 2);	// 110
+		Set(commands, RNC2_COMMAND_BITS, 0xE, 4, RNC2_MATCH, 3);		// 1110
+		Set(commands, RNC2_COMMAND_BITS, 0xF, 4, RNC2_LONG_MATCH);		// 1111
+
+		for (int a = 0; a < 2; a++)
+		{
+			Set(commands, RNC2_COMMAND_BITS, 0x8 | (a << 1), 4, RNC2_MATCH, 4 + a);	// 10a0
+
+			for (int c = 0; c < 2; c++)
+			{
+				const int length = (3 + a) * 2 + c;		// 10a1c
+				const uint code = 0x12 | (a << 2) | c;
+
+				if (length == 9)
+					Set(commands, RNC2_COMMAND_BITS, code, 5, RNC2_RAW_RUN);
+				else
+					Set(commands, RNC2_COMMAND_BITS, code, 5, RNC2_MATCH, length);
+			}
+		}
+
+		// high part of offset
+		Set(offsets, RNC2_OFFSET_BITS, 0x0, 1, 0);		// 0
+		Set(offsets, RNC2_OFFSET_BITS, 0x6, 3, 1);		// 110
+		Set(offsets, RNC2_OFFSET_BITS, 0x8, 4, 2);		// 1000
+		Set(offsets, RNC2_OFFSET_BITS, 0x9, 4, 3);		// 1001
+
+		for (int v = 0; v < 2; v++)
+		{
+			for (int w = 0; w < 2; w++)
+			{
+				const int value = v * 2 + 4 + w;
+
+				Set(offsets, RNC2_OFFSET_BITS, 0x15 | (v << 3) | (w << 1), 5, value);	// 1v1w1
+
+				for (int z = 0; z < 2; z++)
+					Set(offsets, RNC2_OFFSET_BITS, 0x28 | (v << 4) | (w << 2) | z, 6, value * 2 + z);	// 1v1w0z
+			}
+		}
+	}
+};
+
+static const RNC2Tables_t s_rnc2Tables;
+
+static inline int RNC2_GetOffset(RNC2BitReader_t& br)
+{
+	const RNC2Code_t& code = s_rnc2Tables.offsets[RNC2_PeekBits(br, RNC2_OFFSET_BITS)];
+	RNC2_SkipBits(br, code.numBits);
+
+	return (code.command << 8) + RNC2_GetByte(br) + 1;
+}
+
+// copies match, 8 bytes at once if they don't overlap
+static inline void RNC2_CopyMatch(ubyte* dst, int offset, int length)
+{
+	const ubyte* from = dst - offset;
+
+	if (offset >= 8)
+	{
+		for (; length >= 8; length -= 8)
+		{
+			memcpy(dst, from, 8);
+			dst += 8;
+			from += 8;
+		}
+	}
+	else if (offset == 1)
+	{
+		memset(dst, *from, length);
+		return;
+	}
+
+	while (length--)
+		*dst++ = *from++;
+}
+
+int RNCunpack2Fast(unsigned char* packed, unsigned long srcSize,
+	unsigned char* unpacked, unsigned long dstSize)
+{
+	RNC2BitReader_t br;
+	br.src = packed;
+	br.srcEnd = packed + srcSize;
+	br.bits = 0;
+	br.numBits = 0;
+
+	ubyte* dst = unpacked;
+	ubyte* dstEnd = unpacked + dstSize;
+
+	bool overrun = false;
+
+	RNC2_SkipBits(br, 2);	// toss first two bits
+
+	while (dst < dstEnd && br.src < br.srcEnd)
+	{
+		const RNC2Code_t& cmd = s_rnc2Tables.commands[RNC2_PeekBits(br, RNC2_COMMAND_BITS)];
+		RNC2_SkipBits(br, cmd.numBits);
+
+		if (cmd.command == RNC2_LITERAL)
+		{
+			*dst++ = RNC2_GetByte(br);
+			continue;
+		}
+
+		if (cmd.command == RNC2_RAW_RUN)
+		{
+			const int length = (RNC2_GetBits(br, 4) + 3) * 4;
+
+			if (length > dstEnd - dst || length > br.srcEnd - br.src)
+			{
+				overrun = true;
+				break;
+			}
+
+			memcpy(dst, br.src, length);
+			dst += length;
+			br.src += length;
+			continue;
+		}
+
+		int length = cmd.length;
+		int offset;
+
+		if (cmd.command == RNC2_SHORT_MATCH)
+		{
+			offset = RNC2_GetByte(br) + 1;
+		}
+		else
+		{
+			if (cmd.command == RNC2_LONG_MATCH)
+			{
+				length = RNC2_GetByte(br) + 8;
+
+				// zero length ends block, next one follows if bit is set
+				if (length == 8)
+				{
+					if (!RNC2_GetBits(br, 1))
+						break;
+
+					continue;
+				}
+			}
+
+			offset = RNC2_GetOffset(br);
+		}
+
+		if (offset > dst - unpacked || length > dstEnd - dst)
+		{
+			overrun = true;
+			break;
+		}
+
+		RNC2_CopyMatch(dst, offset, length);
+		dst += length;
+	}
+
+	if (overrun || br.src > br.srcEnd)
+		return 1;
+
+	return 0;
+}
+
 //--------------------------------------------------
 
 // RNC decoding routine
 void UnpackRNC(char* src, char* dest)
 {
-    RNCheader* hdr = (struct RNCheader*)src;
+	RNCheader* hdr = (struct RNCheader*)src;
 
-    int method = testRNC(hdr->identifier);
+	int method = testRNC(hdr->identifier);
 
-    if (method == 2)
-        RNCunpack2((unsigned char*)src + RNC_HEADER_LENGTH, hdr->packSize, (unsigned char*)dest, hdr->unpackSize);
-    else
-        MsgError("UnpackRNC error - unsupported method %d\n", method);
-}
\ No newline at end of file
+	if (method == 2)
+	{
+		if (RNCunpack2Fast((unsigned char*)src + RNC_HEADER_LENGTH, hdr->packSize, (unsigned char*)dest, hdr->unpackSize))
+			MsgError("UnpackRNC error - broken data\n");
+	}
+	else
+		MsgError("UnpackRNC error - unsupported method %d\n", method);
+}
+
+// same using old decoder
+void UnpackRNCReference(char* src, char* dest)
+{
+	RNCheader* hdr = (struct RNCheader*)src;
+
+	int method = testRNC(hdr->identifier);
+
+	if (method == 2)
+		RNCunpack2((unsigned char*)src + RNC_HEADER_LENGTH, hdr->packSize, (unsigned char*)dest, hdr->unpackSize);
+	else
+		MsgError("UnpackRNC error - unsupported method %d\n", method);
+}
@@ -4,6 +4,9 @@
 
 extern void UnpackRNC(char* src, char* dest) ; // 0x0001B434
 
+// old bit by bit decoder, kept as reference
+extern void UnpackRNCReference(char* src, char* dest);
+
 extern void Unpack() ; // 0x0001B488
 
 extern void _mcard_text_size() ; // 0x0001B4FC